@@ -0,0 +1,266 @@
+#pragma once
+
+// Allocation profile of FontMod itself, for builds with FONTMOD_ALLOC_PROFILE defined.
+// Every operator new of the module, ryml trees included, is tagged with the scope active
+// on its thread: a startup phase or the hook being run. Counts, bytes, live bytes and peak
+// live bytes are kept per scope, frees are charged to the scope that allocated, so the
+// report shows which hooks still allocate once the program runs and what startup keeps.
+// No Windows types, so it can be checked on any platform.
+//
+// Without the define, AllocScope is empty and operator new is the CRT's.
+
+#include "StatsLayout.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+#include <vector>
+
+enum struct AllocPhase : uint32_t
+{
+	Other, // Outside of the scopes below
+	Startup,
+	Config,
+	Ryml, // Trees and parser buffers of any phase
+	UserFonts,
+	WebFonts,
+	FontList, // LogAllAvailableFonts
+	Warmup,
+	Reports,
+	Count
+};
+
+constexpr std::array<std::string_view, static_cast<size_t>(AllocPhase::Count)> allocPhaseNames = {
+	"other",
+	"startup",
+	"config",
+	"ryml",
+	"userFonts",
+	"webFonts",
+	"fontList",
+	"warmup",
+	"reports",
+};
+
+constexpr uint32_t PhaseScopeCount = static_cast<uint32_t>(AllocPhase::Count);
+constexpr uint32_t AllocScopeCount = PhaseScopeCount + static_cast<uint32_t>(HookId::Count);
+
+constexpr uint32_t AllocScopeOf(AllocPhase phase)
+{
+	return static_cast<uint32_t>(phase);
+}
+
+constexpr uint32_t AllocScopeOf(HookId id)
+{
+	return PhaseScopeCount + static_cast<uint32_t>(id);
+}
+
+constexpr std::string_view AllocScopeName(uint32_t scope)
+{
+	return scope < PhaseScopeCount ? allocPhaseNames[scope] : hookNames[scope - PhaseScopeCount];
+}
+
+struct AllocStats
+{
+	struct Usage
+	{
+		std::string_view scope;
+		uint64_t allocations;
+		uint64_t frees;
+		uint64_t bytes; // Allocated in total
+		int64_t live;
+		int64_t peak;
+	};
+
+	void Allocated(uint32_t scope, size_t bytes)
+	{
+		auto& s = scopes[scope];
+		s.allocations.fetch_add(1, std::memory_order_relaxed);
+		s.bytes.fetch_add(bytes, std::memory_order_relaxed);
+		const int64_t live = s.live.fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed) + static_cast<int64_t>(bytes);
+		for (int64_t peak = s.peak.load(std::memory_order_relaxed); live > peak;)
+		{
+			if (s.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+				break;
+		}
+	}
+
+	void Freed(uint32_t scope, size_t bytes)
+	{
+		auto& s = scopes[scope];
+		s.frees.fetch_add(1, std::memory_order_relaxed);
+		s.live.fetch_sub(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+	}
+
+	// Scopes that allocated, in scope order. Allocates itself, in the caller's scope.
+	std::vector<Usage> Snapshot() const
+	{
+		std::vector<Usage> usage;
+		usage.reserve(AllocScopeCount);
+		for (uint32_t i = 0; i < AllocScopeCount; ++i)
+		{
+			const auto& s = scopes[i];
+			const uint64_t allocations = s.allocations.load(std::memory_order_relaxed);
+			if (allocations == 0)
+				continue;
+			usage.push_back({ AllocScopeName(i), allocations, s.frees.load(std::memory_order_relaxed), s.bytes.load(std::memory_order_relaxed),
+				s.live.load(std::memory_order_relaxed), s.peak.load(std::memory_order_relaxed) });
+		}
+		return usage;
+	}
+
+private:
+	struct Scope
+	{
+		std::atomic<uint64_t> allocations = 0;
+		std::atomic<uint64_t> frees = 0;
+		std::atomic<uint64_t> bytes = 0;
+		std::atomic<int64_t> live = 0;
+		std::atomic<int64_t> peak = 0;
+	};
+
+	Scope scopes[AllocScopeCount];
+};
+
+#ifdef FONTMOD_ALLOC_PROFILE
+
+// Constant initialized and trivially destroyed, so operator new can use it at any time
+constinit AllocStats allocStats;
+constinit thread_local uint32_t allocScope = 0;
+
+// Tags allocations of the current thread until destroyed, scopes nest
+struct AllocScope
+{
+	explicit AllocScope(uint32_t scope) : previous(allocScope)
+	{
+		allocScope = scope;
+	}
+
+	template <class Id>
+	explicit AllocScope(Id id) : AllocScope(AllocScopeOf(id))
+	{
+	}
+
+	~AllocScope()
+	{
+		allocScope = previous;
+	}
+
+	AllocScope(const AllocScope&) = delete;
+	AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+	uint32_t previous;
+};
+
+// Size and scope of a block, in front of it so the alignment of new is kept
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) AllocHeader
+{
+	size_t size;
+	uint32_t scope;
+};
+
+inline void* ProfiledAlloc(size_t size) noexcept
+{
+	auto header = static_cast<AllocHeader*>(malloc(sizeof(AllocHeader) + size));
+	if (!header)
+		return nullptr;
+	header->size = size;
+	header->scope = allocScope;
+	allocStats.Allocated(header->scope, size);
+	return header + 1;
+}
+
+inline void ProfiledFree(void* p) noexcept
+{
+	if (!p)
+		return;
+	auto header = static_cast<AllocHeader*>(p) - 1;
+	allocStats.Freed(header->scope, header->size);
+	free(header);
+}
+
+// Replaces the module's operator new and delete, over-aligned forms stay with the CRT
+void* operator new(size_t size)
+{
+	for (;;)
+	{
+		if (void* p = ProfiledAlloc(size))
+			return p;
+		auto handler = std::get_new_handler();
+		if (!handler)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return operator new(size);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept
+{
+	ProfiledFree(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	ProfiledFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	ProfiledFree(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	ProfiledFree(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	ProfiledFree(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	ProfiledFree(p);
+}
+
+constexpr bool allocProfileBuild = true;
+
+#else
+
+constexpr bool allocProfileBuild = false;
+
+struct AllocScope
+{
+	template <class Id>
+	explicit AllocScope(Id)
+	{
+	}
+};
+
+#endif
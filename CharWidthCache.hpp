@@ -0,0 +1,184 @@
+#pragma once
+
+// Per font tables of GetCharWidth32W and GetCharABCWidthsW results, filled 256
+// characters at a time on first use, so later queries are array copies. Tables are
+// dropped when DeleteObject frees the font. Only display DCs in MM_TEXT and
+// GM_COMPATIBLE mode are cached, other modes scale widths per DC.
+
+#include <array>
+#include <mutex>
+
+struct CharWidthCache
+{
+	static constexpr UINT BlockSize = 256;
+	static constexpr UINT MaxChar = 0xFFFF;
+	static constexpr size_t ShardCount = 16;
+	static constexpr size_t MaxFontsPerShard = 64;
+
+	bool enabled = false;
+
+	// Config time, after "memoryBudget" is read
+	void UseMemoryBudget()
+	{
+		budgetId = memoryBudget.Register("charWidthCache", [this] { return hits.load(std::memory_order_relaxed); }, [this](size_t bytes) { return Trim(bytes); });
+	}
+
+	template <class Original>
+	BOOL GetWidths(HDC hdc, UINT first, UINT last, LPINT buffer, Original original)
+	{
+		return Get(hdc, first, last, buffer, original, &FontTables::widths);
+	}
+
+	template <class Original>
+	BOOL GetABCWidths(HDC hdc, UINT first, UINT last, LPABC buffer, Original original)
+	{
+		return Get(hdc, first, last, buffer, original, &FontTables::abcWidths);
+	}
+
+	void FontDeleted(HGDIOBJ hFont)
+	{
+		auto& shard = ShardOf(static_cast<HFONT>(hFont));
+		std::lock_guard lock(shard.mutex);
+		if (auto it = shard.fonts.find(static_cast<HFONT>(hFont)); it != shard.fonts.end())
+			EraseFont(shard, it);
+	}
+
+	// At process exit other threads are gone, atomics only
+	void LogStats(HANDLE hFile)
+	{
+		FormatToFile(hFile, "[CharWidthCache] hits = {}, blocks filled = {}, uncacheable = {}\n",
+			hits.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed), bypassed.load(std::memory_order_relaxed));
+	}
+
+private:
+	template <class T>
+	using Block = std::array<T, BlockSize>;
+
+	template <class T>
+	using Table = std::unordered_map<UINT, std::unique_ptr<Block<T>>>; // By block index
+
+	struct FontTables
+	{
+		Table<INT> widths;
+		Table<ABC> abcWidths;
+		size_t bytes = 0; // Of all blocks, for the memory budget
+	};
+
+	struct alignas(64) Shard
+	{
+		std::mutex mutex;
+		std::unordered_map<HFONT, FontTables> fonts;
+	};
+
+	template <class T, class Original>
+	BOOL Get(HDC hdc, UINT first, UINT last, T* buffer, Original original, Table<T> FontTables::*table)
+	{
+		if (!buffer || first > last || last > MaxChar || GetMapMode(hdc) != MM_TEXT || GetGraphicsMode(hdc) != GM_COMPATIBLE || GetDeviceCaps(hdc, TECHNOLOGY) != DT_RASDISPLAY)
+		{
+			bypassed.fetch_add(1, std::memory_order_relaxed);
+			return original(hdc, first, last, buffer);
+		}
+
+		auto font = static_cast<HFONT>(GetCurrentObject(hdc, OBJ_FONT));
+		if (!font)
+			return original(hdc, first, last, buffer);
+
+		auto& shard = ShardOf(font);
+		for (UINT index = first / BlockSize; index <= last / BlockSize; ++index)
+		{
+			const UINT from = std::max(first, index * BlockSize);
+			const UINT to = std::min(last, index * BlockSize + BlockSize - 1);
+			auto copy = [&](const Block<T>& block) {
+				std::copy(block.begin() + (from - index * BlockSize), block.begin() + (to - index * BlockSize) + 1, buffer + (from - first));
+			};
+
+			{
+				std::lock_guard lock(shard.mutex);
+				if (auto it = shard.fonts.find(font); it != shard.fonts.end())
+				{
+					auto& blocks = it->second.*table;
+					if (auto b = blocks.find(index); b != blocks.end())
+					{
+						copy(*b->second);
+						hits.fetch_add(1, std::memory_order_relaxed);
+						liveStats.Add(LiveCounter::CharWidthHits);
+						continue;
+					}
+				}
+			}
+
+			misses.fetch_add(1, std::memory_order_relaxed);
+			liveStats.Add(LiveCounter::CharWidthMisses);
+
+			// Filled without the lock, GDI may take a while
+			auto filled = std::make_unique<Block<T>>();
+			if (!original(hdc, index * BlockSize, index * BlockSize + BlockSize - 1, filled->data()))
+				return original(hdc, first, last, buffer);
+
+			bool overBudget = false;
+			{
+				std::lock_guard lock(shard.mutex);
+				auto it = shard.fonts.find(font);
+				if (it == shard.fonts.end())
+				{
+					if (shard.fonts.size() >= MaxFontsPerShard)
+						EraseFont(shard, shard.fonts.begin());
+					it = shard.fonts.try_emplace(font).first;
+				}
+				auto [b, inserted] = (it->second.*table).try_emplace(index, std::move(filled));
+				if (inserted)
+				{
+					it->second.bytes += BlockBytes<T>;
+					overBudget = memoryBudget.Add(budgetId, BlockBytes<T>);
+				}
+				copy(*b->second);
+			}
+			if (overBudget)
+				memoryBudget.Enforce();
+		}
+		return TRUE;
+	}
+
+	// Table node included, roughly
+	template <class T>
+	static constexpr size_t BlockBytes = sizeof(Block<T>) + 4 * sizeof(void*);
+
+	// Under the shard lock, returns the bytes freed
+	size_t EraseFont(Shard& shard, std::unordered_map<HFONT, FontTables>::iterator it)
+	{
+		const size_t bytes = it->second.bytes;
+		memoryBudget.Remove(budgetId, bytes);
+		shard.fonts.erase(it);
+		return bytes;
+	}
+
+	// Same as the per shard font limit, whole fonts are dropped
+	size_t Trim(size_t bytes)
+	{
+		size_t freed = 0;
+		for (size_t n = 0; n < ShardCount && freed < bytes; ++n)
+		{
+			auto& shard = shards[nextTrimShard++ % ShardCount];
+			std::lock_guard lock(shard.mutex);
+			while (freed < bytes && !shard.fonts.empty())
+				freed += EraseFont(shard, shard.fonts.begin());
+		}
+		return freed;
+	}
+
+	Shard& ShardOf(HFONT hFont)
+	{
+		return shards[(reinterpret_cast<uintptr_t>(hFont) >> 2) % ShardCount];
+	}
+
+	Shard shards[ShardCount];
+	MemoryBudget::Id budgetId = MemoryBudget::NoId;
+	size_t nextTrimShard = 0; // Only used by MemoryBudget::Enforce, one at a time
+
+	std::atomic<uint64_t> hits = 0; // Blocks copied from the cache
+	std::atomic<uint64_t> misses = 0;
+	std::atomic<uint64_t> bypassed = 0;
+};
+
+// Never destroyed, hooks may still use it during unload
+CharWidthCache& charWidthCache = *new CharWidthCache;
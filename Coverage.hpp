@@ -0,0 +1,310 @@
+#pragma once
+
+// Unicode coverage of fonts, used to pick the first font of the fallback chain
+// that can actually display the requested charset and sample text. Only parses
+// "cmap" data, reading it from an installed font is left to FontMod.cpp.
+
+#include "Sfnt.hpp"
+#include "Simd.hpp"
+#include <array>
+#include <atomic>
+#include <mutex>
+
+
+// BMP coverage bitset. Split into 256 pages of 256 code points, empty and full
+// pages are shared so a typical font takes a few KB at most.
+struct CoverageSet
+{
+	using Page = std::array<uint64_t, 4>;
+	static constexpr uint16_t EmptyPage = 0;
+	static constexpr uint16_t FullPage = 1;
+
+	CoverageSet()
+	{
+		pages.push_back(Page{});
+		pages.push_back(Page{ ~0ull, ~0ull, ~0ull, ~0ull });
+	}
+
+	void Add(uint32_t cp)
+	{
+		if (cp > 0xFFFF)
+			return;
+
+		uint16_t& index = pageIndex[cp >> 8];
+		if (index == FullPage)
+			return;
+		if (index == EmptyPage)
+		{
+			index = static_cast<uint16_t>(pages.size());
+			pages.push_back(Page{});
+		}
+		pages[index][(cp >> 6) & 3] |= 1ull << (cp & 63);
+	}
+
+	void AddRange(uint32_t first, uint32_t last)
+	{
+		last = std::min(last, 0xFFFFu);
+		while (first <= last)
+		{
+			if ((first & 0xFF) == 0 && last - first >= 0xFF)
+			{
+				pageIndex[first >> 8] = FullPage;
+				first += 0x100;
+			}
+			else
+			{
+				Add(first++);
+			}
+		}
+	}
+
+	bool Contains(uint32_t cp) const
+	{
+		if (cp > 0xFFFF)
+			return false;
+		return (pages[pageIndex[cp >> 8]][(cp >> 6) & 3] >> (cp & 63)) & 1;
+	}
+
+	// True if every code point of "required" is covered
+	bool ContainsAll(const CoverageSet& required) const
+	{
+		for (size_t i = 0; i < pageIndex.size(); ++i)
+		{
+			const uint16_t requiredIndex = required.pageIndex[i];
+			if (requiredIndex == EmptyPage || pageIndex[i] == FullPage)
+				continue;
+			if (!PageContains(pages[pageIndex[i]], required.pages[requiredIndex]))
+				return false;
+		}
+		return true;
+	}
+
+	// Surrogates are skipped, only the BMP is tracked
+	void AddText(std::wstring_view text)
+	{
+		for (wchar_t c : text)
+		{
+			if (c < 0xD800 || (c > 0xDFFF && c <= 0xFFFF))
+				Add(c);
+		}
+	}
+
+	static CoverageSet FromText(std::wstring_view text)
+	{
+		CoverageSet set;
+		set.AddText(text);
+		return set;
+	}
+
+private:
+	static bool PageContains(const Page& a, const Page& b)
+	{
+#ifdef FONTMOD_SSE2
+		const __m128i* pa = reinterpret_cast<const __m128i*>(a.data());
+		const __m128i* pb = reinterpret_cast<const __m128i*>(b.data());
+		// b & ~a, must be all zero
+		__m128i missing = _mm_or_si128(_mm_andnot_si128(_mm_loadu_si128(pa), _mm_loadu_si128(pb)),
+			_mm_andnot_si128(_mm_loadu_si128(pa + 1), _mm_loadu_si128(pb + 1)));
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+		return ((b[0] & ~a[0]) | (b[1] & ~a[1]) | (b[2] & ~a[2]) | (b[3] & ~a[3])) == 0;
+#endif
+	}
+
+	std::array<uint16_t, 256> pageIndex{};
+	std::vector<Page> pages;
+};
+
+// Fills coverage from a "cmap" table, using format 12 or format 4 Unicode subtables.
+// https://learn.microsoft.com/en-us/typography/opentype/spec/cmap
+bool ParseCmapCoverage(const uint8_t* data, size_t size, CoverageSet& coverage)
+{
+	if (size < 4)
+		return false;
+
+	const uint16_t numTables = ReadU16BE(data + 2);
+	if (4 + size_t(numTables) * 8 > size)
+		return false;
+
+	// Prefer full repertoire subtables
+	uint32_t format4Offset = 0, format12Offset = 0;
+	for (uint16_t i = 0; i < numTables; ++i)
+	{
+		const uint8_t* record = data + 4 + i * 8;
+		const uint16_t platformID = ReadU16BE(record);
+		const uint16_t encodingID = ReadU16BE(record + 2);
+		const uint32_t offset = ReadU32BE(record + 4);
+		if (uint64_t(offset) + 2 > size)
+			continue;
+		if (platformID != 0 && !(platformID == 3 && (encodingID == 1 || encodingID == 10)))
+			continue;
+
+		const uint16_t format = ReadU16BE(data + offset);
+		if (format == 12 && !format12Offset)
+			format12Offset = offset;
+		else if (format == 4 && !format4Offset)
+			format4Offset = offset;
+	}
+
+	if (format12Offset)
+	{
+		const uint8_t* sub = data + format12Offset;
+		if (uint64_t(format12Offset) + 16 > size)
+			return false;
+		const uint32_t numGroups = ReadU32BE(sub + 12);
+		if (uint64_t(format12Offset) + 16 + uint64_t(numGroups) * 12 > size)
+			return false;
+
+		for (uint32_t i = 0; i < numGroups; ++i)
+		{
+			const uint8_t* group = sub + 16 + i * 12;
+			const uint32_t start = ReadU32BE(group);
+			const uint32_t end = ReadU32BE(group + 4);
+			if (start <= end && start <= 0xFFFF)
+				coverage.AddRange(start, end);
+		}
+		return true;
+	}
+
+	if (format4Offset)
+	{
+		const uint8_t* sub = data + format4Offset;
+		if (uint64_t(format4Offset) + 14 > size)
+			return false;
+		const size_t length = std::min<size_t>(ReadU16BE(sub + 2), size - format4Offset);
+		const uint16_t segCount = ReadU16BE(sub + 6) / 2;
+		if (16 + size_t(segCount) * 8 > length)
+			return false;
+
+		const uint8_t* endCodes = sub + 14;
+		const uint8_t* startCodes = endCodes + segCount * 2 + 2;
+		const uint8_t* idDeltas = startCodes + segCount * 2;
+		const uint8_t* idRangeOffsets = idDeltas + segCount * 2;
+
+		for (uint16_t i = 0; i < segCount; ++i)
+		{
+			const uint16_t end = ReadU16BE(endCodes + i * 2);
+			const uint16_t start = ReadU16BE(startCodes + i * 2);
+			const uint16_t delta = ReadU16BE(idDeltas + i * 2);
+			const uint16_t rangeOffset = ReadU16BE(idRangeOffsets + i * 2);
+			if (start > end || start == 0xFFFF)
+				continue;
+
+			for (uint32_t cp = start; cp <= end; ++cp)
+			{
+				uint16_t glyph;
+				if (rangeOffset == 0)
+				{
+					glyph = static_cast<uint16_t>(cp + delta);
+				}
+				else
+				{
+					const size_t glyphOffset = size_t(idRangeOffsets - sub) + i * 2 + rangeOffset + (cp - start) * 2;
+					if (glyphOffset + 2 > length)
+						break;
+					glyph = ReadU16BE(sub + glyphOffset);
+					if (glyph != 0)
+						glyph = static_cast<uint16_t>(glyph + delta);
+				}
+				if (glyph != 0)
+					coverage.Add(cp);
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+// Characters a font must have to be usable for a LOGFONT charset
+std::wstring_view GetCharsetSample(BYTE charSet)
+{
+	switch (charSet)
+	{
+	case SHIFTJIS_CHARSET:
+		return L"あいアイ日本語";
+	case HANGUL_CHARSET:
+	case JOHAB_CHARSET:
+		return L"가나다한글";
+	case GB2312_CHARSET:
+		return L"中文简体字";
+	case CHINESEBIG5_CHARSET:
+		return L"中文繁體字";
+	case GREEK_CHARSET:
+		return L"ΑΒΓαβγ";
+	case TURKISH_CHARSET:
+		return L"ĞğİıŞş";
+	case VIETNAMESE_CHARSET:
+		return L"ĂăƠơƯư₫";
+	case HEBREW_CHARSET:
+		return L"אבגשת";
+	case ARABIC_CHARSET:
+		return L"ابتعمي";
+	case BALTIC_CHARSET:
+		return L"ĀāĮįŠŽ";
+	case RUSSIAN_CHARSET:
+		return L"АБВабвЯя";
+	case THAI_CHARSET:
+		return L"กขคอฮ";
+	case EASTEUROPE_CHARSET:
+		return L"ĄąČčŁł";
+	}
+	return L"AZaz09";
+}
+
+// Ordered list of fallback fonts. Coverage of all candidates is loaded on first
+// use, selections are memoized per charset.
+struct FontFallbackChain
+{
+	static constexpr int Unknown = -2;
+	static constexpr int NoMatch = -1;
+
+	FontFallbackChain()
+	{
+		for (auto& i : charsetChoice)
+			i.store(Unknown, std::memory_order_relaxed);
+	}
+
+	bool empty() const { return names.empty(); }
+
+	// Returns name of first candidate covering all of "required", or nullptr
+	const std::wstring* Select(const CoverageSet& required) const
+	{
+		for (size_t i = 0; i < coverages.size(); ++i)
+		{
+			if (coverages[i].ContainsAll(required))
+				return &names[i];
+		}
+		return nullptr;
+	}
+
+	template <class LoadCoverage>
+	const std::wstring* SelectForCharset(BYTE charSet, LoadCoverage&& loadCoverage)
+	{
+		int choice = charsetChoice[charSet].load(std::memory_order_acquire);
+		if (choice == Unknown)
+		{
+			std::call_once(loaded, [&] {
+				coverages.resize(names.size());
+				for (size_t i = 0; i < names.size(); ++i)
+					loadCoverage(names[i], coverages[i]);
+			});
+
+			CoverageSet required = CoverageSet::FromText(GetCharsetSample(charSet));
+			required.AddText(sample);
+			auto name = Select(required);
+			choice = name ? static_cast<int>(name - names.data()) : NoMatch;
+			charsetChoice[charSet].store(choice, std::memory_order_release);
+		}
+		return choice >= 0 ? &names[choice] : nullptr;
+	}
+
+	std::vector<std::wstring> names;
+	// Text the program shows, required from every charset's choice on top of the charset's own sample
+	std::wstring sample;
+
+private:
+	std::vector<CoverageSet> coverages;
+	std::once_flag loaded;
+	std::array<std::atomic<int>, 256> charsetChoice;
+};
@@ -3,6 +3,7 @@
 constexpr std::u8string_view defConfigFile = u8""
 "style: &style\r\n"
 "# Remove '#' to override font style\r\n"
+"# Sizes are pixels, or points with pt (9pt) or pixels at 96 DPI with dip (12dip)\r\n"
 "#  size: 0\r\n"
 "#  sizeOffset: 0\r\n"
 "#  sizeScale: 1.0\r\n"
@@ -54,7 +55,39 @@ constexpr std::u8string_view defConfigFile = u8""
 "\r\n"
 "removeInternalLeading: false # Remove font internal leading (top margin)\r\n"
 "\r\n"
-"#glyphReplace:\r\n"
+"#glyphReplace: # Character code mapping for GetGlyphOutline, and for ExtTextOutW within the BMP\r\n"
 "#  65: 66         # Replace 'A' (65) with 'B' (66)\r\n"
 "\r\n"
+"#fontAliases: true # Match \"fonts\" rules by any localized, English or full name of a font\r\n"
+"\r\n"
+"#fontFallbackChain: # Fonts tried in order for missing fonts, the first one covering the charset is used\r\n"
+"#  - Segoe UI\r\n"
+"#  - Microsoft YaHei\r\n"
+"#  - Yu Gothic UI\r\n"
+"#  - Malgun Gothic\r\n"
+"#fontFallbackSample: \"中文\" # Text the chosen fallback font must also cover\r\n"
+"\r\n"
+"#latencyStats: true # Write per hook latency percentiles to FontMod.latency.txt\r\n"
+"\r\n"
+"#liveStats: true # Publish live counters in shared memory \"Local\\FontModStats.<pid>\"\r\n"
+"\r\n"
+"#ruleStats: true # Write rule hit counts and unmatched fonts to FontMod.rules.txt\r\n"
+"\r\n"
+"#fontHandleStats: true # Track fonts that are never deleted, written to FontMod.fonts.txt\r\n"
+"\r\n"
+"#enumFontCache: true # Answer repeated font enumerations from a cache\r\n"
+"#hideFonts: # Families left out of font enumeration\r\n"
+"#  - Terminal\r\n"
+"#  - Fixedsys\r\n"
+"\r\n"
+"#fontDataCache: 32 # Cache font tables read by GetFontData, budget in MB\r\n"
+"\r\n"
+"#textExtentCache: 512 # Remember text extents of up to this many strings per font\r\n"
+"\r\n"
+"#charWidthCache: true # Remember character widths per font\r\n"
+"\r\n"
+"#fontWarmup: true # Create fonts used by the last runs early, on a background thread. Profile in FontMod.warmup.txt\r\n"
+"\r\n"
+"#memoryBudget: 64 # Cap in MB on the memory of all caches above together, rarely hit caches are trimmed first\r\n"
+"\r\n"
 "debug: false\r\n";
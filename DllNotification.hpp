@@ -0,0 +1,78 @@
+#pragma once
+
+// LdrRegisterDllNotification, documented but not declared in SDK headers, and other
+// loader state.
+// https://learn.microsoft.com/en-us/windows/win32/devnotes/ldrregisterdllnotification
+
+#include <winternl.h>
+#include <psapi.h>
+
+constexpr ULONG LDR_DLL_NOTIFICATION_REASON_LOADED = 1;
+constexpr ULONG LDR_DLL_NOTIFICATION_REASON_UNLOADED = 2;
+
+struct LDR_DLL_NOTIFICATION_DATA
+{
+	ULONG Flags;
+	const UNICODE_STRING* FullDllName;
+	const UNICODE_STRING* BaseDllName;
+	PVOID DllBase;
+	ULONG SizeOfImage;
+};
+
+using LDR_DLL_NOTIFICATION_FUNCTION = VOID CALLBACK(ULONG NotificationReason, const LDR_DLL_NOTIFICATION_DATA* NotificationData, PVOID Context);
+using LdrRegisterDllNotification_t = NTSTATUS NTAPI(ULONG Flags, LDR_DLL_NOTIFICATION_FUNCTION* NotificationFunction, PVOID Context, PVOID* Cookie);
+
+inline std::wstring_view ToStringView(const UNICODE_STRING* str)
+{
+	return str && str->Buffer ? std::wstring_view(str->Buffer, str->Length / sizeof(WCHAR)) : std::wstring_view();
+}
+
+// Callback is invoked under the loader lock
+bool RegisterDllNotification(LDR_DLL_NOTIFICATION_FUNCTION* callback, PVOID context)
+{
+	auto ldrRegisterDllNotification = reinterpret_cast<LdrRegisterDllNotification_t*>(GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "LdrRegisterDllNotification"));
+	if (!ldrRegisterDllNotification)
+		return false;
+
+	PVOID cookie;
+	return ldrRegisterDllNotification(0, callback, context, &cookie) >= 0; // NT_SUCCESS
+}
+
+// Whether this thread holds the loader lock, for example in a DllMain. Read from the
+// PEB, whose LoaderLock field is undocumented but has kept its offset since Windows XP.
+inline bool IsLoaderLockHeld()
+{
+#ifdef _WIN64
+	constexpr size_t loaderLockOffset = 0x110;
+#else
+	constexpr size_t loaderLockOffset = 0xA0;
+#endif
+	auto peb = reinterpret_cast<const uint8_t*>(NtCurrentTeb()->ProcessEnvironmentBlock);
+	auto lock = *reinterpret_cast<RTL_CRITICAL_SECTION* const*>(peb + loaderLockOffset);
+	return lock && HandleToULong(lock->OwningThread) == GetCurrentThreadId();
+}
+
+// Calls "callback(base, size, name)" for every module loaded now
+template <class Callback>
+void ForEachLoadedModule(Callback&& callback)
+{
+	std::vector<HMODULE> modules(256);
+	DWORD needed;
+	while (true)
+	{
+		if (!K32EnumProcessModules(GetCurrentProcess(), modules.data(), static_cast<DWORD>(modules.size() * sizeof(HMODULE)), &needed))
+			return;
+		if (needed <= modules.size() * sizeof(HMODULE))
+			break;
+		modules.resize(needed / sizeof(HMODULE));
+	}
+	modules.resize(needed / sizeof(HMODULE));
+
+	for (auto hModule : modules)
+	{
+		MODULEINFO info;
+		WCHAR name[MAX_PATH];
+		if (K32GetModuleInformation(GetCurrentProcess(), hModule, &info, sizeof(info)) && K32GetModuleBaseNameW(GetCurrentProcess(), hModule, name, MAX_PATH))
+			callback(reinterpret_cast<uintptr_t>(info.lpBaseOfDll), static_cast<size_t>(info.SizeOfImage), std::wstring_view(name));
+	}
+}
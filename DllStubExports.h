@@ -0,0 +1,354 @@
+// Exports of the system DLLs FontMod can be loaded as, included by DllStub.hpp and
+// C preprocessed into DllStubX86.asm and DllStubArm.asm so all three stay in sync.
+//
+// DLLSTUB_DLL("name.dll") starts the exports of one DLL, DLLSTUB_EXPORT(name) is an export
+// with its own stub. Commented out names are shared with another DLL and use its stub.
+
+DLLSTUB_DLL("dinput8.dll")
+DLLSTUB_EXPORT(DirectInput8Create)
+DLLSTUB_EXPORT(DllCanUnloadNow)
+DLLSTUB_EXPORT(DllGetClassObject)
+DLLSTUB_EXPORT(DllRegisterServer)
+DLLSTUB_EXPORT(DllUnregisterServer)
+
+DLLSTUB_DLL("dinput.dll")
+DLLSTUB_EXPORT(DirectInputCreateA)
+DLLSTUB_EXPORT(DirectInputCreateEx)
+DLLSTUB_EXPORT(DirectInputCreateW)
+//DllCanUnloadNow
+//DllGetClassObject
+//DllRegisterServer
+//DllUnregisterServer
+
+DLLSTUB_DLL("dsound.dll")
+DLLSTUB_EXPORT(DirectSoundCaptureCreate)
+DLLSTUB_EXPORT(DirectSoundCaptureCreate8)
+DLLSTUB_EXPORT(DirectSoundCaptureEnumerateA)
+DLLSTUB_EXPORT(DirectSoundCaptureEnumerateW)
+DLLSTUB_EXPORT(DirectSoundCreate)
+DLLSTUB_EXPORT(DirectSoundCreate8)
+DLLSTUB_EXPORT(DirectSoundEnumerateA)
+DLLSTUB_EXPORT(DirectSoundEnumerateW)
+DLLSTUB_EXPORT(DirectSoundFullDuplexCreate)
+//DllCanUnloadNow
+//DllGetClassObject
+DLLSTUB_EXPORT(GetDeviceID)
+
+#ifndef _WIN64 // 32 bit only
+DLLSTUB_DLL("d3d8.dll")
+//DebugSetMute
+DLLSTUB_EXPORT(Direct3D8EnableMaximizedWindowedModeShim)
+DLLSTUB_EXPORT(Direct3DCreate8)
+DLLSTUB_EXPORT(ValidatePixelShader)
+DLLSTUB_EXPORT(ValidateVertexShader)
+#endif
+
+DLLSTUB_DLL("d3d9.dll")
+DLLSTUB_EXPORT(D3DPERF_BeginEvent)
+DLLSTUB_EXPORT(D3DPERF_EndEvent)
+DLLSTUB_EXPORT(D3DPERF_GetStatus)
+DLLSTUB_EXPORT(D3DPERF_QueryRepeatFrame)
+DLLSTUB_EXPORT(D3DPERF_SetMarker)
+DLLSTUB_EXPORT(D3DPERF_SetOptions)
+DLLSTUB_EXPORT(D3DPERF_SetRegion)
+DLLSTUB_EXPORT(DebugSetLevel)
+DLLSTUB_EXPORT(DebugSetMute)
+DLLSTUB_EXPORT(Direct3D9EnableMaximizedWindowedModeShim)
+DLLSTUB_EXPORT(Direct3DCreate9)
+DLLSTUB_EXPORT(Direct3DCreate9Ex)
+DLLSTUB_EXPORT(Direct3DShaderValidatorCreate9)
+DLLSTUB_EXPORT(PSGPError)
+DLLSTUB_EXPORT(PSGPSampleTexture)
+
+DLLSTUB_DLL("d3d11.dll")
+DLLSTUB_EXPORT(D3D11CoreCreateDevice)
+DLLSTUB_EXPORT(D3D11CoreCreateLayeredDevice)
+DLLSTUB_EXPORT(D3D11CoreGetLayeredDeviceSize)
+DLLSTUB_EXPORT(D3D11CoreRegisterLayers)
+DLLSTUB_EXPORT(D3D11CreateDevice)
+DLLSTUB_EXPORT(D3D11CreateDeviceAndSwapChain)
+DLLSTUB_EXPORT(D3DKMTCloseAdapter)
+DLLSTUB_EXPORT(D3DKMTCreateAllocation)
+DLLSTUB_EXPORT(D3DKMTCreateContext)
+DLLSTUB_EXPORT(D3DKMTCreateDevice)
+DLLSTUB_EXPORT(D3DKMTCreateSynchronizationObject)
+DLLSTUB_EXPORT(D3DKMTDestroyAllocation)
+DLLSTUB_EXPORT(D3DKMTDestroyContext)
+DLLSTUB_EXPORT(D3DKMTDestroyDevice)
+DLLSTUB_EXPORT(D3DKMTDestroySynchronizationObject)
+DLLSTUB_EXPORT(D3DKMTEscape)
+DLLSTUB_EXPORT(D3DKMTGetContextSchedulingPriority)
+DLLSTUB_EXPORT(D3DKMTGetDeviceState)
+DLLSTUB_EXPORT(D3DKMTGetDisplayModeList)
+DLLSTUB_EXPORT(D3DKMTGetMultisampleMethodList)
+DLLSTUB_EXPORT(D3DKMTGetRuntimeData)
+DLLSTUB_EXPORT(D3DKMTGetSharedPrimaryHandle)
+DLLSTUB_EXPORT(D3DKMTLock)
+DLLSTUB_EXPORT(D3DKMTOpenAdapterFromHdc)
+DLLSTUB_EXPORT(D3DKMTOpenResource)
+DLLSTUB_EXPORT(D3DKMTPresent)
+DLLSTUB_EXPORT(D3DKMTQueryAdapterInfo)
+DLLSTUB_EXPORT(D3DKMTQueryAllocationResidency)
+DLLSTUB_EXPORT(D3DKMTQueryResourceInfo)
+DLLSTUB_EXPORT(D3DKMTRender)
+DLLSTUB_EXPORT(D3DKMTSetAllocationPriority)
+DLLSTUB_EXPORT(D3DKMTSetContextSchedulingPriority)
+DLLSTUB_EXPORT(D3DKMTSetDisplayMode)
+DLLSTUB_EXPORT(D3DKMTSetDisplayPrivateDriverFormat)
+DLLSTUB_EXPORT(D3DKMTSetGammaRamp)
+DLLSTUB_EXPORT(D3DKMTSetVidPnSourceOwner)
+DLLSTUB_EXPORT(D3DKMTSignalSynchronizationObject)
+DLLSTUB_EXPORT(D3DKMTUnlock)
+DLLSTUB_EXPORT(D3DKMTWaitForSynchronizationObject)
+DLLSTUB_EXPORT(D3DKMTWaitForVerticalBlankEvent)
+DLLSTUB_EXPORT(D3DPerformance_BeginEvent)
+DLLSTUB_EXPORT(D3DPerformance_EndEvent)
+DLLSTUB_EXPORT(D3DPerformance_GetStatus)
+DLLSTUB_EXPORT(D3DPerformance_SetMarker)
+DLLSTUB_EXPORT(EnableFeatureLevelUpgrade)
+DLLSTUB_EXPORT(OpenAdapter10)
+DLLSTUB_EXPORT(OpenAdapter10_2)
+
+DLLSTUB_DLL("ddraw.dll")
+DLLSTUB_EXPORT(AcquireDDThreadLock)
+DLLSTUB_EXPORT(CompleteCreateSysmemSurface)
+DLLSTUB_EXPORT(D3DParseUnknownCommand)
+DLLSTUB_EXPORT(DDGetAttachedSurfaceLcl)
+DLLSTUB_EXPORT(DDInternalLock)
+DLLSTUB_EXPORT(DDInternalUnlock)
+DLLSTUB_EXPORT(DSoundHelp)
+DLLSTUB_EXPORT(DirectDrawCreate)
+DLLSTUB_EXPORT(DirectDrawCreateClipper)
+DLLSTUB_EXPORT(DirectDrawCreateEx)
+DLLSTUB_EXPORT(DirectDrawEnumerateA)
+DLLSTUB_EXPORT(DirectDrawEnumerateExA)
+DLLSTUB_EXPORT(DirectDrawEnumerateExW)
+DLLSTUB_EXPORT(DirectDrawEnumerateW)
+//DllCanUnloadNow
+//DllGetClassObject
+DLLSTUB_EXPORT(GetDDSurfaceLocal)
+DLLSTUB_EXPORT(GetOLEThunkData)
+DLLSTUB_EXPORT(GetSurfaceFromDC)
+DLLSTUB_EXPORT(RegisterSpecialCase)
+DLLSTUB_EXPORT(ReleaseDDThreadLock)
+DLLSTUB_EXPORT(SetAppCompatData)
+
+DLLSTUB_DLL("winmm.dll")
+DLLSTUB_EXPORT(CloseDriver)
+DLLSTUB_EXPORT(DefDriverProc)
+DLLSTUB_EXPORT(DriverCallback)
+DLLSTUB_EXPORT(DrvGetModuleHandle)
+DLLSTUB_EXPORT(GetDriverModuleHandle)
+DLLSTUB_EXPORT(NotifyCallbackData)
+DLLSTUB_EXPORT(OpenDriver)
+DLLSTUB_EXPORT(PlaySound)
+DLLSTUB_EXPORT(PlaySoundA)
+DLLSTUB_EXPORT(PlaySoundW)
+DLLSTUB_EXPORT(SendDriverMessage)
+DLLSTUB_EXPORT(WOW32DriverCallback)
+DLLSTUB_EXPORT(WOW32ResolveMultiMediaHandle)
+DLLSTUB_EXPORT(WOWAppExit)
+DLLSTUB_EXPORT(aux32Message)
+DLLSTUB_EXPORT(auxGetDevCapsA)
+DLLSTUB_EXPORT(auxGetDevCapsW)
+DLLSTUB_EXPORT(auxGetNumDevs)
+DLLSTUB_EXPORT(auxGetVolume)
+DLLSTUB_EXPORT(auxOutMessage)
+DLLSTUB_EXPORT(auxSetVolume)
+DLLSTUB_EXPORT(joy32Message)
+DLLSTUB_EXPORT(joyConfigChanged)
+DLLSTUB_EXPORT(joyGetDevCapsA)
+DLLSTUB_EXPORT(joyGetDevCapsW)
+DLLSTUB_EXPORT(joyGetNumDevs)
+DLLSTUB_EXPORT(joyGetPos)
+DLLSTUB_EXPORT(joyGetPosEx)
+DLLSTUB_EXPORT(joyGetThreshold)
+DLLSTUB_EXPORT(joyReleaseCapture)
+DLLSTUB_EXPORT(joySetCapture)
+DLLSTUB_EXPORT(joySetThreshold)
+DLLSTUB_EXPORT(mci32Message)
+DLLSTUB_EXPORT(mciDriverNotify)
+DLLSTUB_EXPORT(mciDriverYield)
+DLLSTUB_EXPORT(mciExecute)
+DLLSTUB_EXPORT(mciFreeCommandResource)
+DLLSTUB_EXPORT(mciGetCreatorTask)
+DLLSTUB_EXPORT(mciGetDeviceIDA)
+DLLSTUB_EXPORT(mciGetDeviceIDFromElementIDA)
+DLLSTUB_EXPORT(mciGetDeviceIDFromElementIDW)
+DLLSTUB_EXPORT(mciGetDeviceIDW)
+DLLSTUB_EXPORT(mciGetDriverData)
+DLLSTUB_EXPORT(mciGetErrorStringA)
+DLLSTUB_EXPORT(mciGetErrorStringW)
+DLLSTUB_EXPORT(mciGetYieldProc)
+DLLSTUB_EXPORT(mciLoadCommandResource)
+DLLSTUB_EXPORT(mciSendCommandA)
+DLLSTUB_EXPORT(mciSendCommandW)
+DLLSTUB_EXPORT(mciSendStringA)
+DLLSTUB_EXPORT(mciSendStringW)
+DLLSTUB_EXPORT(mciSetDriverData)
+DLLSTUB_EXPORT(mciSetYieldProc)
+DLLSTUB_EXPORT(mid32Message)
+DLLSTUB_EXPORT(midiConnect)
+DLLSTUB_EXPORT(midiDisconnect)
+DLLSTUB_EXPORT(midiInAddBuffer)
+DLLSTUB_EXPORT(midiInClose)
+DLLSTUB_EXPORT(midiInGetDevCapsA)
+DLLSTUB_EXPORT(midiInGetDevCapsW)
+DLLSTUB_EXPORT(midiInGetErrorTextA)
+DLLSTUB_EXPORT(midiInGetErrorTextW)
+DLLSTUB_EXPORT(midiInGetID)
+DLLSTUB_EXPORT(midiInGetNumDevs)
+DLLSTUB_EXPORT(midiInMessage)
+DLLSTUB_EXPORT(midiInOpen)
+DLLSTUB_EXPORT(midiInPrepareHeader)
+DLLSTUB_EXPORT(midiInReset)
+DLLSTUB_EXPORT(midiInStart)
+DLLSTUB_EXPORT(midiInStop)
+DLLSTUB_EXPORT(midiInUnprepareHeader)
+DLLSTUB_EXPORT(midiOutCacheDrumPatches)
+DLLSTUB_EXPORT(midiOutCachePatches)
+DLLSTUB_EXPORT(midiOutClose)
+DLLSTUB_EXPORT(midiOutGetDevCapsA)
+DLLSTUB_EXPORT(midiOutGetDevCapsW)
+DLLSTUB_EXPORT(midiOutGetErrorTextA)
+DLLSTUB_EXPORT(midiOutGetErrorTextW)
+DLLSTUB_EXPORT(midiOutGetID)
+DLLSTUB_EXPORT(midiOutGetNumDevs)
+DLLSTUB_EXPORT(midiOutGetVolume)
+DLLSTUB_EXPORT(midiOutLongMsg)
+DLLSTUB_EXPORT(midiOutMessage)
+DLLSTUB_EXPORT(midiOutOpen)
+DLLSTUB_EXPORT(midiOutPrepareHeader)
+DLLSTUB_EXPORT(midiOutReset)
+DLLSTUB_EXPORT(midiOutSetVolume)
+DLLSTUB_EXPORT(midiOutShortMsg)
+DLLSTUB_EXPORT(midiOutUnprepareHeader)
+DLLSTUB_EXPORT(midiStreamClose)
+DLLSTUB_EXPORT(midiStreamOpen)
+DLLSTUB_EXPORT(midiStreamOut)
+DLLSTUB_EXPORT(midiStreamPause)
+DLLSTUB_EXPORT(midiStreamPosition)
+DLLSTUB_EXPORT(midiStreamProperty)
+DLLSTUB_EXPORT(midiStreamRestart)
+DLLSTUB_EXPORT(midiStreamStop)
+DLLSTUB_EXPORT(mixerClose)
+DLLSTUB_EXPORT(mixerGetControlDetailsA)
+DLLSTUB_EXPORT(mixerGetControlDetailsW)
+DLLSTUB_EXPORT(mixerGetDevCapsA)
+DLLSTUB_EXPORT(mixerGetDevCapsW)
+DLLSTUB_EXPORT(mixerGetID)
+DLLSTUB_EXPORT(mixerGetLineControlsA)
+DLLSTUB_EXPORT(mixerGetLineControlsW)
+DLLSTUB_EXPORT(mixerGetLineInfoA)
+DLLSTUB_EXPORT(mixerGetLineInfoW)
+DLLSTUB_EXPORT(mixerGetNumDevs)
+DLLSTUB_EXPORT(mixerMessage)
+DLLSTUB_EXPORT(mixerOpen)
+DLLSTUB_EXPORT(mixerSetControlDetails)
+DLLSTUB_EXPORT(mmDrvInstall)
+DLLSTUB_EXPORT(mmGetCurrentTask)
+DLLSTUB_EXPORT(mmTaskBlock)
+DLLSTUB_EXPORT(mmTaskCreate)
+DLLSTUB_EXPORT(mmTaskSignal)
+DLLSTUB_EXPORT(mmTaskYield)
+DLLSTUB_EXPORT(mmioAdvance)
+DLLSTUB_EXPORT(mmioAscend)
+DLLSTUB_EXPORT(mmioClose)
+DLLSTUB_EXPORT(mmioCreateChunk)
+DLLSTUB_EXPORT(mmioDescend)
+DLLSTUB_EXPORT(mmioFlush)
+DLLSTUB_EXPORT(mmioGetInfo)
+DLLSTUB_EXPORT(mmioInstallIOProcA)
+DLLSTUB_EXPORT(mmioInstallIOProcW)
+DLLSTUB_EXPORT(mmioOpenA)
+DLLSTUB_EXPORT(mmioOpenW)
+DLLSTUB_EXPORT(mmioRead)
+DLLSTUB_EXPORT(mmioRenameA)
+DLLSTUB_EXPORT(mmioRenameW)
+DLLSTUB_EXPORT(mmioSeek)
+DLLSTUB_EXPORT(mmioSendMessage)
+DLLSTUB_EXPORT(mmioSetBuffer)
+DLLSTUB_EXPORT(mmioSetInfo)
+DLLSTUB_EXPORT(mmioStringToFOURCCA)
+DLLSTUB_EXPORT(mmioStringToFOURCCW)
+DLLSTUB_EXPORT(mmioWrite)
+DLLSTUB_EXPORT(mmsystemGetVersion)
+DLLSTUB_EXPORT(mod32Message)
+DLLSTUB_EXPORT(mxd32Message)
+DLLSTUB_EXPORT(sndPlaySoundA)
+DLLSTUB_EXPORT(sndPlaySoundW)
+DLLSTUB_EXPORT(tid32Message)
+DLLSTUB_EXPORT(timeBeginPeriod)
+DLLSTUB_EXPORT(timeEndPeriod)
+DLLSTUB_EXPORT(timeGetDevCaps)
+DLLSTUB_EXPORT(timeGetSystemTime)
+DLLSTUB_EXPORT(timeGetTime)
+DLLSTUB_EXPORT(timeKillEvent)
+DLLSTUB_EXPORT(timeSetEvent)
+DLLSTUB_EXPORT(waveInAddBuffer)
+DLLSTUB_EXPORT(waveInClose)
+DLLSTUB_EXPORT(waveInGetDevCapsA)
+DLLSTUB_EXPORT(waveInGetDevCapsW)
+DLLSTUB_EXPORT(waveInGetErrorTextA)
+DLLSTUB_EXPORT(waveInGetErrorTextW)
+DLLSTUB_EXPORT(waveInGetID)
+DLLSTUB_EXPORT(waveInGetNumDevs)
+DLLSTUB_EXPORT(waveInGetPosition)
+DLLSTUB_EXPORT(waveInMessage)
+DLLSTUB_EXPORT(waveInOpen)
+DLLSTUB_EXPORT(waveInPrepareHeader)
+DLLSTUB_EXPORT(waveInReset)
+DLLSTUB_EXPORT(waveInStart)
+DLLSTUB_EXPORT(waveInStop)
+DLLSTUB_EXPORT(waveInUnprepareHeader)
+DLLSTUB_EXPORT(waveOutBreakLoop)
+DLLSTUB_EXPORT(waveOutClose)
+DLLSTUB_EXPORT(waveOutGetDevCapsA)
+DLLSTUB_EXPORT(waveOutGetDevCapsW)
+DLLSTUB_EXPORT(waveOutGetErrorTextA)
+DLLSTUB_EXPORT(waveOutGetErrorTextW)
+DLLSTUB_EXPORT(waveOutGetID)
+DLLSTUB_EXPORT(waveOutGetNumDevs)
+DLLSTUB_EXPORT(waveOutGetPitch)
+DLLSTUB_EXPORT(waveOutGetPlaybackRate)
+DLLSTUB_EXPORT(waveOutGetPosition)
+DLLSTUB_EXPORT(waveOutGetVolume)
+DLLSTUB_EXPORT(waveOutMessage)
+DLLSTUB_EXPORT(waveOutOpen)
+DLLSTUB_EXPORT(waveOutPause)
+DLLSTUB_EXPORT(waveOutPrepareHeader)
+DLLSTUB_EXPORT(waveOutReset)
+DLLSTUB_EXPORT(waveOutRestart)
+DLLSTUB_EXPORT(waveOutSetPitch)
+DLLSTUB_EXPORT(waveOutSetPlaybackRate)
+DLLSTUB_EXPORT(waveOutSetVolume)
+DLLSTUB_EXPORT(waveOutUnprepareHeader)
+DLLSTUB_EXPORT(waveOutWrite)
+DLLSTUB_EXPORT(wid32Message)
+DLLSTUB_EXPORT(wod32Message)
+
+DLLSTUB_DLL("version.dll")
+DLLSTUB_EXPORT(GetFileVersionInfoA)
+DLLSTUB_EXPORT(GetFileVersionInfoByHandle)
+DLLSTUB_EXPORT(GetFileVersionInfoExA)
+DLLSTUB_EXPORT(GetFileVersionInfoExW)
+DLLSTUB_EXPORT(GetFileVersionInfoSizeA)
+DLLSTUB_EXPORT(GetFileVersionInfoSizeExA)
+DLLSTUB_EXPORT(GetFileVersionInfoSizeExW)
+DLLSTUB_EXPORT(GetFileVersionInfoSizeW)
+DLLSTUB_EXPORT(GetFileVersionInfoW)
+DLLSTUB_EXPORT(VerFindFileA)
+DLLSTUB_EXPORT(VerFindFileW)
+DLLSTUB_EXPORT(VerInstallFileA)
+DLLSTUB_EXPORT(VerInstallFileW)
+DLLSTUB_EXPORT(VerLanguageNameA)
+DLLSTUB_EXPORT(VerLanguageNameW)
+DLLSTUB_EXPORT(VerQueryValueA)
+DLLSTUB_EXPORT(VerQueryValueW)
+
+DLLSTUB_DLL("msimg32.dll")
+DLLSTUB_EXPORT(AlphaBlend)
+DLLSTUB_EXPORT(DllInitialize)
+DLLSTUB_EXPORT(GradientFill)
+DLLSTUB_EXPORT(TransparentBlt)
+DLLSTUB_EXPORT(vSetDdrawflag)
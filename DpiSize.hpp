@@ -0,0 +1,138 @@
+#pragma once
+
+// Sizes of "fonts" rules given in points or in pixels at 96 DPI ("9pt", "12dip") next to
+// plain pixels, and the per thread DPI cache they are resolved with. No Windows types, so
+// the math and the cache can be checked on any platform.
+//
+// Points set the character height as Windows does, -MulDiv(pt, dpi, 72), so "size: 9pt"
+// is a negative lfHeight. DIPs keep their sign like pixels, "size: -12dip" is a 12 pixel
+// character height at 96 DPI. Offsets in either unit grow with the DPI.
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+
+enum struct SizeUnit : uint8_t
+{
+	Pixel,
+	Point,
+	Dip
+};
+
+constexpr uint32_t DefaultDpi = 96;
+
+// Sizes per DPI are counted in 1/288 of a pixel per DPI, a common multiple of points and
+// DIPs, so whole and half sizes resolve without floating point error
+constexpr double DpiUnits = 288;
+
+struct ScaledSize
+{
+	double value = 0;
+	SizeUnit unit = SizeUnit::Pixel;
+
+	bool DpiRelative() const
+	{
+		return unit != SizeUnit::Pixel && value != 0;
+	}
+
+	// As an offset in DpiUnits
+	double OffsetPerDpi() const
+	{
+		return unit == SizeUnit::Point ? value * (DpiUnits / 72) : unit == SizeUnit::Dip ? value * (DpiUnits / DefaultDpi) : 0;
+	}
+
+	// Same as OffsetPerDpi, with the sign of a height in points
+	double HeightPerDpi() const
+	{
+		return unit == SizeUnit::Point ? -OffsetPerDpi() : OffsetPerDpi();
+	}
+
+	long Pixels() const
+	{
+		return std::lround(value);
+	}
+};
+
+// Pixels of a size per DPI, rounded half away from zero like MulDiv
+inline long ResolveDpi(double perDpi, uint32_t dpi)
+{
+	return std::lround(perDpi * dpi / DpiUnits);
+}
+
+// "12", "-12", "+2", "9pt", "10.5pt", "12dip". Pixels must be whole, as before units existed.
+inline bool ParseScaledSize(std::string_view text, ScaledSize& size)
+{
+	// YAML integers may have a plus sign, from_chars takes none
+	if (text.starts_with('+') && !text.starts_with("+-"))
+		text.remove_prefix(1);
+
+	ScaledSize s;
+	if (text.ends_with("pt"))
+	{
+		s.unit = SizeUnit::Point;
+		text.remove_suffix(2);
+	}
+	else if (text.ends_with("dip"))
+	{
+		s.unit = SizeUnit::Dip;
+		text.remove_suffix(3);
+	}
+
+	const char* end = text.data() + text.size();
+	if (s.unit == SizeUnit::Pixel)
+	{
+		long pixels = 0;
+		auto [next, ec] = std::from_chars(text.data(), end, pixels);
+		if (ec != std::errc() || next != end)
+			return false;
+		s.value = double(pixels);
+	}
+	else
+	{
+		auto [next, ec] = std::from_chars(text.data(), end, s.value);
+		if (ec != std::errc() || next != end || !std::isfinite(s.value) || std::abs(s.value) > 10000)
+			return false;
+	}
+	size = s;
+	return true;
+}
+
+// DPI of one thread. Looked up again when the thread's DPI awareness context is not the
+// one it was looked up for, or after a DPI change notification dropped it. A lookup the
+// query marks as provisional (a thread without windows yet, whose DPI may change once it
+// has one) is kept until "RetryInterval" has passed, so such threads don't look it up on
+// every call. "now" is in milliseconds from any origin.
+template <class Context>
+struct DpiCache
+{
+	static constexpr uint64_t RetryInterval = 500;
+
+	// "query(final)" returns the DPI, and clears "final" if it is provisional
+	template <class Query>
+	uint32_t Get(Context current, uint64_t now, Query&& query)
+	{
+		if (dpi == 0 || current != context || (retryAt && now >= retryAt))
+		{
+			context = current;
+			bool final = true;
+			dpi = query(final);
+			if (dpi == 0)
+				dpi = DefaultDpi;
+			retryAt = final ? 0 : std::max<uint64_t>(now + RetryInterval, 1);
+		}
+		return dpi;
+	}
+
+	// A notification carrying the new DPI, 0 to look it up on next use
+	void Changed(uint32_t newDpi)
+	{
+		dpi = newDpi;
+		retryAt = 0;
+	}
+
+	Context context = {};
+	uint32_t dpi = 0;
+	uint64_t retryAt = 0; // When a provisional DPI is looked up again, 0 if final
+};
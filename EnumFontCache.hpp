@@ -0,0 +1,269 @@
+#pragma once
+
+// Results of EnumFontFamiliesExW recorded per query and replayed to later identical
+// queries, and families hidden from enumeration. Only display DCs are cached. The
+// cache is dropped when fonts are added or removed in this process, or when the
+// system or user font registry keys change.
+
+#include <shared_mutex>
+#include <unordered_set>
+
+struct EnumFontCache
+{
+	struct Entry
+	{
+		ENUMLOGFONTEXDVW elf; // Only the ENUMLOGFONTEXW part is recorded, no design vector
+		NEWTEXTMETRICEXW ntm; // Only TEXTMETRICW for non-TrueType fonts
+		DWORD fontType;
+	};
+	using Entries = std::vector<Entry>;
+
+	bool cacheEnabled = false;
+
+	bool HasHidden() const
+	{
+		return !hidden.empty();
+	}
+
+	// Config time
+	void Hide(std::wstring_view face)
+	{
+		hidden.insert(Lower(face));
+	}
+
+	// Vertical "@" variants are hidden with their family
+	bool IsHidden(const WCHAR* face) const
+	{
+		if (hidden.empty())
+			return false;
+		if (*face == L'@')
+			++face;
+		return hidden.contains(Lower(face));
+	}
+
+	// Config time, after "memoryBudget" is read
+	void UseMemoryBudget()
+	{
+		budgetId = memoryBudget.Register("enumFontCache", [this] { return hits.load(std::memory_order_relaxed); }, [this](size_t bytes) { return Trim(bytes); });
+	}
+
+	void Invalidate()
+	{
+		std::unique_lock lock(mutex);
+		queries.clear();
+		memoryBudget.Remove(budgetId, used);
+		used = 0;
+		++generation;
+	}
+
+	// "replay" runs the callbacks of a cached list, so the hook can time the program's
+	// callbacks apart from FontMod, as they are when the original function calls them
+	template <class Original, class Replay>
+	int Enumerate(HDC hdc, LOGFONTW* lf, FONTENUMPROCW proc, LPARAM lParam, DWORD flags, Original original, Replay replay)
+	{
+		if (!lf || !proc)
+			return original(hdc, lf, proc, lParam, flags);
+		if (IsHidden(lf->lfFaceName))
+			return 1;
+		if (!cacheEnabled || GetDeviceCaps(hdc, TECHNOLOGY) != DT_RASDISPLAY)
+			return hidden.empty() ? original(hdc, lf, proc, lParam, flags) : EnumerateFiltered(hdc, lf, proc, lParam, flags, original);
+
+		CheckRegistry();
+
+		Key key{ Lower(lf->lfFaceName), lf->lfCharSet, lf->lfPitchAndFamily, flags };
+		std::shared_ptr<const Entries> entries;
+		uint64_t startGeneration;
+		{
+			std::shared_lock lock(mutex);
+			startGeneration = generation;
+			if (auto it = queries.find(key); it != queries.end())
+				entries = it->second;
+		}
+
+		if (entries)
+		{
+			liveStats.Add(LiveCounter::EnumCacheHits);
+			hits.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			liveStats.Add(LiveCounter::EnumCacheMisses);
+			auto recorded = std::make_shared<Entries>();
+			Record record{ this, recorded.get() };
+			original(hdc, lf, RecordProc, reinterpret_cast<LPARAM>(&record), flags);
+
+			entries = recorded;
+			bool overBudget = false;
+			{
+				std::unique_lock lock(mutex);
+				if (generation == startGeneration) // Fonts changed while recording, don't keep the stale list
+				{
+					auto [it, inserted] = queries.try_emplace(std::move(key), std::move(recorded));
+					if (inserted)
+					{
+						const size_t bytes = QueryBytes(*it);
+						used += bytes;
+						overBudget = memoryBudget.Add(budgetId, bytes);
+					}
+				}
+			}
+			if (overBudget)
+				memoryBudget.Enforce();
+		}
+
+		// Same as GDI, the result is the last callback result
+		return replay([&] {
+			int result = 1;
+			for (const auto& e : *entries)
+			{
+				result = proc(&e.elf.elfEnumLogfontEx.elfLogFont, reinterpret_cast<const TEXTMETRICW*>(&e.ntm), e.fontType, lParam);
+				if (!result)
+					break;
+			}
+			return result;
+		});
+	}
+
+private:
+	struct Key
+	{
+		std::wstring face;
+		BYTE charSet;
+		BYTE pitchAndFamily;
+		DWORD flags;
+
+		bool operator==(const Key&) const = default;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& k) const noexcept
+		{
+			return std::hash<std::wstring>()(k.face) ^ (size_t(k.charSet) << 8 | size_t(k.pitchAndFamily) << 16 | size_t(k.flags) << 24);
+		}
+	};
+
+	using Queries = std::unordered_map<Key, std::shared_ptr<const Entries>, KeyHash>;
+
+	// Map node included, roughly
+	static size_t QueryBytes(const Queries::value_type& query)
+	{
+		return sizeof(query) + query.first.face.size() * sizeof(WCHAR) + query.second->size() * sizeof(Entry) + 8 * sizeof(void*);
+	}
+
+	size_t Trim(size_t bytes)
+	{
+		std::unique_lock lock(mutex);
+		size_t freed = 0;
+		while (freed < bytes && !queries.empty())
+		{
+			const size_t n = QueryBytes(*queries.begin());
+			queries.erase(queries.begin());
+			memoryBudget.Remove(budgetId, n);
+			used -= n;
+			freed += n;
+		}
+		return freed;
+	}
+
+	struct Record
+	{
+		const EnumFontCache* cache;
+		Entries* entries;
+	};
+
+	struct Filter
+	{
+		const EnumFontCache* cache;
+		FONTENUMPROCW proc;
+		LPARAM lParam;
+	};
+
+	template <class Original>
+	int EnumerateFiltered(HDC hdc, LOGFONTW* lf, FONTENUMPROCW proc, LPARAM lParam, DWORD flags, Original original)
+	{
+		Filter filter{ this, proc, lParam };
+		return original(hdc, lf, FilterProc, reinterpret_cast<LPARAM>(&filter), flags);
+	}
+
+	static int CALLBACK RecordProc(const LOGFONTW* lpelfe, const TEXTMETRICW* lpntme, DWORD fontType, LPARAM lParam)
+	{
+		auto& record = *reinterpret_cast<Record*>(lParam);
+		if (record.cache->IsHidden(lpelfe->lfFaceName))
+			return 1;
+
+		auto& e = record.entries->emplace_back(); // Zero filled
+		memcpy(&e.elf, lpelfe, sizeof(ENUMLOGFONTEXW));
+		memcpy(&e.ntm, lpntme, (fontType & TRUETYPE_FONTTYPE) ? sizeof(NEWTEXTMETRICEXW) : sizeof(TEXTMETRICW));
+		e.fontType = fontType;
+		return 1;
+	}
+
+	static int CALLBACK FilterProc(const LOGFONTW* lpelfe, const TEXTMETRICW* lpntme, DWORD fontType, LPARAM lParam)
+	{
+		auto& filter = *reinterpret_cast<Filter*>(lParam);
+		return filter.cache->IsHidden(lpelfe->lfFaceName) ? 1 : filter.proc(lpelfe, lpntme, fontType, filter.lParam);
+	}
+
+	// Installed fonts are listed in these keys, a change notification drops the cache
+	void CheckRegistry()
+	{
+		std::call_once(registryWatched, [this] {
+			constexpr auto fontsKey = L"Software\\Microsoft\\Windows NT\\CurrentVersion\\Fonts";
+			int i = 0;
+			for (HKEY root : { HKEY_LOCAL_MACHINE, HKEY_CURRENT_USER })
+			{
+				auto& watch = watches[i++];
+				if (RegOpenKeyExW(root, fontsKey, 0, KEY_NOTIFY, &watch.key) != ERROR_SUCCESS)
+					continue;
+				watch.event.reset(CreateEventW(nullptr, FALSE, FALSE, nullptr));
+				if (watch.event)
+					Arm(watch);
+			}
+		});
+
+		for (auto& watch : watches)
+		{
+			if (watch.event && WaitForSingleObject(watch.event.get(), 0) == WAIT_OBJECT_0)
+			{
+				Invalidate();
+				Arm(watch); // Auto-reset event, only one thread gets here per change
+			}
+		}
+	}
+
+	struct Watch
+	{
+		HKEY key = nullptr;
+		wil::unique_event_nothrow event;
+	};
+
+	static void Arm(Watch& watch)
+	{
+		// Thread agnostic, the notification must outlive the calling thread
+		RegNotifyChangeKeyValue(watch.key, FALSE, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC, watch.event.get(), TRUE);
+	}
+
+	static std::wstring Lower(std::wstring_view s)
+	{
+		std::wstring result(s);
+		if (!result.empty())
+			CharLowerBuffW(result.data(), static_cast<DWORD>(result.size()));
+		return result;
+	}
+
+	std::unordered_set<std::wstring> hidden;
+
+	std::shared_mutex mutex;
+	Queries queries;
+	size_t used = 0; // Bytes of all queries, for the memory budget
+	uint64_t generation = 0; // Counts invalidations
+	MemoryBudget::Id budgetId = MemoryBudget::NoId;
+	std::atomic<uint64_t> hits = 0;
+
+	std::once_flag registryWatched;
+	Watch watches[2];
+};
+
+// Never destroyed, hooks may still use it during unload
+EnumFontCache& enumFontCache = *new EnumFontCache;
@@ -0,0 +1,508 @@
+#pragma once
+
+// Wildcard ("MS *") and regex ("^Arial( Narrow)?$") face name rules. All patterns
+// are compiled into one DFA over case-folded UTF-16, so a lookup is a single pass
+// over the face name and returns the first matching pattern in config order.
+//
+// Supported regex syntax: literals, ".", "[...]" (ranges and "^" negation),
+// "(...)", "|", "*", "+", "?", "\" escapes, and "^" / "$" anchors at pattern ends.
+
+#include <set>
+
+struct FacePatternSet
+{
+	static constexpr uint32_t npos = UINT32_MAX;
+	static constexpr size_t MaxDfaStates = 8192;
+
+	// Keys containing "*" or "?" are wildcards, keys starting with "^" are regex
+	static bool IsPattern(std::wstring_view key)
+	{
+		return (!key.empty() && key[0] == L'^') || key.find_first_of(L"*?") != key.npos;
+	}
+
+	bool empty() const { return patterns.empty(); }
+	size_t size() const { return patterns.size(); }
+
+	// Adds a pattern, its id is the number of patterns added before it
+	bool Add(std::wstring_view key, std::wstring& errMsg)
+	{
+		std::wstring regex;
+		if (key[0] == L'^')
+		{
+			regex = key;
+		}
+		else
+		{
+			// Leading and trailing "*" become unanchored ends, which keeps the DFA small
+			const bool anyPrefix = key.front() == L'*', anySuffix = key.back() == L'*';
+			key = key.substr(anyPrefix);
+			if (anySuffix && !key.empty())
+				key.remove_suffix(1);
+
+			if (!anyPrefix)
+				regex = L"^";
+			for (wchar_t c : key)
+			{
+				if (c == L'*')
+					regex.append(L".*");
+				else if (c == L'?')
+					regex.push_back(L'.');
+				else
+				{
+					if (wcschr(L"\\.[]()|+^$", c))
+						regex.push_back(L'\\');
+					regex.push_back(c);
+				}
+			}
+			if (!anySuffix)
+				regex.push_back(L'$');
+		}
+
+		if (anyPrefix.start == npos)
+		{
+			// Shared by all patterns without "^", so DFA states don't track one loop per pattern
+			anyPrefix = Parser{ *this, {} }.Star(CharSet({ { L'\0', L'\xFFFF' } }, false));
+			for (auto i = anyPrefix.start; i < nfa.size(); ++i)
+				nfa[i].pattern = 0;
+		}
+
+		const auto firstState = static_cast<uint32_t>(nfa.size());
+		Parser parser{ *this, regex };
+		Frag frag;
+		if (!parser.Parse(frag))
+		{
+			errMsg.append(std::format(L"Invalid font name pattern \"{}\" at {}.\n", regex, parser.pos));
+			return false;
+		}
+
+		const auto id = static_cast<uint32_t>(patterns.size());
+		for (auto i = firstState; i < nfa.size(); ++i)
+			nfa[i].pattern = id;
+		nfa[frag.end].match = id;
+		patterns.push_back(frag.start);
+		return true;
+	}
+
+	// Builds the combined DFA. Patterns can't be added afterwards.
+	bool Compile(std::wstring& errMsg)
+	{
+		// Partition UTF-16 into classes of code units no pattern distinguishes
+		std::set<uint32_t> bounds = { 0, 0x10000 };
+		for (const auto& state : nfa)
+		{
+			for (const auto& [lo, hi] : state.ranges)
+			{
+				bounds.insert(lo);
+				bounds.insert(hi + 1u);
+			}
+		}
+		std::vector<uint32_t> classStart(bounds.begin(), bounds.end());
+		classStart.pop_back();
+		numClasses = classStart.size();
+
+		const auto& fold = FoldTable();
+		classOf.resize(0x10000);
+		std::vector<uint16_t> foldedClass(0x10000);
+		for (size_t k = 0; k < numClasses; ++k)
+		{
+			const uint32_t end = k + 1 < numClasses ? classStart[k + 1] : 0x10000;
+			for (uint32_t c = classStart[k]; c < end; ++c)
+				foldedClass[c] = static_cast<uint16_t>(k);
+		}
+		for (uint32_t c = 0; c < 0x10000; ++c)
+			classOf[c] = foldedClass[fold[c]];
+
+		// Classes consumed by each NFA state
+		std::vector<std::vector<uint16_t>> stateClasses(nfa.size());
+		for (size_t s = 0; s < nfa.size(); ++s)
+		{
+			for (const auto& [lo, hi] : nfa[s].ranges)
+			{
+				auto first = std::lower_bound(classStart.begin(), classStart.end(), uint32_t(lo)) - classStart.begin();
+				auto last = std::upper_bound(classStart.begin(), classStart.end(), uint32_t(hi)) - classStart.begin();
+				for (auto k = first; k < last; ++k)
+					stateClasses[s].push_back(static_cast<uint16_t>(k));
+			}
+		}
+
+		// Subset construction, DFA state 0 is the dead state
+		struct SetHash
+		{
+			// In 64 bits also where size_t is 32
+			size_t operator()(const std::vector<uint32_t>& v) const noexcept
+			{
+				uint64_t h = v.size();
+				for (auto i : v)
+					h = (h ^ i) * 0x100000001B3ull;
+				return static_cast<size_t>(h ^ (h >> 32));
+			}
+		};
+		std::unordered_map<std::vector<uint32_t>, uint32_t, SetHash> ids;
+		std::vector<std::vector<uint32_t>> sets;
+		auto addState = [&](std::vector<uint32_t>&& set) -> uint32_t {
+			// Once a pattern has surely matched, patterns after it can't win
+			uint32_t matched = npos;
+			for (auto s : set)
+			{
+				if (nfa[s].sticky)
+					matched = std::min(matched, nfa[s].pattern);
+			}
+			if (matched != npos)
+				std::erase_if(set, [&](uint32_t s) { return nfa[s].pattern > matched; });
+
+			auto [it, inserted] = ids.emplace(std::move(set), static_cast<uint32_t>(sets.size()));
+			if (inserted)
+			{
+				sets.push_back(it->first);
+				uint32_t match = npos;
+				for (auto s : it->first)
+					match = std::min(match, nfa[s].match);
+				accept.push_back(match);
+				transitions.resize(sets.size() * numClasses, 0);
+			}
+			return it->second;
+		};
+
+		addState({});
+		startState = addState(Closure(patterns));
+
+		std::vector<std::vector<uint32_t>> next(numClasses);
+		for (size_t i = 1; i < sets.size(); ++i)
+		{
+			if (sets.size() > MaxDfaStates)
+			{
+				errMsg.append(std::format(L"Font name patterns are too complex ({} states).\n", sets.size()));
+				return false;
+			}
+
+			for (auto& n : next)
+				n.clear();
+			for (auto s : sets[i])
+			{
+				for (auto k : stateClasses[s])
+					next[k].push_back(nfa[s].next);
+			}
+
+			for (size_t k = 0; k < numClasses; ++k)
+			{
+				const uint32_t target = next[k].empty() ? 0 : addState(Closure(next[k]));
+				transitions[i * numClasses + k] = target;
+			}
+		}
+
+		nfa.clear();
+		nfa.shrink_to_fit();
+		closureMark.clear();
+		closureMark.shrink_to_fit();
+		return true;
+	}
+
+	// Returns id of the first pattern matching whole "name", or npos
+	uint32_t Match(std::wstring_view name) const
+	{
+		uint32_t state = startState;
+		for (wchar_t c : name)
+		{
+			state = transitions[state * numClasses + classOf[static_cast<uint16_t>(c)]];
+			if (state == 0)
+				return npos;
+		}
+		return accept[state];
+	}
+
+private:
+	struct NfaState
+	{
+		std::vector<std::pair<wchar_t, wchar_t>> ranges; // Folded, consumed to "next"
+		uint32_t next = npos;
+		std::vector<uint32_t> eps;
+		uint32_t match = npos;
+		uint32_t pattern = npos;
+		bool sticky = false; // Trailing ".*" of an unanchored pattern, reached only after a match
+	};
+
+	struct Frag
+	{
+		uint32_t start = npos, end = npos;
+	};
+
+	// Simple case folding shared by patterns and input
+	static const std::vector<wchar_t>& FoldTable()
+	{
+		static const std::vector<wchar_t> table = [] {
+			std::vector<wchar_t> t(0x10000);
+			for (uint32_t c = 0; c < 0x10000; ++c)
+				t[c] = static_cast<wchar_t>(c);
+			CharLowerBuffW(t.data() + 1, 0xFFFF);
+			return t;
+		}();
+		return table;
+	}
+
+	uint32_t NewState()
+	{
+		nfa.emplace_back();
+		return static_cast<uint32_t>(nfa.size() - 1);
+	}
+
+	Frag CharSet(const std::vector<std::pair<wchar_t, wchar_t>>& ranges, bool negate)
+	{
+		const auto& fold = FoldTable();
+		std::vector<wchar_t> chars;
+		bool all = false;
+		for (const auto& [lo, hi] : ranges)
+		{
+			if (lo == L'\0' && hi == L'\xFFFF')
+			{
+				all = true;
+				break;
+			}
+			for (uint32_t c = lo; c <= hi; ++c)
+				chars.push_back(fold[c]);
+		}
+		std::sort(chars.begin(), chars.end());
+		chars.erase(std::unique(chars.begin(), chars.end()), chars.end());
+
+		std::vector<std::pair<wchar_t, wchar_t>> folded;
+		if (all)
+			folded.emplace_back(L'\0', L'\xFFFF');
+		for (wchar_t c : chars)
+		{
+			if (!folded.empty() && folded.back().second + 1 == c)
+				folded.back().second = c;
+			else
+				folded.emplace_back(c, c);
+		}
+
+		Frag f{ NewState(), NewState() };
+		auto& state = nfa[f.start];
+		if (negate)
+		{
+			uint32_t next = 0;
+			for (const auto& [lo, hi] : folded)
+			{
+				if (lo > next)
+					state.ranges.emplace_back(static_cast<wchar_t>(next), static_cast<wchar_t>(lo - 1));
+				next = hi + 1u;
+			}
+			if (next <= 0xFFFF)
+				state.ranges.emplace_back(static_cast<wchar_t>(next), L'\xFFFF');
+		}
+		else
+		{
+			state.ranges = std::move(folded);
+		}
+		state.next = f.end;
+		return f;
+	}
+
+	std::vector<uint32_t> Closure(const std::vector<uint32_t>& states)
+	{
+		if (closureMark.size() != nfa.size())
+			closureMark.assign(nfa.size(), 0);
+		++closureGeneration;
+
+		std::vector<uint32_t> stack(states), result;
+		while (!stack.empty())
+		{
+			auto s = stack.back();
+			stack.pop_back();
+			if (closureMark[s] == closureGeneration)
+				continue;
+			closureMark[s] = closureGeneration;
+			if (!nfa[s].ranges.empty() || nfa[s].match != npos)
+				result.push_back(s);
+			for (auto e : nfa[s].eps)
+				stack.push_back(e);
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+	struct Parser
+	{
+		FacePatternSet& set;
+		std::wstring_view re;
+		size_t pos = 0;
+
+		bool Parse(Frag& out)
+		{
+			bool anchorStart = Eat(L'^');
+			// "$" is an anchor unless escaped by an odd number of backslashes
+			size_t backslashes = 0;
+			while (backslashes + 1 < re.size() - pos && re[re.size() - 2 - backslashes] == L'\\')
+				++backslashes;
+			bool anchorEnd = re.size() > pos && re.back() == L'$' && backslashes % 2 == 0;
+			if (anchorEnd)
+				re.remove_suffix(1);
+
+			if (!Alt(out) || pos != re.size())
+				return false;
+
+			if (!anchorStart)
+			{
+				set.nfa[set.anyPrefix.end].eps.push_back(out.start);
+				out.start = set.anyPrefix.start;
+			}
+			if (!anchorEnd)
+			{
+				Frag any = set.CharSet({ { L'\0', L'\xFFFF' } }, false);
+				set.nfa[any.start].sticky = true;
+				out = Concat(out, Star(any));
+			}
+			return true;
+		}
+
+		bool Eat(wchar_t c)
+		{
+			if (pos < re.size() && re[pos] == c)
+			{
+				++pos;
+				return true;
+			}
+			return false;
+		}
+
+		Frag Concat(Frag a, Frag b)
+		{
+			set.nfa[a.end].eps.push_back(b.start);
+			return { a.start, b.end };
+		}
+
+		Frag Star(Frag a)
+		{
+			Frag f{ set.NewState(), set.NewState() };
+			set.nfa[f.start].eps = { a.start, f.end };
+			set.nfa[a.end].eps.insert(set.nfa[a.end].eps.end(), { a.start, f.end });
+			return f;
+		}
+
+		bool Alt(Frag& out)
+		{
+			Frag a;
+			if (!Seq(a))
+				return false;
+			while (Eat(L'|'))
+			{
+				Frag b;
+				if (!Seq(b))
+					return false;
+				Frag f{ set.NewState(), set.NewState() };
+				set.nfa[f.start].eps = { a.start, b.start };
+				set.nfa[a.end].eps.push_back(f.end);
+				set.nfa[b.end].eps.push_back(f.end);
+				a = f;
+			}
+			out = a;
+			return true;
+		}
+
+		bool Seq(Frag& out)
+		{
+			auto empty = set.NewState();
+			out = { empty, empty };
+			while (pos < re.size() && re[pos] != L'|' && re[pos] != L')')
+			{
+				Frag a;
+				if (!Repeat(a))
+					return false;
+				out = Concat(out, a);
+			}
+			return true;
+		}
+
+		bool Repeat(Frag& out)
+		{
+			if (!Atom(out))
+				return false;
+			while (pos < re.size())
+			{
+				if (Eat(L'*'))
+				{
+					out = Star(out);
+				}
+				else if (Eat(L'+'))
+				{
+					auto end = set.NewState();
+					set.nfa[out.end].eps.insert(set.nfa[out.end].eps.end(), { out.start, end });
+					out.end = end;
+				}
+				else if (Eat(L'?'))
+				{
+					Frag f{ set.NewState(), out.end };
+					set.nfa[f.start].eps = { out.start, out.end };
+					out = f;
+				}
+				else
+					break;
+			}
+			return true;
+		}
+
+		bool Atom(Frag& out)
+		{
+			if (pos >= re.size())
+				return false;
+
+			wchar_t c = re[pos++];
+			switch (c)
+			{
+			case L'(':
+				return Alt(out) && Eat(L')');
+			case L'.':
+				out = set.CharSet({ { L'\0', L'\xFFFF' } }, false);
+				return true;
+			case L'[':
+			{
+				bool negate = Eat(L'^');
+				std::vector<std::pair<wchar_t, wchar_t>> ranges;
+				while (pos < re.size() && re[pos] != L']')
+				{
+					wchar_t lo = re[pos++];
+					if (lo == L'\\' && pos < re.size())
+						lo = re[pos++];
+					wchar_t hi = lo;
+					if (pos + 1 < re.size() && re[pos] == L'-' && re[pos + 1] != L']')
+					{
+						hi = re[pos + 1];
+						pos += 2;
+					}
+					if (hi < lo)
+						return false;
+					ranges.emplace_back(lo, hi);
+				}
+				if (!Eat(L']'))
+					return false;
+				out = set.CharSet(ranges, negate);
+				return true;
+			}
+			case L'\\':
+				if (pos >= re.size())
+					return false;
+				c = re[pos++];
+				break;
+			case L')':
+			case L'*':
+			case L'+':
+			case L'?':
+			case L'^':
+			case L'$':
+				return false;
+			}
+			out = set.CharSet({ { c, c } }, false);
+			return true;
+		}
+	};
+
+	std::vector<NfaState> nfa;
+	std::vector<uint32_t> patterns; // NFA start state of each pattern
+	Frag anyPrefix;
+	std::vector<uint32_t> closureMark;
+	uint32_t closureGeneration = 0;
+
+	size_t numClasses = 0;
+	std::vector<uint16_t> classOf; // Code unit -> class, with case folding applied
+	std::vector<uint32_t> transitions; // [state * numClasses + class]
+	std::vector<uint32_t> accept; // Pattern id matched in each state
+	uint32_t startState = 0;
+};
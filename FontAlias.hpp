@@ -0,0 +1,128 @@
+#pragma once
+
+// Maps every name a font family answers to (localized, English, full name)
+// to the rule of that family, so a single "fonts" rule covers all of them.
+
+#include "Sfnt.hpp"
+
+// Collects family (1), full (4) and typographic family (16) names of all
+// languages from a "name" table.
+// https://learn.microsoft.com/en-us/typography/opentype/spec/name
+void ParseNameTableFamilyNames(const uint8_t* data, size_t size, std::vector<std::wstring>& names)
+{
+	if (size < 6)
+		return;
+
+	const uint16_t count = ReadU16BE(data + 2);
+	const uint16_t storageOffset = ReadU16BE(data + 4);
+	if (6 + size_t(count) * 12 > size)
+		return;
+
+	for (uint16_t i = 0; i < count; ++i)
+	{
+		const uint8_t* record = data + 6 + i * 12;
+		const uint16_t platformID = ReadU16BE(record);
+		const uint16_t encodingID = ReadU16BE(record + 2);
+		const uint16_t nameID = ReadU16BE(record + 6);
+		const uint16_t length = ReadU16BE(record + 8);
+		const uint16_t offset = ReadU16BE(record + 10);
+
+		if (nameID != 1 && nameID != 4 && nameID != 16)
+			continue;
+		// Unicode platform, or Windows platform with UTF-16BE encoding
+		if (platformID != 0 && !(platformID == 3 && (encodingID == 1 || encodingID == 10)))
+			continue;
+		if (size_t(storageOffset) + offset + length > size || length == 0)
+			continue;
+
+		const uint8_t* str = data + storageOffset + offset;
+		std::wstring name(length / 2, 0);
+		for (size_t j = 0; j < name.size(); ++j)
+			name[j] = static_cast<wchar_t>(ReadU16BE(str + j * 2));
+
+		if (name.size() < LF_FACESIZE)
+			names.push_back(std::move(name));
+	}
+}
+
+// Other names of the fonts that have rules, resolved once at config time. Lookups take
+// the name passed to CreateFont as is, without copying it.
+template <typename Rule>
+struct FontAliasMap
+{
+	struct NameHash
+	{
+		using is_transparent = void;
+		size_t operator()(std::wstring_view s) const noexcept { return std::hash<std::wstring_view>()(s); }
+	};
+
+	Rule* Find(std::wstring_view name) const
+	{
+		auto it = aliases.find(name);
+		return it != aliases.end() ? it->second : nullptr;
+	}
+
+	// Existing names keep their first rule
+	void Add(std::wstring name, Rule* rule)
+	{
+		aliases.emplace(std::move(name), rule);
+	}
+
+	std::unordered_map<std::wstring, Rule*, NameHash, std::equal_to<>> aliases;
+};
+
+// Reads the family, full and typographic family names of the font "faceName" selects.
+// False if the font isn't installed, GDI selects a substitute then, whose names don't
+// include "faceName".
+bool ReadFontFamilyNames(HDC hdc, const std::wstring& faceName, std::vector<uint8_t>& nameTable, std::vector<std::wstring>& names)
+{
+	names.clear();
+	if (faceName.empty() || faceName.size() >= LF_FACESIZE)
+		return false;
+
+	LOGFONTW logfont = {};
+	logfont.lfCharSet = DEFAULT_CHARSET;
+	wcscpy_s(logfont.lfFaceName, LF_FACESIZE, faceName.c_str());
+	wil::unique_hfont hFont(CreateFontIndirectW(&logfont));
+	if (!hFont)
+		return false;
+
+	auto select = wil::SelectObject(hdc, hFont.get());
+	constexpr DWORD nameTag = GdiTableTag('n', 'a', 'm', 'e');
+	DWORD size = GetFontData(hdc, nameTag, 0, nullptr, 0);
+	if (size == GDI_ERROR || size == 0)
+		return false;
+	nameTable.resize(size);
+	if (GetFontData(hdc, nameTag, 0, nameTable.data(), size) != size)
+		return false;
+	ParseNameTableFamilyNames(nameTable.data(), size, names);
+
+	return std::any_of(names.begin(), names.end(), [&](const std::wstring& name) { return _wcsicmp(name.c_str(), faceName.c_str()) == 0; });
+}
+
+// Maps the other names of each rule's font to the rule. Only the fonts named by rules are
+// read, and names that are rules of their own are left to them. Must run before
+// CreateFontIndirectW is hooked.
+template <typename Rule>
+size_t BuildFontAliasMap(FontAliasMap<Rule>& aliasMap, std::unordered_map<std::wstring, Rule>& rules)
+{
+	wil::unique_hdc memDC(CreateCompatibleDC(nullptr));
+	if (!memDC)
+		return 0;
+
+	size_t resolved = 0;
+	std::vector<uint8_t> nameTable;
+	std::vector<std::wstring> names;
+	for (auto& [faceName, rule] : rules)
+	{
+		if (!ReadFontFamilyNames(memDC.get(), faceName, nameTable, names))
+			continue;
+		++resolved;
+		for (auto& name : names)
+		{
+			if (!rules.contains(name))
+				aliasMap.Add(std::move(name), &rule);
+		}
+	}
+	return resolved;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+// Rules that only apply to some sizes, weights or charsets of a face. Conditions of
+// a face are compiled into a sorted table of height intervals, each listing the
+// variants covering it in priority order, so a lookup is one binary search plus a
+// check of the few variants left.
+
+#include <bitset>
+
+struct FontCondition
+{
+	// Inclusive ranges, height is compared by absolute value of lfHeight
+	long heightMin = LONG_MIN;
+	long heightMax = LONG_MAX;
+	long weightMin = LONG_MIN;
+	long weightMax = LONG_MAX;
+	std::bitset<256> charsets = std::bitset<256>().set();
+	std::vector<uint32_t> modules; // ModuleIndex ids of callers, empty for any
+};
+
+template <class T>
+struct ConditionalRules
+{
+	// Variants added first have higher priority when ranges overlap
+	void Add(const FontCondition& condition, T&& info)
+	{
+		variants.push_back({ condition, std::move(info) });
+	}
+
+	void Compile()
+	{
+		std::vector<long> points;
+		for (const auto& v : variants)
+		{
+			points.push_back(v.condition.heightMin);
+			if (v.condition.heightMax != LONG_MAX)
+				points.push_back(v.condition.heightMax + 1);
+		}
+		std::sort(points.begin(), points.end());
+		points.erase(std::unique(points.begin(), points.end()), points.end());
+
+		// Interval i is [bounds[i], bounds[i + 1])
+		bounds = std::move(points);
+		hasModuleConditions = std::any_of(variants.begin(), variants.end(), [](const Variant& v) { return !v.condition.modules.empty(); });
+		candidates.assign(bounds.size(), {});
+		for (size_t i = 0; i < bounds.size(); ++i)
+		{
+			for (size_t j = 0; j < variants.size(); ++j)
+			{
+				const auto& c = variants[j].condition;
+				if (c.heightMin <= bounds[i] && bounds[i] <= c.heightMax)
+					candidates[i].push_back(static_cast<uint16_t>(j));
+			}
+		}
+	}
+
+	bool HasModuleConditions() const
+	{
+		return hasModuleConditions;
+	}
+
+	// "module" is the caller's module id, only needed if HasModuleConditions()
+	const T* Find(const LOGFONTW& lf, uint32_t module = UINT32_MAX) const
+	{
+		// LONG_MIN has no absolute value, it is as far out of range as LONG_MAX
+		const long height = lf.lfHeight == LONG_MIN ? LONG_MAX : lf.lfHeight < 0 ? -lf.lfHeight : lf.lfHeight;
+		auto it = std::upper_bound(bounds.begin(), bounds.end(), height);
+		if (it == bounds.begin())
+			return nullptr;
+
+		for (auto j : candidates[it - bounds.begin() - 1])
+		{
+			const auto& v = variants[j];
+			if (lf.lfWeight < v.condition.weightMin || lf.lfWeight > v.condition.weightMax || !v.condition.charsets[lf.lfCharSet])
+				continue;
+			if (!v.condition.modules.empty() && std::find(v.condition.modules.begin(), v.condition.modules.end(), module) == v.condition.modules.end())
+				continue;
+			return &v.info;
+		}
+		return nullptr;
+	}
+
+private:
+	struct Variant
+	{
+		FontCondition condition;
+		T info;
+	};
+
+	std::vector<Variant> variants;
+	std::vector<long> bounds;
+	std::vector<std::vector<uint16_t>> candidates;
+	bool hasModuleConditions = false;
+};
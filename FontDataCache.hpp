@@ -0,0 +1,248 @@
+#pragma once
+
+// Tables returned by GetFontData, cached per font file and face so repeated requests
+// are one memcpy. Whole tables are cached, any range inside one is served from the
+// same copy. Least recently used tables are dropped when over budget.
+//
+// Fonts are identified with GetFontRealizationInfo and GetFontFileInfo, exported by
+// gdi32 but not declared in SDK headers. Fonts without a single backing file (memory
+// fonts, Type 1 fonts) are not cached.
+
+#include <list>
+#include <mutex>
+
+struct FONT_REALIZATION_INFO
+{
+	DWORD size;
+	DWORD flags;
+	DWORD cacheNum;
+	DWORD instanceId;
+	DWORD fileCount; // Windows 8.1 and later
+	WORD faceIndex;
+	WORD simulations;
+};
+
+struct FONT_FILE_INFO
+{
+	FILETIME writeTime;
+	LARGE_INTEGER size;
+	WCHAR path[MAX_PATH];
+};
+
+using GetFontRealizationInfo_t = BOOL WINAPI(HDC hdc, FONT_REALIZATION_INFO* info);
+using GetFontFileInfo_t = BOOL WINAPI(DWORD instanceId, DWORD fileIndex, FONT_FILE_INFO* info, SIZE_T size, SIZE_T* needed);
+
+struct FontDataCache
+{
+	static constexpr size_t MaxTableShare = 4; // One table may use at most 1/4 of the budget
+
+	bool Enabled() const
+	{
+		return budget != 0;
+	}
+
+	bool Enable(size_t bytes)
+	{
+		auto hGdi = GetModuleHandleW(L"gdi32.dll");
+		getFontRealizationInfo = reinterpret_cast<GetFontRealizationInfo_t*>(GetProcAddress(hGdi, "GetFontRealizationInfo"));
+		getFontFileInfo = reinterpret_cast<GetFontFileInfo_t*>(GetProcAddress(hGdi, "GetFontFileInfo"));
+		if (!getFontRealizationInfo || !getFontFileInfo)
+			return false;
+		budget = bytes;
+		return true;
+	}
+
+	// Config time, after "memoryBudget" is read
+	void UseMemoryBudget()
+	{
+		budgetId = memoryBudget.Register("fontDataCache", [this] { return hits.load(std::memory_order_relaxed); }, [this](size_t bytes) { return Trim(bytes); });
+	}
+
+	template <class Original>
+	DWORD Get(HDC hdc, DWORD table, DWORD offset, PVOID buffer, DWORD size, Original original)
+	{
+		// Size queries at an offset keep GDI's own answer
+		const bool sizeQuery = !buffer || size == 0;
+		if (sizeQuery && offset != 0)
+			return original(hdc, table, offset, buffer, size);
+
+		FONT_REALIZATION_INFO ri = { sizeof(ri) };
+		FONT_FILE_INFO fi;
+		SIZE_T needed;
+		if (!getFontRealizationInfo(hdc, &ri) || ri.fileCount != 1 || !getFontFileInfo(ri.instanceId, 0, &fi, sizeof(fi), &needed) || !fi.path[0])
+			return original(hdc, table, offset, buffer, size);
+
+		const uint64_t writeTime = (static_cast<uint64_t>(fi.writeTime.dwHighDateTime) << 32) | fi.writeTime.dwLowDateTime;
+		Blob blob;
+		Key key;
+		{
+			std::lock_guard lock(mutex);
+			key = { FileId(fi.path, writeTime, fi.size.QuadPart), ri.faceIndex, table };
+			if (auto it = index.find(key); it != index.end())
+			{
+				lru.splice(lru.begin(), lru, it->second);
+				blob = it->second->blob;
+			}
+		}
+
+		if (blob)
+		{
+			liveStats.Add(LiveCounter::FontDataHits);
+			hits.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			liveStats.Add(LiveCounter::FontDataMisses);
+			misses.fetch_add(1, std::memory_order_relaxed);
+
+			const DWORD length = original(hdc, table, 0, nullptr, 0);
+			if (length == GDI_ERROR || length == 0 || length > budget / MaxTableShare)
+				return original(hdc, table, offset, buffer, size);
+
+			auto data = std::make_shared<std::vector<uint8_t>>(length);
+			if (original(hdc, table, 0, data->data(), length) != length)
+				return original(hdc, table, offset, buffer, size);
+			blob = Insert(key, std::move(data));
+		}
+
+		if (sizeQuery)
+			return static_cast<DWORD>(blob->size());
+
+		// Reads past the end keep GDI's own answer
+		if (offset > blob->size() || size > blob->size() - offset)
+			return original(hdc, table, offset, buffer, size);
+
+		memcpy(buffer, blob->data() + offset, size);
+		liveStats.Add(LiveCounter::FontDataBytesSaved, size);
+		bytesServed.fetch_add(size, std::memory_order_relaxed);
+		return size;
+	}
+
+	// At process exit other threads are gone, one may have died holding the lock
+	void LogStats(HANDLE hFile, bool atExit)
+	{
+		std::unique_lock lock(mutex, std::defer_lock);
+		if (!atExit)
+			lock.lock();
+		else if (!lock.try_lock())
+			return;
+
+		FormatToFile(hFile, "[FontDataCache] hits = {}, misses = {}, bytes served = {}, tables = {}, bytes cached = {}\n",
+			hits.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed), bytesServed.load(std::memory_order_relaxed), lru.size(), used);
+	}
+
+private:
+	using Blob = std::shared_ptr<const std::vector<uint8_t>>;
+
+	struct Key
+	{
+		uint32_t file;
+		uint32_t faceIndex;
+		DWORD table;
+
+		bool operator==(const Key&) const = default;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& k) const noexcept
+		{
+			return (size_t(k.file) * 0x9E3779B9u) ^ (size_t(k.faceIndex) << 16) ^ k.table;
+		}
+	};
+
+	struct Entry
+	{
+		Key key;
+		Blob blob;
+	};
+
+	struct FileVersion
+	{
+		uint32_t id;
+		uint64_t writeTime;
+		uint64_t size;
+	};
+
+	struct NameHash
+	{
+		using is_transparent = void;
+		size_t operator()(std::wstring_view s) const noexcept { return std::hash<std::wstring_view>()(s); }
+	};
+
+	// A replaced file gets a new id, tables of the old one age out
+	uint32_t FileId(std::wstring_view path, uint64_t writeTime, uint64_t size)
+	{
+		auto it = files.find(path);
+		if (it == files.end())
+			it = files.emplace(path, FileVersion{ nextFileId++, writeTime, size }).first;
+		else if (it->second.writeTime != writeTime || it->second.size != size)
+			it->second = { nextFileId++, writeTime, size };
+		return it->second.id;
+	}
+
+	// List and index nodes included, roughly
+	static size_t EntryBytes(const Blob& blob)
+	{
+		return blob->size() + sizeof(Entry) + 8 * sizeof(void*);
+	}
+
+	Blob Insert(const Key& key, Blob blob)
+	{
+		bool overBudget;
+		{
+			std::lock_guard lock(mutex);
+			if (auto it = index.find(key); it != index.end())
+				return it->second->blob; // Another thread read it first
+
+			lru.push_front({ key, blob });
+			index.emplace(key, lru.begin());
+			used += blob->size();
+			overBudget = memoryBudget.Add(budgetId, EntryBytes(blob));
+			while (used > budget)
+				PopOldest();
+		}
+		if (overBudget)
+			memoryBudget.Enforce();
+		return blob;
+	}
+
+	// Under the lock, returns the bytes freed
+	size_t PopOldest()
+	{
+		const size_t bytes = EntryBytes(lru.back().blob);
+		used -= lru.back().blob->size();
+		memoryBudget.Remove(budgetId, bytes);
+		index.erase(lru.back().key);
+		lru.pop_back();
+		return bytes;
+	}
+
+	size_t Trim(size_t bytes)
+	{
+		std::lock_guard lock(mutex);
+		size_t freed = 0;
+		while (freed < bytes && !lru.empty())
+			freed += PopOldest();
+		return freed;
+	}
+
+	size_t budget = 0;
+	MemoryBudget::Id budgetId = MemoryBudget::NoId;
+	GetFontRealizationInfo_t* getFontRealizationInfo = nullptr;
+	GetFontFileInfo_t* getFontFileInfo = nullptr;
+
+	std::mutex mutex;
+	std::list<Entry> lru; // Most recently used first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+	size_t used = 0;
+	std::unordered_map<std::wstring, FileVersion, NameHash, std::equal_to<>> files;
+	uint32_t nextFileId = 0;
+
+	std::atomic<uint64_t> hits = 0;
+	std::atomic<uint64_t> misses = 0;
+	std::atomic<uint64_t> bytesServed = 0;
+};
+
+// Never destroyed, hooks may still use it during unload
+FontDataCache& fontDataCache = *new FontDataCache;
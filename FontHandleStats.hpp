@@ -0,0 +1,220 @@
+#pragma once
+
+// Live HFONTs created through the hooks, to find programs leaking fonts. Handles are
+// kept in an open addressing table of 8 byte slots (GDI handles fit in 32 bits, also
+// in 64 bit processes), mapping to the signature of the rewritten LOGFONT and the
+// module that created it.
+
+#include <mutex>
+
+struct FontHandleStats
+{
+	static constexpr size_t ReportSignatures = 30;
+
+	bool Enabled() const
+	{
+		return enabled;
+	}
+
+	void Enable(fs::path path)
+	{
+		reportPath = std::move(path);
+		enabled = true;
+	}
+
+	void Created(HFONT hFont, const LOGFONTW& lf, HMODULE site)
+	{
+		if (!hFont)
+			return;
+
+		Signature sig{ lf.lfFaceName, lf.lfHeight, lf.lfWeight, lf.lfItalic, lf.lfCharSet, site };
+		std::lock_guard lock(mutex);
+		auto [it, inserted] = signatureIds.try_emplace(std::move(sig), static_cast<uint32_t>(signatures.size()));
+		if (inserted)
+			signatures.push_back({ &it->first });
+		const uint32_t id = it->second;
+		++signatures[id].created;
+		++created;
+
+		// A tracked handle value was freed without DeleteObject passing through us
+		if (const auto old = Remove(ToKey(hFont)); old != npos)
+		{
+			++signatures[old].deleted;
+			++deleted;
+		}
+
+		Insert(ToKey(hFont), id);
+		peakLive = std::max(peakLive, live);
+	}
+
+	// Handles not created through the hooks are ignored
+	void Deleted(HGDIOBJ hObject)
+	{
+		std::lock_guard lock(mutex);
+		if (const auto id = Remove(ToKey(hObject)); id != npos)
+		{
+			++signatures[id].deleted;
+			++deleted;
+		}
+	}
+
+	// At process exit other threads are gone, one may have died holding the lock
+	void WriteReport(bool atExit)
+	{
+		if (!enabled)
+			return;
+
+		std::unique_lock lock(mutex, std::defer_lock);
+		if (!atExit)
+			lock.lock();
+		else if (!lock.try_lock())
+			return;
+
+		wil::unique_hfile hFile(CreateFileW(reportPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+		if (!hFile)
+			return;
+
+		FormatToFile(hFile.get(), "[FontHandles] created = {}, deleted = {}, live = {}, peak live = {}, signatures = {}\n\n", created, deleted, live, peakLive, signatures.size());
+
+		std::vector<const SignatureStats*> top;
+		for (const auto& s : signatures)
+		{
+			if (s.created > s.deleted)
+				top.push_back(&s);
+		}
+		const size_t count = std::min(top.size(), ReportSignatures);
+		std::partial_sort(top.begin(), top.begin() + count, top.end(), [](const SignatureStats* a, const SignatureStats* b) { return a->created - a->deleted > b->created - b->deleted; });
+
+		FormatToFile(hFile.get(), "Fonts still alive, by signature:\n");
+		for (size_t i = 0; i < count; ++i)
+		{
+			const auto& s = *top[i];
+			std::string name, module = "?";
+			if (!Utf16ToUtf8(s.signature->face, name))
+				name = "?";
+			WCHAR path[MAX_PATH];
+			if (s.signature->site && GetModuleFileNameW(s.signature->site, path, MAX_PATH))
+			{
+				if (!Utf16ToUtf8(fs::path(path).filename().native(), module))
+					module = "?";
+			}
+
+			FormatToFile(hFile.get(), "  live = {}, created = {}, name = \"{}\", height = {}, weight = {}, italic = {}, charset = {}, module = \"{}\"\n",
+				s.created - s.deleted, s.created, name, s.signature->height, s.signature->weight, !!s.signature->italic, s.signature->charSet, module);
+		}
+	}
+
+private:
+	static constexpr uint32_t npos = UINT32_MAX;
+	static constexpr uint32_t Empty = 0;
+	static constexpr uint32_t Tombstone = UINT32_MAX; // Not a valid handle value
+
+	struct Signature
+	{
+		std::wstring face;
+		LONG height;
+		LONG weight;
+		BYTE italic;
+		BYTE charSet;
+		HMODULE site;
+
+		bool operator==(const Signature&) const = default;
+	};
+
+	struct SignatureHash
+	{
+		// Combined in 64 bits also where size_t is 32
+		size_t operator()(const Signature& s) const noexcept
+		{
+			uint64_t h = std::hash<std::wstring>()(s.face);
+			for (uint64_t v : { uint64_t(s.height), uint64_t(s.weight), uint64_t(s.italic), uint64_t(s.charSet), uint64_t(reinterpret_cast<uintptr_t>(s.site)) })
+				h = (h ^ v) * 0x100000001B3;
+			return static_cast<size_t>(h ^ (h >> 32));
+		}
+	};
+
+	struct SignatureStats
+	{
+		const Signature* signature; // Key in signatureIds, node based so it stays valid
+		uint64_t created = 0;
+		uint64_t deleted = 0;
+	};
+
+	struct Slot
+	{
+		uint32_t handle = Empty;
+		uint32_t signature = 0;
+	};
+
+	static uint32_t ToKey(HGDIOBJ h)
+	{
+		return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(h));
+	}
+
+	size_t Probe(uint32_t key) const
+	{
+		return (key * 0x9E3779B9u) & (slots.size() - 1);
+	}
+
+	void Insert(uint32_t key, uint32_t signature)
+	{
+		// Grow or clean tombstones at 50% use
+		if ((used + 1) * 2 > slots.size())
+			Rehash(std::max<size_t>(64, live * 4 >= slots.size() ? slots.size() * 2 : slots.size()));
+
+		size_t i = Probe(key);
+		while (slots[i].handle != Empty && slots[i].handle != Tombstone)
+			i = (i + 1) & (slots.size() - 1);
+		used += slots[i].handle == Empty;
+		slots[i] = { key, signature };
+		++live;
+	}
+
+	// Returns the signature of a removed handle, or npos
+	uint32_t Remove(uint32_t key)
+	{
+		if (slots.empty() || key == Empty || key == Tombstone)
+			return npos;
+
+		for (size_t i = Probe(key); slots[i].handle != Empty; i = (i + 1) & (slots.size() - 1))
+		{
+			if (slots[i].handle == key)
+			{
+				slots[i].handle = Tombstone;
+				--live;
+				return slots[i].signature;
+			}
+		}
+		return npos;
+	}
+
+	void Rehash(size_t size)
+	{
+		std::vector<Slot> old(size);
+		old.swap(slots);
+		used = 0;
+		live = 0;
+		for (const auto& slot : old)
+		{
+			if (slot.handle != Empty && slot.handle != Tombstone)
+				Insert(slot.handle, slot.signature);
+		}
+	}
+
+	bool enabled = false;
+	fs::path reportPath;
+
+	std::mutex mutex;
+	std::vector<Slot> slots; // Size is a power of two
+	size_t used = 0; // Live and tombstone slots
+	size_t live = 0;
+	size_t peakLive = 0;
+	uint64_t created = 0;
+	uint64_t deleted = 0;
+
+	std::unordered_map<Signature, uint32_t, SignatureHash> signatureIds;
+	std::vector<SignatureStats> signatures;
+};
+
+// Never destroyed, hooks may still use it during unload
+FontHandleStats& fontHandleStats = *new FontHandleStats;
@@ -0,0 +1,279 @@
+#pragma once
+
+// Override rules of "fonts" and "gdiplus", and how a rule is applied to a LOGFONTW.
+// Only depends on Win32 types, not on GDI calls or hook state.
+
+#include "FontConditions.hpp"
+#include "LogFontPatch.hpp"
+
+struct FontInfo
+{
+	enum struct OverrideFlags : uint32_t
+	{
+		None = 0,
+		Height = 1 << 1,
+		Width = 1 << 2,
+		Weight = 1 << 3,
+		Italic = 1 << 4,
+		Underline = 1 << 5,
+		StrikeOut = 1 << 6,
+		Charset = 1 << 7,
+		OutPrecision = 1 << 8,
+		ClipPrecision = 1 << 9,
+		Quality = 1 << 10,
+		PitchAndFamily = 1 << 11,
+		HeightOffset = 1 << 12,
+		WidthOffset = 1 << 13,
+		HeightScale = 1 << 14,
+		WidthScale = 1 << 15
+
+	};
+
+	std::wstring name;
+	OverrideFlags overrideFlags = OverrideFlags::None;
+	ScaledSize height;
+	ScaledSize width;
+	ScaledSize heightOffset;
+	ScaledSize widthOffset;
+	double heightScale;
+	double widthScale;
+	long weight;
+	bool italic;
+	bool underLine;
+	bool strikeOut;
+	BYTE charSet;
+	BYTE outPrecision;
+	BYTE clipPrecision;
+	BYTE quality;
+	BYTE pitchAndFamily;
+
+	// Set when the rule has "when" conditions, the fields above are unused then
+	std::shared_ptr<const ConditionalRules<FontInfo>> variants;
+
+	// Fields above compiled by CompileOverride, used by OverrideLogFont
+	LogFontPatch patch;
+
+	uint32_t statsId = UINT32_MAX; // RuleStats id, set when rule stats are enabled
+};
+
+DEFINE_ENUM_FLAG_OPERATORS(FontInfo::OverrideFlags);
+
+struct GPFontInfo
+{
+	enum struct OverrideFlags : uint32_t
+	{
+		None = 0,
+		Size = 1 << 1,
+		Style = 1 << 2,
+		Unit = 1 << 3
+	};
+
+	enum struct Style
+	{
+		Regular,
+		Bold,
+		Italic,
+		BoldItalic,
+		Underline,
+		Strikeout
+	};
+
+	enum struct Unit
+	{
+		World,
+		Display,
+		Pixel,
+		Point,
+		Inch,
+		Document,
+		Millimeter
+	};
+
+	OverrideFlags overrideFlags = OverrideFlags::None;
+	float size;
+	Style style;
+	Unit unit;
+	uint32_t statsId = UINT32_MAX;
+};
+
+// "gdiplus" rule replacing a font family with another
+struct GPFamilyInfo
+{
+	std::wstring name;
+	uint32_t statsId = UINT32_MAX;
+};
+
+DEFINE_ENUM_FLAG_OPERATORS(GPFontInfo::OverrideFlags);
+
+void CompileOverride(FontInfo& info)
+{
+	using OF = FontInfo::OverrideFlags;
+	auto has = [&](OF flag) { return (info.overrideFlags & flag) == flag; };
+	LogFontPatch& patch = info.patch;
+
+	if (!info.name.empty())
+		patch.SetFaceName(info.name);
+	// Sizes per DPI are written with the offsets, once the DPI is known
+	uint32_t ops = 0;
+	if (has(OF::Height))
+	{
+		if (info.height.DpiRelative())
+		{
+			patch.heightPerDpi = info.height.HeightPerDpi();
+			ops |= LogFontPatch::Dpi;
+		}
+		else
+			patch.Set(offsetof(LOGFONTW, lfHeight), info.height.Pixels());
+	}
+	if (has(OF::Width))
+	{
+		if (info.width.DpiRelative())
+		{
+			patch.widthPerDpi = info.width.OffsetPerDpi();
+			ops |= LogFontPatch::Dpi;
+		}
+		else
+			patch.Set(offsetof(LOGFONTW, lfWidth), info.width.Pixels());
+	}
+	if (has(OF::Weight))
+		patch.Set(offsetof(LOGFONTW, lfWeight), info.weight);
+	if (has(OF::Italic))
+		patch.Set(offsetof(LOGFONTW, lfItalic), static_cast<BYTE>(info.italic));
+	if (has(OF::Underline))
+		patch.Set(offsetof(LOGFONTW, lfUnderline), static_cast<BYTE>(info.underLine));
+	if (has(OF::StrikeOut))
+		patch.Set(offsetof(LOGFONTW, lfStrikeOut), static_cast<BYTE>(info.strikeOut));
+	if (has(OF::Charset))
+		patch.Set(offsetof(LOGFONTW, lfCharSet), info.charSet);
+	if (has(OF::OutPrecision))
+		patch.Set(offsetof(LOGFONTW, lfOutPrecision), info.outPrecision);
+	if (has(OF::ClipPrecision))
+		patch.Set(offsetof(LOGFONTW, lfClipPrecision), info.clipPrecision);
+	if (has(OF::Quality))
+		patch.Set(offsetof(LOGFONTW, lfQuality), info.quality);
+	if (has(OF::PitchAndFamily))
+		patch.Set(offsetof(LOGFONTW, lfPitchAndFamily), info.pitchAndFamily);
+
+	// Constant fields are written first, then offsets and scales in this order
+	if (has(OF::HeightOffset))
+	{
+		if (info.heightOffset.DpiRelative())
+		{
+			patch.heightOffsetPerDpi = info.heightOffset.OffsetPerDpi();
+			ops |= LogFontPatch::Dpi;
+		}
+		else
+			patch.heightOffset = info.heightOffset.Pixels();
+		ops |= LogFontPatch::HeightOffset;
+	}
+	if (has(OF::WidthOffset))
+	{
+		if (info.widthOffset.DpiRelative())
+		{
+			patch.widthOffsetPerDpi = info.widthOffset.OffsetPerDpi();
+			ops |= LogFontPatch::Dpi;
+		}
+		else
+			patch.widthOffset = info.widthOffset.Pixels();
+		ops |= LogFontPatch::WidthOffset;
+	}
+	if (has(OF::HeightScale))
+	{
+		patch.heightScale = info.heightScale;
+		ops |= LogFontPatch::HeightScale;
+	}
+	if (has(OF::WidthScale))
+	{
+		patch.widthScale = info.widthScale;
+		ops |= LogFontPatch::WidthScale;
+	}
+	patch.SetOps(ops);
+}
+
+// "dpi" is only read when info.patch.UsesDpi()
+void OverrideLogFont(const FontInfo& info, LOGFONTW& lf, uint32_t dpi)
+{
+	info.patch.Apply(lf, dpi);
+}
+
+// Rule a CreateFont call resolves to
+struct FontRuleMatch
+{
+	const FontInfo* info = nullptr; // Variant already chosen, nullptr when no rule applies
+	const std::wstring* fallbackName = nullptr; // Chosen from fontFallbackChain
+	bool isFallback = false;
+};
+
+// Picks the rule for "lf": "FontAll" or the face's rule, then "FontFallback" and
+// fontFallbackChain for faces that don't exist. Conditional rules are resolved to a
+// variant, faces whose variants don't match fall through to the fallback too.
+// "rules" provides the lookups that need config, hook state or GDI:
+//   const FontInfo* All(), Face(const WCHAR*), Fallback()
+//   bool HasFallbackChain(), FaceExists(const WCHAR*)
+//   const std::wstring* SelectFallback(BYTE charSet)
+//   uint32_t CallerModule()
+template <class Rules>
+FontRuleMatch MatchFontRule(const LOGFONTW& lf, Rules& rules)
+{
+	auto resolve = [&](const FontInfo* info) -> const FontInfo* {
+		if (info && info->variants)
+		{
+			const auto& variants = *info->variants;
+			info = variants.Find(lf, variants.HasModuleConditions() ? rules.CallerModule() : UINT32_MAX);
+		}
+		return info;
+	};
+
+	FontRuleMatch match;
+	const FontInfo* all = rules.All();
+	match.info = resolve(all ? all : rules.Face(lf.lfFaceName));
+	if (match.info)
+		return match;
+
+	const FontInfo* fallback = rules.Fallback();
+	const bool hasChain = rules.HasFallbackChain();
+	if ((!fallback && !hasChain) || rules.FaceExists(lf.lfFaceName))
+		return match;
+
+	if (hasChain)
+		match.fallbackName = rules.SelectFallback(lf.lfCharSet);
+	match.info = resolve(fallback);
+	if (!match.info && match.fallbackName)
+	{
+		// Only the name from the chain is applied
+		static const FontInfo chainOnly{};
+		match.info = &chainOnly;
+	}
+	match.isFallback = match.info != nullptr;
+	return match;
+}
+
+// Family GdipCreateFontFamilyFromName creates for "name": the replacement of its "gdiplus"
+// family rule, else "name" itself. "rule" is set to the rule applied, nullptr if none.
+template <class FamilyMap>
+const WCHAR* ResolveGdipFamily(const FamilyMap& families, const WCHAR* name, const GPFamilyInfo*& rule)
+{
+	auto it = families.find(name);
+	rule = it != families.end() ? &it->second : nullptr;
+	return rule ? rule->name.c_str() : name;
+}
+
+// Applies the "gdiplus" rule of family "name" to the arguments of GdipCreateFont.
+// Returns the rule applied, nullptr if none.
+template <class FontMap, class Unit>
+const GPFontInfo* OverrideGdipFont(const FontMap& fonts, const std::wstring& name, float& emSize, INT& style, Unit& unit)
+{
+	auto it = fonts.find(name);
+	if (it == fonts.end())
+		return nullptr;
+
+	const GPFontInfo& info = it->second;
+	using OF = GPFontInfo::OverrideFlags;
+	if ((info.overrideFlags & OF::Size) == OF::Size)
+		emSize = info.size;
+	if ((info.overrideFlags & OF::Style) == OF::Style)
+		style = static_cast<INT>(info.style);
+	if ((info.overrideFlags & OF::Unit) == OF::Unit)
+		unit = static_cast<Unit>(info.unit);
+	return &info;
+}
@@ -3,13 +3,39 @@ namespace fs = std::filesystem;
 #include "Util.hpp"
 #include "DllStub.hpp"
 #include "DefConfigFile.hpp"
+#include "AllocStats.hpp"
 #include "RymlCallbacks.hpp"
+#include "Woff.hpp"
+#include "FontAlias.hpp"
+#include "Coverage.hpp"
+#include "FacePattern.hpp"
+#include "FontInfo.hpp"
+#include "ThreadDpi.hpp"
+#include "ModuleIndex.hpp"
+#include "DllNotification.hpp"
+#include "LiveStats.hpp"
+#include "RuleStats.hpp"
+#include "FontHandleStats.hpp"
+#include "MemoryBudget.hpp"
+#include "EnumFontCache.hpp"
+#include "FontDataCache.hpp"
+#include "TextExtentCache.hpp"
+#include "CharWidthCache.hpp"
+#include "GlyphReplace.hpp"
+#include "FontWarmup.hpp"
 #include <set>
 #include <map>
+#include <mutex>
+#include <execution>
 
 #define CONFIG_FILE_STR L"FontMod.yaml"
 constexpr std::wstring_view CONFIG_FILE = CONFIG_FILE_STR;
 constexpr std::wstring_view LOG_FILE = L"FontMod.log";
+constexpr std::wstring_view LATENCY_FILE = L"FontMod.latency.txt";
+constexpr std::wstring_view RULE_STATS_FILE = L"FontMod.rules.txt";
+constexpr std::wstring_view FONT_HANDLES_FILE = L"FontMod.fonts.txt";
+constexpr std::wstring_view WARMUP_FILE = L"FontMod.warmup.txt";
+constexpr std::wstring_view ALLOC_FILE = L"FontMod.alloc.txt";
 
 auto addrCreateFontIndirectExW = CreateFontIndirectExW;
 #ifdef WIN32
@@ -17,10 +43,23 @@ auto addrCreateFontIndirectW = CreateFontIndirectW;
 auto addrCreateFontW = CreateFontW;
 #endif
 auto addrGetStockObject = GetStockObject;
+auto addrDeleteObject = DeleteObject;
 auto addrGetTextMetricsW = GetTextMetricsW;
 auto addrGetTextMetricsA = GetTextMetricsA;
 auto addrGetGlyphOutlineW = GetGlyphOutlineW;
 auto addrGetGlyphOutlineA = GetGlyphOutlineA;
+auto addrEnumFontFamiliesExW = EnumFontFamiliesExW;
+auto addrAddFontResourceExW = AddFontResourceExW;
+auto addrRemoveFontResourceExW = RemoveFontResourceExW;
+auto addrAddFontMemResourceEx = AddFontMemResourceEx;
+auto addrRemoveFontMemResourceEx = RemoveFontMemResourceEx;
+auto addrGetFontData = GetFontData;
+auto addrGetTextExtentPoint32W = GetTextExtentPoint32W;
+auto addrGetTextExtentExPointW = GetTextExtentExPointW;
+auto addrSetTextJustification = SetTextJustification;
+auto addrGetCharWidth32W = GetCharWidth32W;
+auto addrGetCharABCWidthsW = GetCharABCWidthsW;
+auto addrExtTextOutW = ExtTextOutW;
 
 bool removeInternalLeading = false;
 
@@ -38,50 +77,6 @@ decltype(GdipGetGenericFontFamilySerif)* addrGdipGetGenericFontFamilySerif = nul
 using GPFlat::GdipGetGenericFontFamilyMonospace;
 decltype(GdipGetGenericFontFamilyMonospace)* addrGdipGetGenericFontFamilyMonospace = nullptr;
 
-struct FontInfo
-{
-	enum struct OverrideFlags : uint32_t
-	{
-		None = 0,
-		Height = 1 << 1,
-		Width = 1 << 2,
-		Weight = 1 << 3,
-		Italic = 1 << 4,
-		Underline = 1 << 5,
-		StrikeOut = 1 << 6,
-		Charset = 1 << 7,
-		OutPrecision = 1 << 8,
-		ClipPrecision = 1 << 9,
-		Quality = 1 << 10,
-		PitchAndFamily = 1 << 11,
-		HeightOffset = 1 << 12,
-		WidthOffset = 1 << 13,
-		HeightScale = 1 << 14,
-		WidthScale = 1 << 15
-
-	};
-
-	std::wstring name;
-	OverrideFlags overrideFlags = OverrideFlags::None;
-	long height;
-	long width;
-	long heightOffset;
-	long widthOffset;
-	double heightScale;
-	double widthScale;
-	long weight;
-	bool italic;
-	bool underLine;
-	bool strikeOut;
-	BYTE charSet;
-	BYTE outPrecision;
-	BYTE clipPrecision;
-	BYTE quality;
-	BYTE pitchAndFamily;
-};
-
-DEFINE_ENUM_FLAG_OPERATORS(FontInfo::OverrideFlags);
-
 enum struct GSOFontMode
 {
 	Disabled,
@@ -89,98 +84,40 @@ enum struct GSOFontMode
 	UseUserFont // Use user defined font
 };
 
-struct GPFontInfo
-{
-	enum struct OverrideFlags : uint32_t
-	{
-		None = 0,
-		Size = 1 << 1,
-		Style = 1 << 2,
-		Unit = 1 << 3
-	};
-
-	enum struct Style
-	{
-		Regular,
-		Bold,
-		Italic,
-		BoldItalic,
-		Underline,
-		Strikeout
-	};
-
-	enum struct Unit
-	{
-		World,
-		Display,
-		Pixel,
-		Point,
-		Inch,
-		Document,
-		Millimeter
-	};
-
-	OverrideFlags overrideFlags = OverrideFlags::None;
-	float size;
-	Style style;
-	Unit unit;
-};
-
-DEFINE_ENUM_FLAG_OPERATORS(GPFontInfo::OverrideFlags);
-
 std::unordered_map<std::wstring, FontInfo> fontsMap;
+// Wildcard and regex keys of "fonts", checked after exact keys
+FacePatternSet fontsPatterns;
+std::vector<FontInfo> fontsPatternRules; // Indexed by pattern id
 wil::unique_hfile logFile;
 HFONT newGSOFont = nullptr;
 
-std::unordered_map<std::wstring, std::wstring> gdipFontFamiliesMap;
+std::unordered_map<std::wstring, GPFamilyInfo> gdipFontFamiliesMap;
 std::unordered_map<std::wstring, GPFontInfo> gdipFontsMap;
 
 // Character replacement mapping (source char -> target char)
 std::unordered_map<UINT, UINT> glyphReplaceMap;
 bool glyphReplaceEnabled = false;
+// Never destroyed, hooks may still use it during unload
+GlyphReplaceTable& glyphReplaceTable = *new GlyphReplaceTable;
+// Replacements made, logged with the reports rather than on every call
+std::atomic<uint64_t> glyphReplaceStrings = 0;
+std::atomic<uint64_t> glyphReplaceChars = 0;
+std::atomic<uint64_t> glyphReplaceOutlines = 0;
+
+// Modules named in "when: module", only tracked if such rules exist
+ModuleIndex callerModules;
+
+// Other names of the fonts of "fonts" rules, resolved at config time, only read afterwards
+bool fontAliasesEnabled = false;
+FontAliasMap<FontInfo> fontAliases;
+
+// Candidates tried in order when a font doesn't exist, by charset coverage
+FontFallbackChain fontFallbackChain;
 
 std::wstring gdipGFFSansSerif;
 std::wstring gdipGFFSerif;
 std::wstring gdipGFFMonospace;
 
-void OverrideLogFont(const FontInfo& info, LOGFONTW& lf)
-{
-	using OF = FontInfo::OverrideFlags;
-
-	if (!info.name.empty())
-		wcsncpy_s(lf.lfFaceName, LF_FACESIZE, info.name.c_str(), _TRUNCATE);
-	if ((info.overrideFlags & OF::Height) == OF::Height)
-		lf.lfHeight = info.height;
-	if ((info.overrideFlags & OF::Width) == OF::Width)
-		lf.lfWidth = info.width;
-	if (lf.lfHeight != 0 && (info.overrideFlags & OF::HeightOffset) == OF::HeightOffset)
-		lf.lfHeight = lf.lfHeight > 0 ? std::max(1L, lf.lfHeight + info.heightOffset) : std::min(-1L, lf.lfHeight - info.heightOffset);
-	if (lf.lfWidth != 0 && (info.overrideFlags & OF::WidthOffset) == OF::WidthOffset)
-		lf.lfWidth = std::max(1L, lf.lfWidth + info.widthOffset);
-	if (lf.lfHeight != 0 && (info.overrideFlags & OF::HeightScale) == OF::HeightScale)
-		lf.lfHeight = lround(lf.lfHeight * info.heightScale);
-	if (lf.lfWidth != 0 && (info.overrideFlags & OF::WidthScale) == OF::WidthScale)
-		lf.lfWidth = lround(lf.lfWidth * info.widthScale);
-	if ((info.overrideFlags & OF::Weight) == OF::Weight)
-		lf.lfWeight = info.weight;
-	if ((info.overrideFlags & OF::Italic) == OF::Italic)
-		lf.lfItalic = info.italic;
-	if ((info.overrideFlags & OF::Underline) == OF::Underline)
-		lf.lfUnderline = info.underLine;
-	if ((info.overrideFlags & OF::StrikeOut) == OF::StrikeOut)
-		lf.lfStrikeOut = info.strikeOut;
-	if ((info.overrideFlags & OF::Charset) == OF::Charset)
-		lf.lfCharSet = info.charSet;
-	if ((info.overrideFlags & OF::OutPrecision) == OF::OutPrecision)
-		lf.lfOutPrecision = info.outPrecision;
-	if ((info.overrideFlags & OF::ClipPrecision) == OF::ClipPrecision)
-		lf.lfClipPrecision = info.clipPrecision;
-	if ((info.overrideFlags & OF::Quality) == OF::Quality)
-		lf.lfQuality = info.quality;
-	if ((info.overrideFlags & OF::PitchAndFamily) == OF::PitchAndFamily)
-		lf.lfPitchAndFamily = info.pitchAndFamily;
-}
-
 bool IsFontExist(const std::wstring& fontName) {
 	LOGFONT logfont = { 0 };
 	logfont.lfCharSet = DEFAULT_CHARSET;
@@ -212,6 +149,7 @@ struct FontNameInfo {
 
 void LogAllAvailableFonts() {
 	if (!logFile) return;
+	AllocScope scope(AllocPhase::FontList);
 
 	FormatToFile(logFile.get(), "[FontEnumeration] Starting enumeration of all available fonts with alternative names...\n");
 
@@ -274,10 +212,269 @@ void LogAllAvailableFonts() {
 	FormatToFile(logFile.get(), "[FontEnumeration] Enumeration complete. Total unique font families found: {}\n", fontCount);
 }
 
+// WOFF/WOFF2 files found in "fonts" folder, decoded on first font creation
+std::vector<fs::path> pendingWebFonts;
+bool hasPendingWebFonts = false; // Only written in DllMain
+std::once_flag webFontsLoaded;
+
+void LoadWebFonts()
+{
+	AllocScope scope(AllocPhase::WebFonts);
+	struct Result
+	{
+		bool decoded = false;
+		DWORD numFonts = 0;
+		DWORD lastError = 0;
+	};
+	std::vector<Result> results(pendingWebFonts.size());
+
+	auto load = [&](const fs::path& file) {
+		AllocScope scope(AllocPhase::WebFonts); // Worker threads have their own
+		auto& result = results[&file - pendingWebFonts.data()];
+
+		// An exception leaving a parallel algorithm calls std::terminate
+		try
+		{
+			wil::unique_hfile hFile(CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr));
+			if (!hFile)
+			{
+				result.lastError = GetLastError();
+				return;
+			}
+
+			LARGE_INTEGER size;
+			wil::unique_handle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+			if (!hMapping || !GetFileSizeEx(hFile.get(), &size))
+			{
+				result.lastError = GetLastError();
+				return;
+			}
+
+			wil::unique_mapview_ptr<uint8_t> view(static_cast<uint8_t*>(MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0)));
+			if (!view)
+			{
+				result.lastError = GetLastError();
+				return;
+			}
+
+			// Freed with the task, pool threads outlive the loading. AddFontMemResourceEx copies the data.
+			std::vector<uint8_t> sfnt;
+			result.decoded = DecodeWebFont(view.get(), static_cast<size_t>(size.QuadPart), sfnt);
+			if (result.decoded)
+			{
+				if (AddFontMemResourceEx(sfnt.data(), static_cast<DWORD>(sfnt.size()), nullptr, &result.numFonts))
+					liveStats.Add(LiveCounter::UserFontsLoaded, result.numFonts);
+				else
+					result.lastError = GetLastError();
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			result.decoded = false;
+			result.lastError = ERROR_NOT_ENOUGH_MEMORY;
+		}
+		catch (...)
+		{
+			result.decoded = false;
+			result.lastError = ERROR_INVALID_DATA;
+		}
+	};
+
+	// Files are independent, decode them in parallel. Decoding is deferred until here so
+	// that no worker thread is started while DllMain holds the loader lock. The first font
+	// may still be created by another DLL's DllMain, workers would wait for the lock then,
+	// so files are decoded on this thread instead.
+	if (IsLoaderLockHeld())
+		std::for_each(pendingWebFonts.begin(), pendingWebFonts.end(), load);
+	else
+		std::for_each(std::execution::par, pendingWebFonts.begin(), pendingWebFonts.end(), load);
+
+	if (logFile)
+	{
+		for (size_t i = 0; i < pendingWebFonts.size(); ++i)
+		{
+			std::u8string u8str = pendingWebFonts[i].filename().u8string();
+			std::string_view sv(reinterpret_cast<const char*>(u8str.data()), u8str.size());
+			FormatToFile(logFile.get(), "[LoadWebFonts] filename = \"{}\", decoded = {}, fonts = {}, lasterror = {}\n", sv, results[i].decoded, results[i].numFonts, results[i].lastError);
+		}
+	}
+
+	pendingWebFonts.clear();
+	pendingWebFonts.shrink_to_fit();
+}
+
+void EnsureWebFontsLoaded()
+{
+	if (hasPendingWebFonts)
+		std::call_once(webFontsLoaded, LoadWebFonts);
+}
+
+FontInfo* FindFontInfo(const WCHAR* faceName)
+{
+	auto it = fontsMap.find(faceName);
+	if (it != fontsMap.end())
+		return &it->second;
+
+	if (fontAliasesEnabled)
+	{
+		if (auto info = fontAliases.Find(faceName))
+			return info;
+	}
+
+	if (!fontsPatterns.empty())
+	{
+		auto id = fontsPatterns.Match(faceName);
+		if (id != FacePatternSet::npos)
+			return &fontsPatternRules[id];
+	}
+	return nullptr;
+}
+
+// Reads "cmap" of an installed font. Caller should check that the font exists,
+// as GDI maps missing faces to another font. "createFont" must be the unhooked function.
+bool LoadFontCoverage(const std::wstring& name, decltype(CreateFontIndirectExW)* createFont, CoverageSet& coverage)
+{
+	wil::unique_hdc memDC(CreateCompatibleDC(nullptr));
+	if (!memDC)
+		return false;
+
+	ENUMLOGFONTEXDVW elf = {};
+	elf.elfEnumLogfontEx.elfLogFont.lfCharSet = DEFAULT_CHARSET;
+	wcsncpy_s(elf.elfEnumLogfontEx.elfLogFont.lfFaceName, LF_FACESIZE, name.c_str(), _TRUNCATE);
+	wil::unique_hfont hFont(createFont(&elf));
+	if (!hFont)
+		return false;
+
+	auto select = wil::SelectObject(memDC.get(), hFont.get());
+
+	constexpr DWORD cmapTag = GdiTableTag('c', 'm', 'a', 'p');
+	DWORD size = GetFontData(memDC.get(), cmapTag, 0, nullptr, 0);
+	if (size == GDI_ERROR || size == 0)
+		return false;
+
+	std::vector<uint8_t> cmap(size);
+	if (GetFontData(memDC.get(), cmapTag, 0, cmap.data(), size) != size)
+		return false;
+
+	return ParseCmapCoverage(cmap.data(), size, coverage);
+}
+
+const std::wstring* SelectFallbackFont(BYTE charSet)
+{
+	return fontFallbackChain.SelectForCharset(charSet, [](const std::wstring& name, CoverageSet& coverage) {
+		bool loaded = IsFontExist(name) && LoadFontCoverage(name, addrCreateFontIndirectExW, coverage);
+		if (logFile)
+		{
+			std::string u8name;
+			if (Utf16ToUtf8(name, u8name))
+			{
+				FormatToFile(logFile.get(), "[FontFallback] name = \"{}\", coverage loaded = {}\n", u8name, loaded);
+			}
+		}
+	});
+}
+
+VOID CALLBACK OnDllNotification(ULONG reason, const LDR_DLL_NOTIFICATION_DATA* data, PVOID /* context */)
+{
+	if (reason == LDR_DLL_NOTIFICATION_REASON_LOADED)
+		callerModules.Add(reinterpret_cast<uintptr_t>(data->DllBase), data->SizeOfImage, ToStringView(data->BaseDllName));
+	else if (reason == LDR_DLL_NOTIFICATION_REASON_UNLOADED)
+		callerModules.Remove(reinterpret_cast<uintptr_t>(data->DllBase));
+}
+
+// First module on the stack that isn't FontMod or GDI itself
+uint32_t GetCallerModule()
+{
+	void* frames[8];
+	const USHORT count = CaptureStackBackTrace(1, ARRAYSIZE(frames), frames, nullptr);
+	for (USHORT i = 0; i < count; ++i)
+	{
+		auto id = callerModules.Find(reinterpret_cast<uintptr_t>(frames[i]));
+		if (id != ModuleIndex::Skip)
+			return id;
+	}
+	return ModuleIndex::None;
+}
+
+// Module of the first caller outside FontMod and GDI
+HMODULE GetCreationSite()
+{
+	static const HMODULE skip[] = {
+		[] {
+			HMODULE self = nullptr;
+			GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, reinterpret_cast<LPCWSTR>(&GetCreationSite), &self);
+			return self;
+		}(),
+		GetModuleHandleW(L"gdi32.dll"),
+		GetModuleHandleW(L"gdi32full.dll"),
+		GetModuleHandleW(L"win32u.dll"),
+	};
+
+	void* frames[8];
+	const USHORT count = CaptureStackBackTrace(1, ARRAYSIZE(frames), frames, nullptr);
+	for (USHORT i = 0; i < count; ++i)
+	{
+		HMODULE module;
+		if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, static_cast<LPCWSTR>(frames[i]), &module)
+			&& std::find(std::begin(skip), std::end(skip), module) == std::end(skip))
+			return module;
+	}
+	return nullptr;
+}
+
+// Lookups of MatchFontRule for the hook
+struct HookFontRules
+{
+	const FontInfo* All() const
+	{
+		return Find(L"FontAll");
+	}
+
+	const FontInfo* Face(const WCHAR* faceName) const
+	{
+		return FindFontInfo(faceName);
+	}
+
+	const FontInfo* Fallback() const
+	{
+		return Find(L"FontFallback");
+	}
+
+	bool HasFallbackChain() const
+	{
+		return !fontFallbackChain.empty();
+	}
+
+	bool FaceExists(const WCHAR* faceName) const
+	{
+		return IsFontExist(faceName);
+	}
+
+	const std::wstring* SelectFallback(BYTE charSet) const
+	{
+		return SelectFallbackFont(charSet);
+	}
+
+	uint32_t CallerModule() const
+	{
+		return GetCallerModule();
+	}
+
+private:
+	static const FontInfo* Find(const WCHAR* key)
+	{
+		auto it = fontsMap.find(key);
+		return it != fontsMap.end() ? &it->second : nullptr;
+	}
+};
+
 HFONT WINAPI MyCreateFontIndirectExW(const ENUMLOGFONTEXDVW* lpelf)
 {
+	HookTimer timer(HookId::CreateFontIndirectExW);
 	auto lplf = &lpelf->elfEnumLogfontEx.elfLogFont;
 
+	EnsureWebFontsLoaded();
+
 	if (logFile)
 	{
 		std::string name;
@@ -302,37 +499,25 @@ HFONT WINAPI MyCreateFontIndirectExW(const ENUMLOGFONTEXDVW* lpelf)
 	}
 
 	ENUMLOGFONTEXDVW elf;
-	const WCHAR* fallbackFontName = L"FontFallback";
-	const WCHAR* allFontName = L"FontAll";
-	FontInfo* newFontInfo = NULL;
+	HookFontRules rules;
+	const auto match = MatchFontRule(*lplf, rules);
+	const FontInfo* newFontInfo = match.info;
 
-	if (fontsMap.count(allFontName)) {
-		auto it = fontsMap.find(allFontName);
-		if (it != fontsMap.end())
-		{
-			newFontInfo = &it->second;
-		}
-	} else {
-		auto it = fontsMap.find(lplf->lfFaceName);
-		if (it != fontsMap.end())
-		{
-			newFontInfo = &it->second;
-		}
-		else if (fontsMap.count(fallbackFontName) && !IsFontExist(lplf->lfFaceName)) {
-			it = fontsMap.find(fallbackFontName);
-			if (it != fontsMap.end())
-			{
-				newFontInfo = &it->second;
-			}
-		}
-	}
+	if (newFontInfo)
+		ruleStats.Hit(newFontInfo->statsId);
+	else
+		ruleStats.Miss(RuleSection::Fonts, lplf->lfFaceName);
+
+	liveStats.Add(!newFontInfo ? LiveCounter::RuleMisses : match.isFallback ? LiveCounter::FallbackHits : LiveCounter::RuleHits);
 
 	if (newFontInfo)
 	{
 		elf = *lpelf;
 		LOGFONTW& lf = elf.elfEnumLogfontEx.elfLogFont;
 
-		OverrideLogFont(*newFontInfo, lf);
+		OverrideLogFont(*newFontInfo, lf, newFontInfo->patch.UsesDpi() ? threadDpi.Get() : DefaultDpi);
+		if (match.fallbackName)
+			wcsncpy_s(lf.lfFaceName, LF_FACESIZE, match.fallbackName->c_str(), _TRUNCATE);
 
 		lpelf = &elf;
 
@@ -360,7 +545,16 @@ HFONT WINAPI MyCreateFontIndirectExW(const ENUMLOGFONTEXDVW* lpelf)
 		}
 	}
 
-	return addrCreateFontIndirectExW(lpelf);
+	if (fontWarmup.Enabled())
+	{
+		fontWarmup.Start(addrCreateFontIndirectExW);
+		fontWarmup.Record(lpelf->elfEnumLogfontEx.elfLogFont);
+	}
+
+	HFONT hFont = timer.Original([&] { return addrCreateFontIndirectExW(lpelf); });
+	if (fontHandleStats.Enabled())
+		fontHandleStats.Created(hFont, lpelf->elfEnumLogfontEx.elfLogFont, GetCreationSite());
+	return hFont;
 }
 
 #ifdef WIN32
@@ -437,6 +631,151 @@ HGDIOBJ WINAPI MyGetStockObject(int i)
 	return addrGetStockObject(i);
 }
 
+BOOL WINAPI MyDeleteObject(HGDIOBJ ho)
+{
+	// Type must be read before the handle is freed. A handle value reused by another
+	// thread in between is counted as freed once Created sees it again.
+	const bool isFont = GetObjectType(ho) == OBJ_FONT;
+	BOOL result = addrDeleteObject(ho);
+	if (result && isFont)
+	{
+		if (fontHandleStats.Enabled())
+			fontHandleStats.Deleted(ho);
+		if (textExtentCache.Enabled())
+			textExtentCache.FontDeleted(ho);
+		if (charWidthCache.enabled)
+			charWidthCache.FontDeleted(ho);
+	}
+	return result;
+}
+
+int WINAPI MyEnumFontFamiliesExW(HDC hdc, LPLOGFONTW lpLogfont, FONTENUMPROCW lpProc, LPARAM lParam, DWORD dwFlags)
+{
+	HookTimer timer(HookId::EnumFontFamiliesExW);
+	// Qt lists fonts before creating any, web fonts must be listed too
+	EnsureWebFontsLoaded();
+
+	return enumFontCache.Enumerate(hdc, lpLogfont, lpProc, lParam, dwFlags, [&](auto... args) {
+		return timer.Original([&] { return addrEnumFontFamiliesExW(args...); });
+	}, [&](auto replay) {
+		return timer.Original(replay);
+	});
+}
+
+// Fonts added or removed in this process change what EnumFontFamiliesExW returns
+int WINAPI MyAddFontResourceExW(LPCWSTR name, DWORD fl, PVOID res)
+{
+	int result = addrAddFontResourceExW(name, fl, res);
+	if (result)
+		enumFontCache.Invalidate();
+	return result;
+}
+
+BOOL WINAPI MyRemoveFontResourceExW(LPCWSTR name, DWORD fl, PVOID pdv)
+{
+	BOOL result = addrRemoveFontResourceExW(name, fl, pdv);
+	if (result)
+		enumFontCache.Invalidate();
+	return result;
+}
+
+HANDLE WINAPI MyAddFontMemResourceEx(PVOID pFileView, DWORD cjSize, PVOID pvResrved, DWORD* pNumFonts)
+{
+	HANDLE result = addrAddFontMemResourceEx(pFileView, cjSize, pvResrved, pNumFonts);
+	if (result)
+		enumFontCache.Invalidate();
+	return result;
+}
+
+BOOL WINAPI MyRemoveFontMemResourceEx(HANDLE h)
+{
+	BOOL result = addrRemoveFontMemResourceEx(h);
+	if (result)
+		enumFontCache.Invalidate();
+	return result;
+}
+
+DWORD WINAPI MyGetFontData(HDC hdc, DWORD dwTable, DWORD dwOffset, PVOID pvBuffer, DWORD cjBuffer)
+{
+	HookTimer timer(HookId::GetFontData);
+	return fontDataCache.Get(hdc, dwTable, dwOffset, pvBuffer, cjBuffer, [&](auto... args) {
+		return timer.Original([&] { return addrGetFontData(args...); });
+	});
+}
+
+BOOL WINAPI MyGetTextExtentPoint32W(HDC hdc, LPCWSTR lpString, int c, LPSIZE psizl)
+{
+	HookTimer timer(HookId::GetTextExtentPoint32W);
+	return textExtentCache.GetExtentPoint(hdc, lpString, c, psizl, [&](auto... args) {
+		return timer.Original([&] { return addrGetTextExtentPoint32W(args...); });
+	});
+}
+
+BOOL WINAPI MyGetTextExtentExPointW(HDC hdc, LPCWSTR lpszString, int cchString, int nMaxExtent, LPINT lpnFit, LPINT lpnDx, LPSIZE lpSize)
+{
+	HookTimer timer(HookId::GetTextExtentExPointW);
+	return textExtentCache.GetExtentExPoint(hdc, lpszString, cchString, nMaxExtent, lpnFit, lpnDx, lpSize, [&](auto... args) {
+		return timer.Original([&] { return addrGetTextExtentExPointW(args...); });
+	});
+}
+
+BOOL WINAPI MyGetCharWidth32W(HDC hdc, UINT iFirst, UINT iLast, LPINT lpBuffer)
+{
+	HookTimer timer(HookId::GetCharWidth32W);
+	return charWidthCache.GetWidths(hdc, iFirst, iLast, lpBuffer, [&](auto... args) {
+		return timer.Original([&] { return addrGetCharWidth32W(args...); });
+	});
+}
+
+// Glyph indices are left alone, "glyphReplace" maps characters
+BOOL WINAPI MyExtTextOutW(HDC hdc, int x, int y, UINT options, const RECT* lprect, LPCWSTR lpString, UINT c, const INT* lpDx)
+{
+	HookTimer timer(HookId::ExtTextOutW);
+	auto original = [&](LPCWSTR text) {
+		return timer.Original([&] { return addrExtTextOutW(hdc, x, y, options, lprect, text, c, lpDx); });
+	};
+
+	if (!lpString || (options & ETO_GLYPH_INDEX))
+		return original(lpString);
+	const size_t first = glyphReplaceTable.Find(lpString, c);
+	if (first == c)
+		return original(lpString);
+
+	// Most strings fit on the stack
+	WCHAR stackText[512];
+	std::unique_ptr<WCHAR[]> heapText;
+	WCHAR* text = stackText;
+	if (c > ARRAYSIZE(stackText))
+	{
+		heapText = std::make_unique_for_overwrite<WCHAR[]>(c);
+		text = heapText.get();
+	}
+	std::copy_n(lpString, c, text);
+	const size_t replaced = glyphReplaceTable.Replace(text + first, c - first);
+	glyphReplaceStrings.fetch_add(1, std::memory_order_relaxed);
+	glyphReplaceChars.fetch_add(replaced, std::memory_order_relaxed);
+	liveStats.Add(LiveCounter::GlyphReplaceStrings);
+
+	return original(text);
+}
+
+BOOL WINAPI MyGetCharABCWidthsW(HDC hdc, UINT wFirst, UINT wLast, LPABC lpABC)
+{
+	HookTimer timer(HookId::GetCharABCWidthsW);
+	return charWidthCache.GetABCWidths(hdc, wFirst, wLast, lpABC, [&](auto... args) {
+		return timer.Original([&] { return addrGetCharABCWidthsW(args...); });
+	});
+}
+
+// Justification changes extents but can't be read back, such DCs aren't cached
+BOOL WINAPI MySetTextJustification(HDC hdc, int extra, int count)
+{
+	BOOL result = addrSetTextJustification(hdc, extra, count);
+	if (result)
+		textExtentCache.JustificationSet(hdc, extra, count);
+	return result;
+}
+
 void SetFixedValue(FIXED& fixed, double value) {
     fixed.value = (short)value;                    // Integer part
     fixed.fract = (unsigned short)((value - fixed.value) * 65536.0);  // Fractional part
@@ -444,7 +783,8 @@ void SetFixedValue(FIXED& fixed, double value) {
 
 BOOL WINAPI MyGetTextMetricsW(HDC hdc, LPTEXTMETRICW lptm)
 {
-	BOOL result = addrGetTextMetricsW(hdc, lptm);
+	HookTimer timer(HookId::GetTextMetricsW);
+	BOOL result = timer.Original([&] { return addrGetTextMetricsW(hdc, lptm); });
 	
 	if (result && lptm && removeInternalLeading && lptm->tmInternalLeading > 0)
 	{
@@ -469,7 +809,8 @@ BOOL WINAPI MyGetTextMetricsW(HDC hdc, LPTEXTMETRICW lptm)
 
 BOOL WINAPI MyGetTextMetricsA(HDC hdc, LPTEXTMETRICA lptm)
 {
-	BOOL result = addrGetTextMetricsA(hdc, lptm);
+	HookTimer timer(HookId::GetTextMetricsA);
+	BOOL result = timer.Original([&] { return addrGetTextMetricsA(hdc, lptm); });
 	
 	if (result && lptm && removeInternalLeading && lptm->tmInternalLeading > 0)
 	{
@@ -494,14 +835,15 @@ BOOL WINAPI MyGetTextMetricsA(HDC hdc, LPTEXTMETRICA lptm)
 
 DWORD WINAPI MyGetGlyphOutlineW(HDC hdc, UINT uChar, UINT uFormat, LPGLYPHMETRICS lpgm, DWORD cbBuffer, LPVOID lpvBuffer, const MAT2* lpmat2)
 {
+	HookTimer timer(HookId::GetGlyphOutlineW);
 	UINT originalChar = uChar;
-	
+
 	if (glyphReplaceEnabled)
 	{
-		if (glyphReplaceMap.find(uChar) != glyphReplaceMap.end())
+		if (ReplaceGlyphOutlineChar(glyphReplaceMap, uChar))
 		{
-			uChar = glyphReplaceMap[uChar];
-			
+			glyphReplaceOutlines.fetch_add(1, std::memory_order_relaxed);
+
 			if (logFile)
 			{
 				FormatToFile(logFile.get(), "[GetGlyphOutlineW] Character: {} -> {}\n", originalChar, uChar);
@@ -516,7 +858,7 @@ DWORD WINAPI MyGetGlyphOutlineW(HDC hdc, UINT uChar, UINT uFormat, LPGLYPHMETRIC
 		}
 	}
 
-	DWORD result = addrGetGlyphOutlineW(hdc, uChar, uFormat, lpgm, cbBuffer, lpvBuffer, lpmat2);
+	DWORD result = timer.Original([&] { return addrGetGlyphOutlineW(hdc, uChar, uFormat, lpgm, cbBuffer, lpvBuffer, lpmat2); });
 
 	if (result != GDI_ERROR && lpgm && removeInternalLeading)
 	{
@@ -540,14 +882,15 @@ DWORD WINAPI MyGetGlyphOutlineW(HDC hdc, UINT uChar, UINT uFormat, LPGLYPHMETRIC
 
 DWORD WINAPI MyGetGlyphOutlineA(HDC hdc, UINT uChar, UINT uFormat, LPGLYPHMETRICS lpgm, DWORD cbBuffer, LPVOID lpvBuffer, const MAT2* lpmat2)
 {
+	HookTimer timer(HookId::GetGlyphOutlineA);
 	UINT originalChar = uChar;
-	
+
 	if (glyphReplaceEnabled)
-	{	
-		if (glyphReplaceMap.find(uChar) != glyphReplaceMap.end())
+	{
+		if (ReplaceGlyphOutlineChar(glyphReplaceMap, uChar))
 		{
-			uChar = glyphReplaceMap[uChar];
-			
+			glyphReplaceOutlines.fetch_add(1, std::memory_order_relaxed);
+
 			if (logFile)
 			{
 				FormatToFile(logFile.get(), "[GetGlyphOutlineA] Character: {} -> {}\n", originalChar, uChar);
@@ -562,7 +905,7 @@ DWORD WINAPI MyGetGlyphOutlineA(HDC hdc, UINT uChar, UINT uFormat, LPGLYPHMETRIC
 		}
 	}
 
-	DWORD result = addrGetGlyphOutlineA(hdc, uChar, uFormat, lpgm, cbBuffer, lpvBuffer, lpmat2);
+	DWORD result = timer.Original([&] { return addrGetGlyphOutlineA(hdc, uChar, uFormat, lpgm, cbBuffer, lpvBuffer, lpmat2); });
 
 	if (result != GDI_ERROR && lpgm && removeInternalLeading)
 	{
@@ -593,6 +936,9 @@ using Gdiplus::GpFont;
 
 GpStatus WINGDIPAPI MyGdipCreateFontFamilyFromName(GDIPCONST WCHAR* name, GpFontCollection* fontCollection, GpFontFamily** fontFamily)
 {
+	HookTimer timer(HookId::GdipCreateFontFamilyFromName);
+	EnsureWebFontsLoaded();
+
 	if (logFile)
 	{
 		std::string u8name;
@@ -602,15 +948,23 @@ GpStatus WINGDIPAPI MyGdipCreateFontFamilyFromName(GDIPCONST WCHAR* name, GpFont
 		}
 	}
 
-	auto it = gdipFontFamiliesMap.find(name);
-	if (it != gdipFontFamiliesMap.end())
-		name = it->second.c_str();
+	const GPFamilyInfo* rule;
+	name = ResolveGdipFamily(gdipFontFamiliesMap, name, rule);
+	if (rule)
+	{
+		ruleStats.Hit(rule->statsId);
+	}
+	else if (ruleStats.Enabled() && !gdipFontsMap.contains(name))
+	{
+		ruleStats.Miss(RuleSection::Gdiplus, name);
+	}
 
-	return addrGdipCreateFontFamilyFromName(name, fontCollection, fontFamily);
+	return timer.Original([&] { return addrGdipCreateFontFamilyFromName(name, fontCollection, fontFamily); });
 }
 
 GpStatus WINGDIPAPI MyGdipCreateFont(GDIPCONST GpFontFamily* fontFamily, REAL emSize, INT style, Unit unit, GpFont** font)
 {
+	HookTimer timer(HookId::GdipCreateFont);
 	std::wstring name(LF_FACESIZE, 0);
 	if (addrGdipGetFamilyName(fontFamily, name.data(), LANG_NEUTRAL) == GpStatus::Ok)
 	{
@@ -625,38 +979,128 @@ GpStatus WINGDIPAPI MyGdipCreateFont(GDIPCONST GpFontFamily* fontFamily, REAL em
 			}
 		}
 
-		auto it = gdipFontsMap.find(name);
-		if (it != gdipFontsMap.end())
+		if (auto rule = OverrideGdipFont(gdipFontsMap, name, emSize, style, unit))
 		{
-			using OF = GPFontInfo::OverrideFlags;
-			if ((it->second.overrideFlags & OF::Size) == OF::Size)
-				emSize = it->second.size;
-			if ((it->second.overrideFlags & OF::Style) == OF::Style)
-				style = static_cast<INT>(it->second.style);
-			if ((it->second.overrideFlags & OF::Unit) == OF::Unit)
-				unit = static_cast<Unit>(it->second.unit);
+			ruleStats.Hit(rule->statsId);
 		}
 	}
 
-	return addrGdipCreateFont(fontFamily, emSize, style, unit, font);
+	return timer.Original([&] { return addrGdipCreateFont(fontFamily, emSize, style, unit, font); });
 }
 
 GpStatus WINGDIPAPI MyGdipGetGenericFontFamilySansSerif(GpFontFamily** nativeFamily)
 {
-	return addrGdipCreateFontFamilyFromName(gdipGFFSansSerif.c_str(), nullptr, nativeFamily);
+	HookTimer timer(HookId::GdipGetGenericFontFamilySansSerif);
+	return timer.Original([&] { return addrGdipCreateFontFamilyFromName(gdipGFFSansSerif.c_str(), nullptr, nativeFamily); });
 }
 
 GpStatus WINGDIPAPI MyGdipGetGenericFontFamilySerif(GpFontFamily** nativeFamily)
 {
-	return addrGdipCreateFontFamilyFromName(gdipGFFSerif.c_str(), nullptr, nativeFamily);
+	HookTimer timer(HookId::GdipGetGenericFontFamilySerif);
+	return timer.Original([&] { return addrGdipCreateFontFamilyFromName(gdipGFFSerif.c_str(), nullptr, nativeFamily); });
 }
 
 GpStatus WINGDIPAPI MyGdipGetGenericFontFamilyMonospace(GpFontFamily** nativeFamily)
 {
-	return addrGdipCreateFontFamilyFromName(gdipGFFMonospace.c_str(), nullptr, nativeFamily);
+	HookTimer timer(HookId::GdipGetGenericFontFamilyMonospace);
+	return timer.Original([&] { return addrGdipCreateFontFamilyFromName(gdipGFFMonospace.c_str(), nullptr, nativeFamily); });
+}
+
+// Set while GDI+ hooks wait for gdiplus.dll, and the module they are attached to. Only
+// used under the loader lock, by DllMain and dll notifications.
+bool gdiplusHooksPending = false;
+HMODULE gdiplusHooked = nullptr;
+
+// Inside a Detours transaction, returns the number of hooks attached
+int AttachGdiplusHooks(HMODULE hGdiplus)
+{
+	int attached = 0;
+	if (!gdipFontFamiliesMap.empty())
+	{
+		addrGdipCreateFontFamilyFromName = GetProcAddressByFunctionDeclaration(hGdiplus, GdipCreateFontFamilyFromName);
+		if (addrGdipCreateFontFamilyFromName && DetourAttach(&(PVOID&)addrGdipCreateFontFamilyFromName, MyGdipCreateFontFamilyFromName) == NO_ERROR)
+			++attached;
+	}
+
+	if (!gdipFontsMap.empty())
+	{
+		addrGdipCreateFont = GetProcAddressByFunctionDeclaration(hGdiplus, GdipCreateFont);
+		if (addrGdipCreateFont)
+		{
+			addrGdipGetFamilyName = GetProcAddressByFunctionDeclaration(hGdiplus, GdipGetFamilyName);
+			if (addrGdipGetFamilyName && DetourAttach(&(PVOID&)addrGdipCreateFont, MyGdipCreateFont) == NO_ERROR)
+				++attached;
+		}
+	}
+
+	if (!gdipGFFSansSerif.empty())
+	{
+		addrGdipGetGenericFontFamilySansSerif = GetProcAddressByFunctionDeclaration(hGdiplus, GdipGetGenericFontFamilySansSerif);
+		if (addrGdipGetGenericFontFamilySansSerif && DetourAttach(&(PVOID&)addrGdipGetGenericFontFamilySansSerif, MyGdipGetGenericFontFamilySansSerif) == NO_ERROR)
+			++attached;
+	}
+
+	if (!gdipGFFSerif.empty())
+	{
+		addrGdipGetGenericFontFamilySerif = GetProcAddressByFunctionDeclaration(hGdiplus, GdipGetGenericFontFamilySerif);
+		if (addrGdipGetGenericFontFamilySerif && DetourAttach(&(PVOID&)addrGdipGetGenericFontFamilySerif, MyGdipGetGenericFontFamilySerif) == NO_ERROR)
+			++attached;
+	}
+
+	if (!gdipGFFMonospace.empty())
+	{
+		addrGdipGetGenericFontFamilyMonospace = GetProcAddressByFunctionDeclaration(hGdiplus, GdipGetGenericFontFamilyMonospace);
+		if (addrGdipGetGenericFontFamilyMonospace && DetourAttach(&(PVOID&)addrGdipGetGenericFontFamilyMonospace, MyGdipGetGenericFontFamilyMonospace) == NO_ERROR)
+			++attached;
+	}
+	return attached;
+}
+
+// The loaded gdiplus.dll is hooked, which may be a side-by-side version rather than the
+// system one. Runs before its DllMain, so nothing can call it yet.
+//
+// When the hooked gdiplus.dll is unloaded, the patched code goes with it and the
+// trampolines point at unmapped memory. They are forgotten, not detached, and the hooks
+// wait for the next load.
+VOID CALLBACK OnGdiplusDllNotification(ULONG reason, const LDR_DLL_NOTIFICATION_DATA* data, PVOID /* context */)
+{
+	if (reason == LDR_DLL_NOTIFICATION_REASON_UNLOADED && gdiplusHooked && data->DllBase == gdiplusHooked)
+	{
+		gdiplusHooked = nullptr;
+		addrGdipCreateFontFamilyFromName = nullptr;
+		addrGdipCreateFont = nullptr;
+		addrGdipGetFamilyName = nullptr;
+		addrGdipGetGenericFontFamilySansSerif = nullptr;
+		addrGdipGetGenericFontFamilySerif = nullptr;
+		addrGdipGetGenericFontFamilyMonospace = nullptr;
+		gdiplusHooksPending = true;
+
+		if (logFile)
+		{
+			FormatToFile(logFile.get(), "[OnGdiplusDllNotification] gdiplus.dll unloaded from {:x}, GDI+ hooks wait for the next load\n", reinterpret_cast<size_t>(data->DllBase));
+		}
+		return;
+	}
+
+	if (reason != LDR_DLL_NOTIFICATION_REASON_LOADED || !gdiplusHooksPending || !iequals(ToStringView(data->BaseDllName), L"gdiplus.dll"))
+		return;
+	gdiplusHooksPending = false;
+
+	DetourTransactionBegin();
+	DetourUpdateThread(GetCurrentThread());
+	const int attached = AttachGdiplusHooks(static_cast<HMODULE>(data->DllBase));
+	const LONG error = DetourTransactionCommit();
+	if (error == NO_ERROR && attached)
+		gdiplusHooked = static_cast<HMODULE>(data->DllBase);
+
+	if (logFile)
+	{
+		FormatToFile(logFile.get(), "[OnGdiplusDllNotification] gdiplus.dll loaded at {:x}, GDI+ hooks attached = {}, DetourTransactionCommit = {}\n", reinterpret_cast<size_t>(data->DllBase), error == NO_ERROR ? attached : 0, error);
+	}
 }
 
-FontInfo GetFontInfo(const ryml::NodeRef& map)
+// Values that can't be parsed are reported in "errMsg"
+FontInfo GetFontInfo(const ryml::NodeRef& map, std::wstring& errMsg)
 {
 	FontInfo info;
 	for (const auto& i : map)
@@ -666,6 +1110,18 @@ FontInfo GetFontInfo(const ryml::NodeRef& map)
 		if (!i.has_val())
 			continue;
 
+		auto parseSize = [&](ScaledSize& size, OF flag) {
+			if (ParseScaledSize(std::string_view(i.val().str, i.val().len), size))
+			{
+				info.overrideFlags |= flag;
+				return;
+			}
+			std::wstring key, value;
+			Utf8ToUtf16(i.key(), key);
+			Utf8ToUtf16(i.val(), value);
+			errMsg.append(std::format(L"Invalid {} \"{}\", expected pixels or a size in pt or dip.\n", key, value));
+		};
+
 		if (i.key() == "replace" || i.key() == "name")
 		{
 			if (!Utf8ToUtf16(i.val(), info.name))
@@ -673,23 +1129,19 @@ FontInfo GetFontInfo(const ryml::NodeRef& map)
 		}
 		else if (i.key() == "size")
 		{
-			i >> info.height;
-			info.overrideFlags |= OF::Height;
+			parseSize(info.height, OF::Height);
 		}
 		else if (i.key() == "width")
 		{
-			i >> info.width;
-			info.overrideFlags |= OF::Width;
+			parseSize(info.width, OF::Width);
 		}
 		else if (i.key() == "sizeOffset")
 		{
-			i >> info.heightOffset;
-			info.overrideFlags |= OF::HeightOffset;
+			parseSize(info.heightOffset, OF::HeightOffset);
 		}
 		else if (i.key() == "widthOffset")
 		{
-			i >> info.widthOffset;
-			info.overrideFlags |= OF::WidthOffset;
+			parseSize(info.widthOffset, OF::WidthOffset);
 		}
 		else if (i.key() == "sizeScale")
 		{
@@ -747,6 +1199,118 @@ FontInfo GetFontInfo(const ryml::NodeRef& map)
 			info.overrideFlags |= OF::PitchAndFamily;
 		}
 	}
+	CompileOverride(info);
+	if (info.patch.UsesDpi())
+		threadDpi.Enable();
+	return info;
+}
+
+void ReadRange(const ryml::NodeRef& node, long& min, long& max)
+{
+	if (node.is_seq() && node.num_children() == 2)
+	{
+		node[0] >> min;
+		node[1] >> max;
+	}
+	else if (node.has_val())
+	{
+		node >> min;
+		max = min;
+	}
+}
+
+FontCondition GetFontCondition(const ryml::NodeRef& map)
+{
+	FontCondition condition;
+	for (const auto& i : map)
+	{
+		if (i.key() == "size" || i.key() == "height")
+		{
+			ReadRange(i, condition.heightMin, condition.heightMax);
+		}
+		else if (i.key() == "weight")
+		{
+			ReadRange(i, condition.weightMin, condition.weightMax);
+		}
+		else if (i.key() == "module")
+		{
+			auto addModule = [&](const ryml::NodeRef& node) {
+				std::wstring name;
+				if (node.has_val() && Utf8ToUtf16(node.val(), name))
+					condition.modules.push_back(callerModules.RegisterName(name));
+			};
+			if (i.is_seq())
+			{
+				for (const auto& j : i)
+					addModule(j);
+			}
+			else
+			{
+				addModule(i);
+			}
+		}
+		else if (i.key() == "charSet" || i.key() == "charset")
+		{
+			condition.charsets.reset();
+			if (i.is_seq())
+			{
+				for (const auto& j : i)
+				{
+					uint32_t charSet;
+					j >> charSet;
+					condition.charsets.set(charSet & 0xFF);
+				}
+			}
+			else if (i.has_val())
+			{
+				uint32_t charSet;
+				i >> charSet;
+				condition.charsets.set(charSet & 0xFF);
+			}
+		}
+	}
+	return condition;
+}
+
+// A rule is either a map, a map with "when" conditions, or a sequence of those.
+// Each variant is counted by rule stats on its own, as "key [n]".
+FontInfo GetFontRule(const ryml::NodeRef& node, std::wstring_view key, std::wstring& errMsg)
+{
+	const auto when = c4::to_csubstr("when");
+	if (node.is_map() && !node.has_child(when))
+	{
+		auto info = GetFontInfo(node, errMsg);
+		info.statsId = ruleStats.AddRule(RuleSection::Fonts, key);
+		return info;
+	}
+
+	auto rules = std::make_shared<ConditionalRules<FontInfo>>();
+	uint32_t variantCount = 0;
+	auto addVariant = [&](const ryml::NodeRef& map) {
+		FontCondition condition;
+		if (map.has_child(when))
+			condition = GetFontCondition(map[when]);
+		auto info = GetFontInfo(map, errMsg);
+		info.statsId = ruleStats.AddRule(RuleSection::Fonts, std::format(L"{} [{}]", key, ++variantCount));
+		rules->Add(condition, std::move(info));
+	};
+
+	if (node.is_seq())
+	{
+		for (const auto& i : node)
+		{
+			if (i.is_map())
+				addVariant(i);
+		}
+	}
+	else
+	{
+		addVariant(node);
+	}
+	rules->Compile();
+
+	FontInfo info;
+	info.variants = std::move(rules);
 	return info;
 }
 
@@ -761,7 +1325,10 @@ void AddGdiplusFontInfo(const ryml::NodeRef& map)
 		{
 			std::wstring find, name;
 			if (Utf8ToUtf16(map.key(), find) && Utf8ToUtf16(i.val(), name))
-				gdipFontFamiliesMap.emplace(std::move(find), std::move(name));
+			{
+				const auto statsId = ruleStats.AddRule(RuleSection::Gdiplus, find);
+				gdipFontFamiliesMap.emplace(std::move(find), GPFamilyInfo{ std::move(name), statsId });
+			}
 			return;
 		}
 
@@ -862,13 +1429,18 @@ void AddGdiplusFontInfo(const ryml::NodeRef& map)
 		{
 			std::wstring find;
 			if (Utf8ToUtf16(map.key(), find))
+			{
+				info.statsId = ruleStats.AddRule(RuleSection::Gdiplus, find);
 				gdipFontsMap.emplace(std::move(find), std::move(info));
+			}
 		}
 	}
 }
 
 bool LoadSettings(const fs::path& fileName, GSOFontMode& fixGSOFont, LOGFONT& userGSOFont, bool& debug, bool& removeInternalLeadingConfig, std::wstring& errMsg, bool& glyphReplaceEnabledConfig, std::unordered_map<UINT, UINT>& glyphReplaceMapConfig)
 {
+	AllocScope scope(AllocPhase::Config);
+	const size_t errLength = errMsg.size();
 	auto config = LoadUtf8FileWithoutBOM(fileName.c_str());
 	const auto tree = [&] {
 		auto tree = ryml::parse(c4::substr(config.data(), config.size()));
@@ -882,18 +1454,41 @@ bool LoadSettings(const fs::path& fileName, GSOFontMode& fixGSOFont, LOGFONT& us
 		return false;
 	}
 
+	// Rules get their ids while parsing, so this option is read first
+	for (const auto& i : tree.rootref())
+	{
+		if (i.has_val() && i.key() == "ruleStats")
+		{
+			bool enable = false;
+			i >> enable;
+			if (enable)
+				ruleStats.Enable(fileName.parent_path() / RULE_STATS_FILE);
+		}
+	}
+
 	for (const auto& i : tree.rootref())
 	{
 		if (i.is_map() && i.key() == "fonts")
 		{
 			for (const auto& j : i)
 			{
-				if (j.is_map())
+				if (j.is_map() || j.is_seq())
 				{
-					auto info = GetFontInfo(j);
 					std::wstring find;
-					if (Utf8ToUtf16(j.key(), find))
+					if (!Utf8ToUtf16(j.key(), find))
+						continue;
+
+					auto info = GetFontRule(j, find, errMsg);
+					if (FacePatternSet::IsPattern(find))
+					{
+						if (!fontsPatterns.Add(find, errMsg))
+							return false;
+						fontsPatternRules.push_back(std::move(info));
+					}
+					else
+					{
 						fontsMap.emplace(std::move(find), std::move(info));
+					}
 				}
 			}
 		}
@@ -908,8 +1503,8 @@ bool LoadSettings(const fs::path& fileName, GSOFontMode& fixGSOFont, LOGFONT& us
 			}
 			else if (i.is_map())
 			{
-				auto info = GetFontInfo(i);
-				OverrideLogFont(info, userGSOFont);
+				auto info = GetFontInfo(i, errMsg);
+				OverrideLogFont(info, userGSOFont, info.patch.UsesDpi() ? threadDpi.SystemDpi() : DefaultDpi);
 			}
 		}
 		else if (i.is_map() && i.key() == "gdiplus")
@@ -959,17 +1554,107 @@ bool LoadSettings(const fs::path& fileName, GSOFontMode& fixGSOFont, LOGFONT& us
 				}
 			}
 		}
+		else if (i.is_seq() && i.key() == "fontFallbackChain")
+		{
+			for (const auto& j : i)
+			{
+				std::wstring name;
+				if (j.has_val() && Utf8ToUtf16(j.val(), name) && !name.empty())
+					fontFallbackChain.names.push_back(std::move(name));
+			}
+		}
+		else if (i.has_val() && i.key() == "fontFallbackSample")
+		{
+			Utf8ToUtf16(i.val(), fontFallbackChain.sample);
+		}
+		else if (i.has_val() && i.key() == "fontAliases")
+		{
+			i >> fontAliasesEnabled;
+		}
+		else if (i.has_val() && i.key() == "latencyStats")
+		{
+			bool enable = false;
+			i >> enable;
+			if (enable)
+				latencyStats.Enable(fileName.parent_path() / LATENCY_FILE);
+		}
+		else if (i.has_val() && i.key() == "liveStats")
+		{
+			bool enable = false;
+			i >> enable;
+			if (enable)
+				liveStats.Publish();
+		}
+		else if (i.has_val() && i.key() == "fontHandleStats")
+		{
+			bool enable = false;
+			i >> enable;
+			if (enable)
+				fontHandleStats.Enable(fileName.parent_path() / FONT_HANDLES_FILE);
+		}
+		else if (i.has_val() && i.key() == "enumFontCache")
+		{
+			i >> enumFontCache.cacheEnabled;
+		}
+		else if (i.is_seq() && i.key() == "hideFonts")
+		{
+			for (const auto& j : i)
+			{
+				std::wstring name;
+				if (j.has_val() && Utf8ToUtf16(j.val(), name) && !name.empty())
+					enumFontCache.Hide(name);
+			}
+		}
+		else if (i.has_val() && i.key() == "fontDataCache")
+		{
+			size_t megabytes = 0;
+			i >> megabytes;
+			if (megabytes)
+				fontDataCache.Enable(megabytes << 20);
+		}
+		else if (i.has_val() && i.key() == "textExtentCache")
+		{
+			size_t entries = 0;
+			i >> entries;
+			textExtentCache.Enable(entries);
+		}
+		else if (i.has_val() && i.key() == "charWidthCache")
+		{
+			i >> charWidthCache.enabled;
+		}
+		else if (i.has_val() && i.key() == "memoryBudget")
+		{
+			size_t megabytes = 0;
+			i >> megabytes;
+			memoryBudget.Enable(megabytes << 20);
+		}
+		else if (i.has_val() && i.key() == "fontWarmup")
+		{
+			bool enable = false;
+			i >> enable;
+			if (enable)
+				fontWarmup.Enable(fileName.parent_path() / WARMUP_FILE);
+		}
 		else if (i.has_val() && i.key() == "debug")
 		{
 			i >> debug;
 		}
 	}
 
+	if (!fontsPatterns.empty() && !fontsPatterns.Compile(errMsg))
+		return false;
+
+	// Errors that didn't stop reading, all of them are shown at once
+	if (errMsg.size() != errLength)
+		return false;
+
+	ruleStats.Start();
 	return true;
 }
 
 void LoadUserFonts(const fs::path& path)
 {
+	AllocScope scope(AllocPhase::UserFonts);
 	try
 	{
 		auto fontsPath = path / L"fonts";
@@ -978,7 +1663,17 @@ void LoadUserFonts(const fs::path& path)
 			for (auto& f : fs::directory_iterator(fontsPath))
 			{
 				if (f.is_directory()) continue;
+
+				auto ext = f.path().extension();
+				if (iequals(ext.native(), L".woff") || iequals(ext.native(), L".woff2"))
+				{
+					pendingWebFonts.push_back(f.path());
+					hasPendingWebFonts = true;
+					continue;
+				}
+
 				int ret = AddFontResourceExW(f.path().c_str(), FR_PRIVATE, 0);
+				liveStats.Add(LiveCounter::UserFontsLoaded, ret);
 				if (logFile)
 				{
 					std::u8string u8str = f.path().filename().u8string();
@@ -997,11 +1692,58 @@ void LoadUserFonts(const fs::path& path)
 	}
 }
 
-BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, [[maybe_unused]] LPVOID lpReserved)
+#ifdef FONTMOD_ALLOC_PROFILE
+fs::path allocReportPath;
+
+// Atomics only, can be written at process exit
+void WriteAllocReport()
+{
+	wil::unique_hfile hFile(CreateFileW(allocReportPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+	if (!hFile)
+		return;
+
+	FormatToFile(hFile.get(), "[AllocStats] pid = {}\n", GetCurrentProcessId());
+	FormatToFile(hFile.get(), "{:<34} {:>10} {:>10} {:>14} {:>12} {:>12}\n", "scope", "allocs", "frees", "bytes", "live", "peak");
+	for (const auto& u : allocStats.Snapshot())
+		FormatToFile(hFile.get(), "{:<34} {:>10} {:>10} {:>14} {:>12} {:>12}\n", u.scope, u.allocations, u.frees, u.bytes, u.live, u.peak);
+}
+#endif
+
+void WriteReports(bool atExit)
+{
+	AllocScope scope(AllocPhase::Reports);
+	if (latencyStats.Enabled())
+		latencyStats.WriteReport(atExit);
+	ruleStats.WriteReport(atExit);
+	fontHandleStats.WriteReport(atExit);
+	if (logFile && fontDataCache.Enabled())
+		fontDataCache.LogStats(logFile.get(), atExit);
+	if (logFile && textExtentCache.Enabled())
+		textExtentCache.LogStats(logFile.get());
+	if (logFile && charWidthCache.enabled)
+		charWidthCache.LogStats(logFile.get());
+	if (logFile && glyphReplaceEnabled)
+	{
+		FormatToFile(logFile.get(), "[GlyphReplace] ExtTextOutW strings = {}, characters = {}, GetGlyphOutline calls = {}\n",
+			glyphReplaceStrings.load(std::memory_order_relaxed), glyphReplaceChars.load(std::memory_order_relaxed), glyphReplaceOutlines.load(std::memory_order_relaxed));
+	}
+	if (logFile && memoryBudget.Enabled())
+	{
+		FormatToFile(logFile.get(), "[MemoryBudget] cap = {}, used = {}\n", memoryBudget.Cap(), memoryBudget.Used());
+		for (const auto& u : memoryBudget.Snapshot())
+			FormatToFile(logFile.get(), "  {}: bytes = {}, hits = {}, bytes trimmed = {}\n", u.name, u.bytes, u.hits, u.trimmed);
+	}
+#ifdef FONTMOD_ALLOC_PROFILE
+	WriteAllocReport();
+#endif
+}
+
+BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved)
 {
 	if (ul_reason_for_call == DLL_PROCESS_ATTACH)
 	{
 		DisableThreadLibraryCalls(hModule);
+		AllocScope scope(AllocPhase::Startup);
 
 #if _DEBUG
 		MessageBoxW(0, L"DLL_PROCESS_ATTACH", L"", 0);
@@ -1039,6 +1781,15 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, [[maybe_unused]
 			return TRUE;
 		}
 
+#ifdef FONTMOD_ALLOC_PROFILE
+		allocReportPath = path / ALLOC_FILE;
+#endif
+
+		const bool hasReports = allocProfileBuild || latencyStats.Enabled() || ruleStats.Enabled() || fontHandleStats.Enabled();
+		if (hasReports)
+			reportEvent.SetCallback([] { WriteReports(false); });
+		hookStatsEnabled = hasReports || liveStats.Published();
+
 		if (debug)
 		{
 			auto logPath = path / LOG_FILE;
@@ -1047,6 +1798,56 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, [[maybe_unused]
 
 		LoadUserFonts(path);
 
+		// After the private fonts are added, and before CreateFontIndirectW is hooked
+		if (fontAliasesEnabled)
+		{
+			const size_t resolved = BuildFontAliasMap(fontAliases, fontsMap);
+			if (logFile)
+			{
+				FormatToFile(logFile.get(), "[FontAliases] rules = {}, resolved = {}, names = {}\n", fontsMap.size(), resolved, fontAliases.aliases.size());
+			}
+		}
+
+		if (memoryBudget.Enabled())
+		{
+			if (enumFontCache.cacheEnabled)
+				enumFontCache.UseMemoryBudget();
+			if (fontDataCache.Enabled())
+				fontDataCache.UseMemoryBudget();
+			if (textExtentCache.Enabled())
+				textExtentCache.UseMemoryBudget();
+			if (charWidthCache.enabled)
+				charWidthCache.UseMemoryBudget();
+		}
+
+		if (glyphReplaceEnabled)
+		{
+			const size_t skipped = glyphReplaceTable.Build(glyphReplaceMap);
+			if (logFile && skipped)
+			{
+				FormatToFile(logFile.get(), "[DllMain] glyphReplace: {} entries are not used by ExtTextOutW\n", skipped);
+			}
+		}
+
+		if (!callerModules.empty())
+		{
+			callerModules.RegisterSkip(GetModuleFsPath(hModule).filename().native());
+			callerModules.RegisterSkip(L"gdi32.dll");
+			callerModules.RegisterSkip(L"gdi32full.dll");
+			callerModules.RegisterSkip(L"win32u.dll");
+
+			// Register first so no module is missed, Add ignores duplicates
+			bool registered = RegisterDllNotification(OnDllNotification, nullptr);
+			ForEachLoadedModule([](uintptr_t base, size_t size, std::wstring_view name) {
+				callerModules.Add(base, size, name);
+			});
+
+			if (logFile)
+			{
+				FormatToFile(logFile.get(), "[DllMain] Caller module tracking, dll notification registered = {}\n", registered);
+			}
+		}
+
 		if (debug)
 		{
 			// Log all available fonts when program starts
@@ -1090,6 +1891,10 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, [[maybe_unused]
 			if (addrGetStockObjectFull)
 				addrGetStockObject = addrGetStockObjectFull;
 
+			auto addrDeleteObjectFull = GetProcAddressByFunctionDeclaration(hGdiFull, DeleteObject);
+			if (addrDeleteObjectFull)
+				addrDeleteObject = addrDeleteObjectFull;
+
 			auto addrCreateFontIndirectExWFull = GetProcAddressByFunctionDeclaration(hGdiFull, CreateFontIndirectExW);
 			if (addrCreateFontIndirectExWFull)
 				addrCreateFontIndirectExW = addrCreateFontIndirectExWFull;
@@ -1109,6 +1914,54 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, [[maybe_unused]
 			auto addrGetGlyphOutlineAFull = GetProcAddressByFunctionDeclaration(hGdiFull, GetGlyphOutlineA);
 			if (addrGetGlyphOutlineAFull)
 				addrGetGlyphOutlineA = addrGetGlyphOutlineAFull;
+
+			auto addrEnumFontFamiliesExWFull = GetProcAddressByFunctionDeclaration(hGdiFull, EnumFontFamiliesExW);
+			if (addrEnumFontFamiliesExWFull)
+				addrEnumFontFamiliesExW = addrEnumFontFamiliesExWFull;
+
+			auto addrAddFontResourceExWFull = GetProcAddressByFunctionDeclaration(hGdiFull, AddFontResourceExW);
+			if (addrAddFontResourceExWFull)
+				addrAddFontResourceExW = addrAddFontResourceExWFull;
+
+			auto addrRemoveFontResourceExWFull = GetProcAddressByFunctionDeclaration(hGdiFull, RemoveFontResourceExW);
+			if (addrRemoveFontResourceExWFull)
+				addrRemoveFontResourceExW = addrRemoveFontResourceExWFull;
+
+			auto addrAddFontMemResourceExFull = GetProcAddressByFunctionDeclaration(hGdiFull, AddFontMemResourceEx);
+			if (addrAddFontMemResourceExFull)
+				addrAddFontMemResourceEx = addrAddFontMemResourceExFull;
+
+			auto addrRemoveFontMemResourceExFull = GetProcAddressByFunctionDeclaration(hGdiFull, RemoveFontMemResourceEx);
+			if (addrRemoveFontMemResourceExFull)
+				addrRemoveFontMemResourceEx = addrRemoveFontMemResourceExFull;
+
+			auto addrGetFontDataFull = GetProcAddressByFunctionDeclaration(hGdiFull, GetFontData);
+			if (addrGetFontDataFull)
+				addrGetFontData = addrGetFontDataFull;
+
+			auto addrGetTextExtentPoint32WFull = GetProcAddressByFunctionDeclaration(hGdiFull, GetTextExtentPoint32W);
+			if (addrGetTextExtentPoint32WFull)
+				addrGetTextExtentPoint32W = addrGetTextExtentPoint32WFull;
+
+			auto addrGetTextExtentExPointWFull = GetProcAddressByFunctionDeclaration(hGdiFull, GetTextExtentExPointW);
+			if (addrGetTextExtentExPointWFull)
+				addrGetTextExtentExPointW = addrGetTextExtentExPointWFull;
+
+			auto addrSetTextJustificationFull = GetProcAddressByFunctionDeclaration(hGdiFull, SetTextJustification);
+			if (addrSetTextJustificationFull)
+				addrSetTextJustification = addrSetTextJustificationFull;
+
+			auto addrGetCharWidth32WFull = GetProcAddressByFunctionDeclaration(hGdiFull, GetCharWidth32W);
+			if (addrGetCharWidth32WFull)
+				addrGetCharWidth32W = addrGetCharWidth32WFull;
+
+			auto addrGetCharABCWidthsWFull = GetProcAddressByFunctionDeclaration(hGdiFull, GetCharABCWidthsW);
+			if (addrGetCharABCWidthsWFull)
+				addrGetCharABCWidthsW = addrGetCharABCWidthsWFull;
+
+			auto addrExtTextOutWFull = GetProcAddressByFunctionDeclaration(hGdiFull, ExtTextOutW);
+			if (addrExtTextOutWFull)
+				addrExtTextOutW = addrExtTextOutWFull;
 		}
 
 		DetourTransactionBegin();
@@ -1127,52 +1980,63 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, [[maybe_unused]
 		DetourAttach(&(PVOID&)addrGetTextMetricsA, MyGetTextMetricsA);
 		DetourAttach(&(PVOID&)addrGetGlyphOutlineW, MyGetGlyphOutlineW);
 		DetourAttach(&(PVOID&)addrGetGlyphOutlineA, MyGetGlyphOutlineA);
+		if (fontHandleStats.Enabled() || textExtentCache.Enabled() || charWidthCache.enabled)
+		{
+			DetourAttach(&(PVOID&)addrDeleteObject, MyDeleteObject);
+		}
+		if (enumFontCache.cacheEnabled || enumFontCache.HasHidden())
+		{
+			DetourAttach(&(PVOID&)addrEnumFontFamiliesExW, MyEnumFontFamiliesExW);
+		}
+		if (enumFontCache.cacheEnabled)
+		{
+			DetourAttach(&(PVOID&)addrAddFontResourceExW, MyAddFontResourceExW);
+			DetourAttach(&(PVOID&)addrRemoveFontResourceExW, MyRemoveFontResourceExW);
+			DetourAttach(&(PVOID&)addrAddFontMemResourceEx, MyAddFontMemResourceEx);
+			DetourAttach(&(PVOID&)addrRemoveFontMemResourceEx, MyRemoveFontMemResourceEx);
+		}
+		if (fontDataCache.Enabled())
+		{
+			DetourAttach(&(PVOID&)addrGetFontData, MyGetFontData);
+		}
+		if (textExtentCache.Enabled())
+		{
+			DetourAttach(&(PVOID&)addrGetTextExtentPoint32W, MyGetTextExtentPoint32W);
+			DetourAttach(&(PVOID&)addrGetTextExtentExPointW, MyGetTextExtentExPointW);
+			DetourAttach(&(PVOID&)addrSetTextJustification, MySetTextJustification);
+		}
+		if (charWidthCache.enabled)
+		{
+			DetourAttach(&(PVOID&)addrGetCharWidth32W, MyGetCharWidth32W);
+			DetourAttach(&(PVOID&)addrGetCharABCWidthsW, MyGetCharABCWidthsW);
+		}
+		if (!glyphReplaceTable.Empty())
+		{
+			DetourAttach(&(PVOID&)addrExtTextOutW, MyExtTextOutW);
+		}
 
 		if (!gdipFontFamiliesMap.empty() || !gdipFontsMap.empty() || !gdipGFFSansSerif.empty() || !gdipGFFSerif.empty() || !gdipGFFMonospace.empty())
 		{
-			HMODULE hGdiplus = LoadLibraryW((GetSysDirFsPath() / L"gdiplus.dll").c_str());
-			auto err = GetLastError();
-			FormatToFile(logFile.get(), "[DllMain] Load GDI+ address = {:x}, lasterror = {}\n", reinterpret_cast<size_t>(hGdiplus), err);
-
+			// Not loaded here, processes that never use GDI+ don't pay for it
+			// The notification also tells when it is unloaded, and loaded again
+			HMODULE hGdiplus = GetModuleHandleW(L"gdiplus.dll");
+			const bool notified = RegisterDllNotification(OnGdiplusDllNotification, nullptr);
 			if (hGdiplus)
 			{
-				if (!gdipFontFamiliesMap.empty())
-				{
-					addrGdipCreateFontFamilyFromName = GetProcAddressByFunctionDeclaration(hGdiplus, GdipCreateFontFamilyFromName);
-					if (addrGdipCreateFontFamilyFromName)
-						DetourAttach(&(PVOID&)addrGdipCreateFontFamilyFromName, MyGdipCreateFontFamilyFromName);
-				}
-
-				if (!gdipFontsMap.empty())
-				{
-					addrGdipCreateFont = GetProcAddressByFunctionDeclaration(hGdiplus, GdipCreateFont);
-					if (addrGdipCreateFont)
-					{
-						addrGdipGetFamilyName = GetProcAddressByFunctionDeclaration(hGdiplus, GdipGetFamilyName);
-						if (addrGdipGetFamilyName)
-							DetourAttach(&(PVOID&)addrGdipCreateFont, MyGdipCreateFont);
-					}
-				}
-
-				if (!gdipGFFSansSerif.empty())
-				{
-					addrGdipGetGenericFontFamilySansSerif = GetProcAddressByFunctionDeclaration(hGdiplus, GdipGetGenericFontFamilySansSerif);
-					if (addrGdipGetGenericFontFamilySansSerif)
-						DetourAttach(&(PVOID&)addrGdipGetGenericFontFamilySansSerif, MyGdipGetGenericFontFamilySansSerif);
-				}
-
-				if (!gdipGFFSerif.empty())
+				const int attached = AttachGdiplusHooks(hGdiplus);
+				if (attached)
+					gdiplusHooked = hGdiplus;
+				if (logFile)
 				{
-					addrGdipGetGenericFontFamilySerif = GetProcAddressByFunctionDeclaration(hGdiplus, GdipGetGenericFontFamilySerif);
-					if (addrGdipGetGenericFontFamilySerif)
-						DetourAttach(&(PVOID&)addrGdipGetGenericFontFamilySerif, MyGdipGetGenericFontFamilySerif);
+					FormatToFile(logFile.get(), "[DllMain] gdiplus.dll already loaded at {:x}, GDI+ hooks attached = {}, dll notification registered = {}\n", reinterpret_cast<size_t>(hGdiplus), attached, notified);
 				}
-
-				if (!gdipGFFMonospace.empty())
+			}
+			else
+			{
+				gdiplusHooksPending = notified;
+				if (logFile)
 				{
-					addrGdipGetGenericFontFamilyMonospace = GetProcAddressByFunctionDeclaration(hGdiplus, GdipGetGenericFontFamilyMonospace);
-					if (addrGdipGetGenericFontFamilyMonospace)
-						DetourAttach(&(PVOID&)addrGdipGetGenericFontFamilyMonospace, MyGdipGetGenericFontFamilyMonospace);
+					FormatToFile(logFile.get(), "[DllMain] gdiplus.dll not loaded, GDI+ hooks wait for it, dll notification registered = {}\n", gdiplusHooksPending);
 				}
 			}
 		}
@@ -1188,5 +2052,10 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, [[maybe_unused]
 			return TRUE;
 		}
 	}
+	else if (ul_reason_for_call == DLL_PROCESS_DETACH)
+	{
+		WriteReports(lpReserved != nullptr); // Non-null when the process is exiting
+		fontWarmup.Save(lpReserved != nullptr);
+	}
 	return TRUE;
 }
@@ -0,0 +1,142 @@
+#pragma once
+
+// Format of the font warm-up profile: the LOGFONTs a program created after "fonts"
+// rules were applied, with how often each was used. No Windows types, so the format
+// and merge can be checked on any platform.
+//
+// Text, one font per line after the header, face name last as it may contain spaces:
+//   FontModProfile 1
+//   <uses> <height> <width> <escapement> <orientation> <weight> <italic> <underline>
+//     <strikeOut> <charSet> <outPrecision> <clipPrecision> <quality> <pitchAndFamily> <face>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct FontProfileEntry
+{
+	uint32_t uses = 0;
+	int32_t height = 0;
+	int32_t width = 0;
+	int32_t escapement = 0;
+	int32_t orientation = 0;
+	int32_t weight = 0;
+	uint8_t italic = 0;
+	uint8_t underline = 0;
+	uint8_t strikeOut = 0;
+	uint8_t charSet = 0;
+	uint8_t outPrecision = 0;
+	uint8_t clipPrecision = 0;
+	uint8_t quality = 0;
+	uint8_t pitchAndFamily = 0;
+	std::string face; // UTF-8
+
+	// Same font, uses aside
+	bool SameFont(const FontProfileEntry& o) const
+	{
+		return height == o.height && width == o.width && escapement == o.escapement && orientation == o.orientation && weight == o.weight
+			&& italic == o.italic && underline == o.underline && strikeOut == o.strikeOut && charSet == o.charSet && outPrecision == o.outPrecision
+			&& clipPrecision == o.clipPrecision && quality == o.quality && pitchAndFamily == o.pitchAndFamily && face == o.face;
+	}
+};
+
+constexpr std::string_view FontProfileHeader = "FontModProfile 1";
+
+// Lines that don't parse are skipped, a damaged profile only loses those fonts.
+// Returns false if the header doesn't match.
+inline bool ParseFontProfile(std::string_view text, std::vector<FontProfileEntry>& entries)
+{
+	auto nextLine = [&text]() {
+		const size_t end = text.find('\n');
+		std::string_view line = text.substr(0, end);
+		text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+		return line;
+	};
+
+	if (nextLine() != FontProfileHeader)
+		return false;
+
+	while (!text.empty())
+	{
+		std::string_view line = nextLine();
+		const char* p = line.data();
+		const char* end = p + line.size();
+		FontProfileEntry e;
+
+		bool ok = true;
+		auto field = [&](auto& value) {
+			if (!ok)
+				return;
+			auto [next, ec] = std::from_chars(p, end, value);
+			ok = ec == std::errc() && next < end && *next == ' ';
+			p = next + 1;
+		};
+		auto byteField = [&](uint8_t& value) {
+			uint32_t v = 0;
+			field(v);
+			ok = ok && v <= 0xFF;
+			value = static_cast<uint8_t>(v);
+		};
+
+		field(e.uses);
+		field(e.height);
+		field(e.width);
+		field(e.escapement);
+		field(e.orientation);
+		field(e.weight);
+		for (uint8_t* b : { &e.italic, &e.underline, &e.strikeOut, &e.charSet, &e.outPrecision, &e.clipPrecision, &e.quality, &e.pitchAndFamily })
+			byteField(*b);
+
+		if (!ok || p >= end)
+			continue;
+		e.face.assign(p, end);
+		entries.push_back(std::move(e));
+	}
+	return true;
+}
+
+inline std::string SerializeFontProfile(const std::vector<FontProfileEntry>& entries)
+{
+	std::string text(FontProfileHeader);
+	text += "\r\n";
+	for (const auto& e : entries)
+	{
+		for (int64_t v : { int64_t(e.uses), int64_t(e.height), int64_t(e.width), int64_t(e.escapement), int64_t(e.orientation), int64_t(e.weight),
+			int64_t(e.italic), int64_t(e.underline), int64_t(e.strikeOut), int64_t(e.charSet), int64_t(e.outPrecision),
+			int64_t(e.clipPrecision), int64_t(e.quality), int64_t(e.pitchAndFamily) })
+		{
+			text += std::to_string(v);
+			text += ' ';
+		}
+		text += e.face;
+		text += "\r\n";
+	}
+	return text;
+}
+
+// Adds this session's uses to the saved ones. Saved uses are halved first, so fonts a
+// program stopped using fade out. Keeps the "maxEntries" most used, most used first.
+inline void MergeFontProfile(std::vector<FontProfileEntry>& saved, const std::vector<FontProfileEntry>& session, size_t maxEntries)
+{
+	for (auto& e : saved)
+		e.uses /= 2;
+
+	for (const auto& s : session)
+	{
+		auto it = std::find_if(saved.begin(), saved.end(), [&](const FontProfileEntry& e) { return e.SameFont(s); });
+		if (it != saved.end())
+			it->uses = it->uses > UINT32_MAX - s.uses ? UINT32_MAX : it->uses + s.uses;
+		else
+			saved.push_back(s);
+	}
+
+	std::erase_if(saved, [](const FontProfileEntry& e) { return e.uses == 0 || e.face.empty() || e.face.find_first_of("\r\n") != std::string::npos; });
+	std::stable_sort(saved.begin(), saved.end(), [](const FontProfileEntry& a, const FontProfileEntry& b) { return a.uses > b.uses; });
+	if (saved.size() > maxEntries)
+		saved.resize(maxEntries);
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+// Records the fonts a program creates after "fonts" rules are applied, and on the next
+// launch creates them again on a low priority thread and draws common characters with
+// them, so GDI font mapping and glyph rasterization are done before the UI needs them.
+// The profile format is in FontProfile.hpp.
+
+#include "FontProfile.hpp"
+#include <mutex>
+
+struct FontWarmup
+{
+	static constexpr size_t MaxEntries = 64;
+	static constexpr size_t MaxSessionFonts = 1024; // Further new fonts of a session are not recorded
+
+	bool Enabled() const
+	{
+		return enabled;
+	}
+
+	// Config time, reads the profile of the last runs
+	void Enable(fs::path path)
+	{
+		profilePath = std::move(path);
+		for (auto& shard : shards)
+			shard.slots = std::make_unique<Slot[]>(SlotsPerShard);
+		enabled = true;
+		try
+		{
+			std::vector<FontProfileEntry> entries;
+			if (ParseFontProfile(LoadUtf8FileWithoutBOM(profilePath.c_str()), entries))
+				saved = std::move(entries);
+		}
+		catch (...)
+		{
+			// No profile yet
+		}
+	}
+
+	// On every CreateFont, so it doesn't allocate: fonts go into fixed tables allocated by
+	// Enable, one per shard so threads creating different fonts don't wait on each other
+	void Record(const LOGFONTW& lf)
+	{
+		const Key key(lf);
+		const size_t hash = key.Hash();
+		auto& shard = shards[hash % ShardCount];
+		std::lock_guard lock(shard.mutex);
+		for (size_t i = (hash / ShardCount) & (SlotsPerShard - 1);; i = (i + 1) & (SlotsPerShard - 1))
+		{
+			auto& slot = shard.slots[i];
+			if (slot.uses == 0)
+			{
+				if (shard.count == FontsPerShard)
+					return;
+				slot.key = key;
+				++shard.count;
+			}
+			else if (!(slot.key == key))
+				continue;
+			if (slot.uses != UINT32_MAX)
+				++slot.uses;
+			return;
+		}
+	}
+
+	// On first font creation, no threads are started from DllMain
+	void Start(decltype(CreateFontIndirectExW)* createFont)
+	{
+		if (!enabled || saved.empty())
+			return;
+
+		std::call_once(started, [&] {
+			// Holds a reference on FontMod so it stays loaded while the thread runs
+			if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, reinterpret_cast<LPCWSTR>(&FontProfileHeader), &module))
+				return;
+
+			createFontIndirectExW = createFont;
+			HANDLE hThread = CreateThread(nullptr, 0, [](LPVOID param) -> DWORD {
+				auto warmup = static_cast<FontWarmup*>(param);
+				SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+				warmup->Warm();
+				FreeLibraryAndExitThread(warmup->module, 0);
+			}, this, 0, nullptr);
+
+			if (hThread)
+				CloseHandle(hThread);
+			else
+				FreeLibrary(module);
+		});
+	}
+
+	// At process exit other threads are gone, one may have died holding the lock
+	void Save(bool atExit)
+	{
+		if (!enabled)
+			return;
+
+		std::vector<FontProfileEntry> entries;
+		for (auto& shard : shards)
+		{
+			std::unique_lock lock(shard.mutex, std::defer_lock);
+			if (!atExit)
+				lock.lock();
+			else if (!lock.try_lock())
+				continue;
+
+			for (size_t i = 0; i < SlotsPerShard; ++i)
+			{
+				if (shard.slots[i].uses)
+					entries.push_back(ToEntry(shard.slots[i]));
+			}
+		}
+		if (entries.empty())
+			return;
+
+		auto merged = saved;
+		MergeFontProfile(merged, entries, MaxEntries);
+		const std::string text = SerializeFontProfile(merged);
+
+		wil::unique_hfile hFile(CreateFileW(profilePath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+		if (!hFile)
+			return;
+		DWORD written;
+		WriteFile(hFile.get(), text.data(), static_cast<DWORD>(text.size()), &written, nullptr);
+	}
+
+private:
+	static constexpr size_t ShardCount = 16;
+	static constexpr size_t FontsPerShard = MaxSessionFonts / ShardCount;
+	static constexpr size_t SlotsPerShard = FontsPerShard * 2; // Power of two, at most half full
+
+	// The LOGFONT as recorded, face zero filled after its end so keys compare as arrays
+	struct Key
+	{
+		Key() = default;
+
+		explicit Key(const LOGFONTW& lf)
+			: height(lf.lfHeight), width(lf.lfWidth), escapement(lf.lfEscapement), orientation(lf.lfOrientation), weight(lf.lfWeight),
+			italic(lf.lfItalic), underline(lf.lfUnderline), strikeOut(lf.lfStrikeOut), charSet(lf.lfCharSet), outPrecision(lf.lfOutPrecision),
+			clipPrecision(lf.lfClipPrecision), quality(lf.lfQuality), pitchAndFamily(lf.lfPitchAndFamily)
+		{
+			std::copy_n(lf.lfFaceName, wcsnlen(lf.lfFaceName, LF_FACESIZE), face);
+		}
+
+		// 64 bit FNV-1a on every target, 32 bit builds keep the low bits of the result
+		size_t Hash() const
+		{
+			uint64_t h = 0xCBF29CE484222325;
+			for (size_t i = 0; i < LF_FACESIZE && face[i]; ++i)
+				h = (h ^ face[i]) * 0x100000001B3;
+			for (uint64_t v : { uint64_t(height), uint64_t(width), uint64_t(weight), uint64_t(italic) | uint64_t(charSet) << 8 | uint64_t(quality) << 16 })
+				h = (h ^ v) * 0x100000001B3;
+			return static_cast<size_t>(h ^ (h >> 29));
+		}
+
+		LONG height = 0, width = 0, escapement = 0, orientation = 0, weight = 0;
+		BYTE italic = 0, underline = 0, strikeOut = 0, charSet = 0, outPrecision = 0, clipPrecision = 0, quality = 0, pitchAndFamily = 0;
+		WCHAR face[LF_FACESIZE] = {};
+
+		bool operator==(const Key&) const = default;
+	};
+
+	struct Slot
+	{
+		Key key;
+		uint32_t uses = 0; // Empty when 0
+	};
+
+	struct alignas(64) Shard
+	{
+		std::mutex mutex;
+		std::unique_ptr<Slot[]> slots; // SlotsPerShard, open addressing
+		size_t count = 0;
+	};
+
+	// Face is left empty if it isn't valid UTF-16, MergeFontProfile drops those
+	static FontProfileEntry ToEntry(const Slot& slot)
+	{
+		const Key& key = slot.key;
+		FontProfileEntry e;
+		if (!Utf16ToUtf8(std::wstring_view(key.face, wcsnlen(key.face, LF_FACESIZE)), e.face))
+			e.face.clear();
+		e.uses = slot.uses;
+		e.height = key.height;
+		e.width = key.width;
+		e.escapement = key.escapement;
+		e.orientation = key.orientation;
+		e.weight = key.weight;
+		e.italic = key.italic;
+		e.underline = key.underline;
+		e.strikeOut = key.strikeOut;
+		e.charSet = key.charSet;
+		e.outPrecision = key.outPrecision;
+		e.clipPrecision = key.clipPrecision;
+		e.quality = key.quality;
+		e.pitchAndFamily = key.pitchAndFamily;
+		return e;
+	}
+
+	void Warm()
+	{
+		AllocScope scope(AllocPhase::Warmup);
+
+		// Same format as a screen, glyphs are rasterized for the quality the UI will use
+		BITMAPINFO bi = {};
+		bi.bmiHeader.biSize = sizeof(bi.bmiHeader);
+		bi.bmiHeader.biWidth = 256;
+		bi.bmiHeader.biHeight = 64;
+		bi.bmiHeader.biPlanes = 1;
+		bi.bmiHeader.biBitCount = 32;
+		bi.bmiHeader.biCompression = BI_RGB;
+		void* bits;
+		wil::unique_hdc hdc(CreateCompatibleDC(nullptr));
+		wil::unique_hbitmap bitmap(CreateDIBSection(nullptr, &bi, DIB_RGB_COLORS, &bits, nullptr, 0));
+		if (!hdc || !bitmap)
+			return;
+		auto oldBitmap = SelectObject(hdc.get(), bitmap.get());
+
+		// Printable ASCII, most UI text
+		WCHAR text[0x7F - 0x20];
+		for (WCHAR c = 0x20; c < 0x7F; ++c)
+			text[c - 0x20] = c;
+
+		for (const auto& e : saved)
+		{
+			ENUMLOGFONTEXDVW elf = {};
+			LOGFONTW& lf = elf.elfEnumLogfontEx.elfLogFont;
+			std::wstring face;
+			if (!Utf8ToUtf16(e.face, face) || face.size() >= LF_FACESIZE)
+				continue;
+			face.copy(lf.lfFaceName, LF_FACESIZE - 1);
+			lf.lfHeight = e.height;
+			lf.lfWidth = e.width;
+			lf.lfEscapement = e.escapement;
+			lf.lfOrientation = e.orientation;
+			lf.lfWeight = e.weight;
+			lf.lfItalic = e.italic;
+			lf.lfUnderline = e.underline;
+			lf.lfStrikeOut = e.strikeOut;
+			lf.lfCharSet = e.charSet;
+			lf.lfOutPrecision = e.outPrecision;
+			lf.lfClipPrecision = e.clipPrecision;
+			lf.lfQuality = e.quality;
+			lf.lfPitchAndFamily = e.pitchAndFamily;
+			elf.elfDesignVector.dvReserved = STAMP_DESIGNVECTOR;
+
+			// Already rewritten, so created without the hook. Kept alive so GDI keeps its mapping.
+			HFONT hFont = createFontIndirectExW(&elf);
+			if (!hFont)
+				continue;
+			auto oldFont = SelectObject(hdc.get(), hFont);
+			ExtTextOutW(hdc.get(), 0, 0, 0, nullptr, text, ARRAYSIZE(text), nullptr);
+			SelectObject(hdc.get(), oldFont);
+			fonts.push_back(hFont);
+		}
+		SelectObject(hdc.get(), oldBitmap);
+	}
+
+	bool enabled = false;
+	fs::path profilePath;
+	std::vector<FontProfileEntry> saved; // Read at config time, only read afterwards
+
+	std::once_flag started;
+	HMODULE module = nullptr;
+	decltype(CreateFontIndirectExW)* createFontIndirectExW = nullptr;
+	std::vector<HFONT> fonts;
+
+	Shard shards[ShardCount]; // This session's fonts
+};
+
+// Never destroyed, the warm-up thread and hooks may still use it during unload
+FontWarmup& fontWarmup = *new FontWarmup;
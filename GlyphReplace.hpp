@@ -0,0 +1,152 @@
+#pragma once
+
+// "glyphReplace" applied to whole UTF-16 strings, for ExtTextOutW. Strings are tested 8
+// code units at a time against the range of mapped characters, and only code units in
+// that range are looked up in a bitmap, so text without mapped characters costs a few
+// vector operations. No Windows types, so it can be checked on any platform.
+//
+// Only characters of the BMP mapped to characters of the BMP are replaced here, others
+// would change the string length and so the meaning of the ExtTextOutW spacing array.
+
+#include "Simd.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+struct GlyphReplaceTable
+{
+	// Returns the number of entries that can't be used for strings
+	template <class Map>
+	size_t Build(const Map& map)
+	{
+		*this = {};
+		size_t skipped = 0;
+		uint32_t lo = 0xFFFF, hi = 0;
+		for (const auto& [from, to] : map)
+		{
+			if (!Usable(from) || !Usable(to) || from == to)
+			{
+				++skipped;
+				continue;
+			}
+			lo = std::min(lo, uint32_t(from));
+			hi = std::max(hi, uint32_t(from));
+		}
+		if (lo > hi)
+			return skipped;
+
+		low = static_cast<uint16_t>(lo);
+		span = static_cast<uint16_t>(hi - lo);
+		targets.resize(size_t(span) + 1);
+		for (const auto& [from, to] : map)
+		{
+			if (!Usable(from) || !Usable(to) || from == to)
+				continue;
+			mapped[from / 64] |= uint64_t(1) << (from % 64);
+			targets[from - low] = static_cast<uint16_t>(to);
+		}
+		return skipped;
+	}
+
+	bool Empty() const
+	{
+		return targets.empty();
+	}
+
+	// Index of the first mapped code unit, or "count" if there is none
+	template <class Char>
+	size_t Find(const Char* s, size_t count) const
+	{
+		static_assert(sizeof(Char) == 2);
+		if (Empty())
+			return count;
+
+		size_t i = 0;
+#ifdef FONTMOD_SSE2
+		const __m128i lowV = _mm_set1_epi16(static_cast<short>(low));
+		const __m128i spanV = _mm_set1_epi16(static_cast<short>(span));
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 8 <= count; i += 8)
+		{
+			// c - low wraps below the range, saturating subtraction leaves 0 inside it
+			const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+			const __m128i outside = _mm_subs_epu16(_mm_sub_epi16(c, lowV), spanV);
+			const __m128i inside = _mm_cmpeq_epi16(outside, zero);
+			for (uint32_t mask = _mm_movemask_epi8(_mm_packs_epi16(inside, zero)); mask; mask &= mask - 1)
+			{
+				const size_t at = i + std::countr_zero(mask);
+				if (IsMapped(s[at]))
+					return at;
+			}
+		}
+#elif defined(FONTMOD_NEON)
+		const uint16x8_t lowV = vdupq_n_u16(low);
+		const uint16x8_t spanV = vdupq_n_u16(span);
+		for (; i + 8 <= count; i += 8)
+		{
+			const uint16x8_t inside = vcleq_u16(vsubq_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(s + i)), lowV), spanV);
+			if (vmaxvq_u16(inside) == 0)
+				continue;
+			for (size_t at = i; at < i + 8; ++at)
+			{
+				if (IsMapped(s[at]))
+					return at;
+			}
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			if (IsMapped(s[i]))
+				return i;
+		}
+		return count;
+	}
+
+	// Replaces mapped code units in place, returns how many were replaced
+	template <class Char>
+	size_t Replace(Char* s, size_t count) const
+	{
+		static_assert(sizeof(Char) == 2);
+		size_t replaced = 0;
+		for (size_t i = Find(s, count); i < count; i += 1 + Find(s + i + 1, count - i - 1))
+		{
+			s[i] = static_cast<Char>(targets[static_cast<uint16_t>(s[i]) - low]);
+			++replaced;
+		}
+		return replaced;
+	}
+
+private:
+	static bool Usable(uint32_t c)
+	{
+		return c <= 0xFFFF && (c < 0xD800 || c > 0xDFFF);
+	}
+
+	template <class Char>
+	bool IsMapped(Char ch) const
+	{
+		const uint16_t c = static_cast<uint16_t>(ch);
+		return static_cast<uint16_t>(c - low) <= span && (mapped[c / 64] >> (c % 64) & 1);
+	}
+
+	uint16_t low = 0;
+	uint16_t span = 0;
+	std::array<uint64_t, 0x10000 / 64> mapped = {};
+	std::vector<uint16_t> targets; // By code unit - low
+};
+
+// "glyphReplace" for GetGlyphOutlineW/A, which draw one character of any plane at a time.
+// Returns whether "ch" was replaced.
+template <class Map, class Char>
+bool ReplaceGlyphOutlineChar(const Map& map, Char& ch)
+{
+	auto it = map.find(ch);
+	if (it == map.end())
+		return false;
+	ch = static_cast<Char>(it->second);
+	return true;
+}
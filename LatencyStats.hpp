@@ -0,0 +1,215 @@
+#pragma once
+
+// Per hook latency histograms, split into time spent in FontMod and time spent in the
+// original function. Each thread records into its own log-linear histograms (16 sub
+// buckets per power of two, so about 6% resolution), merged when a report is written.
+
+#include "StatsLayout.hpp"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <mutex>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM64)
+#include <intrin.h>
+#endif
+
+inline uint64_t ReadTicks()
+{
+#if defined(_M_IX86) || defined(_M_X64)
+	return __rdtsc();
+#elif defined(_M_ARM64)
+	return _ReadStatusReg(ARM64_CNTVCT);
+#else
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return static_cast<uint64_t>(counter.QuadPart);
+#endif
+}
+
+struct LatencyHistogram
+{
+	static constexpr uint32_t SubBits = 4;
+	static constexpr uint32_t SubCount = 1 << SubBits;
+	static constexpr uint32_t MaxBits = 36; // Longer values are clamped
+	static constexpr uint32_t BucketCount = (MaxBits - SubBits + 1) * SubCount;
+
+	static uint32_t BucketOf(uint64_t ticks)
+	{
+		ticks = std::min(ticks, (uint64_t(1) << MaxBits) - 1);
+		if (ticks < 2 * SubCount)
+			return static_cast<uint32_t>(ticks);
+		const uint32_t shift = static_cast<uint32_t>(std::bit_width(ticks)) - SubBits - 1;
+		return (shift + 1) * SubCount + static_cast<uint32_t>(ticks >> shift) - SubCount;
+	}
+
+	// Highest value counted in a bucket
+	static uint64_t UpperBoundOf(uint32_t bucket)
+	{
+		if (bucket < 2 * SubCount)
+			return bucket;
+		const uint32_t shift = bucket / SubCount - 1;
+		const uint64_t top = bucket % SubCount + SubCount;
+		return ((top + 1) << shift) - 1;
+	}
+
+	// Only the owning thread writes, so no read-modify-write is needed
+	void Record(uint64_t ticks)
+	{
+		auto& count = counts[BucketOf(ticks)];
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (ticks > max.load(std::memory_order_relaxed))
+			max.store(ticks, std::memory_order_relaxed);
+	}
+
+	std::array<std::atomic<uint32_t>, BucketCount> counts = {};
+	std::atomic<uint64_t> max = 0;
+};
+
+struct LatencyStats
+{
+	static constexpr size_t HookCount = static_cast<size_t>(HookId::Count);
+
+	struct ThreadHistograms
+	{
+		LatencyHistogram self[HookCount];
+		LatencyHistogram original[HookCount];
+	};
+
+	bool Enabled() const
+	{
+		return enabled;
+	}
+
+	void Enable(fs::path path)
+	{
+		reportPath = std::move(path);
+		QueryPerformanceFrequency(&qpcFrequency);
+		QueryPerformanceCounter(&qpcStart);
+		ticksStart = ReadTicks();
+		enabled = true;
+	}
+
+	void Record(HookId id, uint64_t selfTicks, uint64_t originalTicks)
+	{
+		// Trivially destroyed, thread exit isn't seen with DisableThreadLibraryCalls
+		constinit thread_local ThreadHistograms* block = nullptr;
+		if (!block)
+			block = Acquire();
+		block->self[static_cast<size_t>(id)].Record(selfTicks);
+		block->original[static_cast<size_t>(id)].Record(originalTicks);
+	}
+
+	// At process exit other threads are gone, one may have died holding the lock
+	void WriteReport(bool atExit = false)
+	{
+		std::unique_lock lock(mutex, std::defer_lock);
+		if (!atExit)
+			lock.lock();
+		else if (!lock.try_lock())
+			return;
+
+		LARGE_INTEGER qpcNow;
+		QueryPerformanceCounter(&qpcNow);
+		const uint64_t ticksElapsed = ReadTicks() - ticksStart;
+		const double seconds = static_cast<double>(qpcNow.QuadPart - qpcStart.QuadPart) / qpcFrequency.QuadPart;
+		const double nsPerTick = ticksElapsed && seconds > 0 ? seconds * 1e9 / ticksElapsed : 0;
+
+		wil::unique_hfile hFile(CreateFileW(reportPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+		if (!hFile)
+			return;
+
+		FormatToFile(hFile.get(), "[LatencyStats] pid = {}, threads = {}, uptime = {:.3f} s, ns per tick = {:.4f}\n", GetCurrentProcessId(), blocks.size(), seconds, nsPerTick);
+		FormatToFile(hFile.get(), "{:<34} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n", "hook (ns)", "calls", "part", "p50", "p90", "p99", "p99.9", "max");
+
+		for (size_t id = 0; id < HookCount; ++id)
+		{
+			Merged self, original;
+			for (const auto& block : blocks)
+			{
+				self.Add(block->self[id]);
+				original.Add(block->original[id]);
+			}
+			if (self.total == 0)
+				continue;
+
+			for (auto [part, merged] : { std::pair{ "fontmod", &self }, std::pair{ "original", &original } })
+			{
+				FormatToFile(hFile.get(), "{:<34} {:>10} {:>10} {:>10.0f} {:>10.0f} {:>10.0f} {:>10.0f} {:>10.0f}\n",
+					hookNames[id], merged->total, part,
+					merged->Percentile(0.5) * nsPerTick, merged->Percentile(0.9) * nsPerTick,
+					merged->Percentile(0.99) * nsPerTick, merged->Percentile(0.999) * nsPerTick,
+					merged->max * nsPerTick);
+			}
+		}
+	}
+
+private:
+	struct Merged
+	{
+		void Add(const LatencyHistogram& h)
+		{
+			for (uint32_t i = 0; i < LatencyHistogram::BucketCount; ++i)
+			{
+				const uint32_t n = h.counts[i].load(std::memory_order_relaxed);
+				counts[i] += n;
+				total += n;
+			}
+			max = std::max(max, h.max.load(std::memory_order_relaxed));
+		}
+
+		double Percentile(double q) const
+		{
+			const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * total)));
+			uint64_t seen = 0;
+			for (uint32_t i = 0; i < LatencyHistogram::BucketCount; ++i)
+			{
+				seen += counts[i];
+				if (seen >= rank)
+					return static_cast<double>(std::min(LatencyHistogram::UpperBoundOf(i), max));
+			}
+			return static_cast<double>(max);
+		}
+
+		std::array<uint64_t, LatencyHistogram::BucketCount> counts = {};
+		uint64_t total = 0;
+		uint64_t max = 0;
+	};
+
+	// Blocks of exited threads are reused, their counts stay part of the totals. Each
+	// block keeps a handle to its thread, exited threads are found when a new thread
+	// needs a block.
+	ThreadHistograms* Acquire()
+	{
+		HANDLE self = nullptr;
+		if (!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &self, SYNCHRONIZE, FALSE, 0))
+			self = nullptr; // Never reused then
+
+		std::lock_guard lock(mutex);
+		for (size_t i = 0; i < blocks.size(); ++i)
+		{
+			if (owners[i] && WaitForSingleObject(owners[i], 0) == WAIT_OBJECT_0)
+			{
+				CloseHandle(owners[i]);
+				owners[i] = self;
+				return blocks[i].get();
+			}
+		}
+		blocks.push_back(std::make_unique<ThreadHistograms>());
+		owners.push_back(self);
+		return blocks.back().get();
+	}
+
+	bool enabled = false;
+	fs::path reportPath;
+	LARGE_INTEGER qpcFrequency = {};
+	LARGE_INTEGER qpcStart = {};
+	uint64_t ticksStart = 0;
+
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadHistograms>> blocks;
+	std::vector<HANDLE> owners; // Thread of each block, nullptr if it can't be waited on
+};
+
+// Never destroyed, hooks may still use it during unload
+LatencyStats& latencyStats = *new LatencyStats;
@@ -0,0 +1,122 @@
+#pragma once
+
+// Publishes StatsLayout.hpp's block in "Local\FontModStats.<pid>" so viewers can
+// follow a running process without debug logging.
+
+#include "AllocStats.hpp"
+#include "LatencyStats.hpp"
+#include "ReportEvent.hpp"
+
+struct LiveStats
+{
+	bool Published() const
+	{
+		return block != nullptr;
+	}
+
+	bool Publish()
+	{
+		std::wstring name(L"Local\\");
+		name.append(LiveStatsNamePrefix.begin(), LiveStatsNamePrefix.end());
+		name.append(std::to_wstring(GetCurrentProcessId()));
+
+		mapping.reset(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(LiveStatsBlock), name.c_str()));
+		if (!mapping)
+			return false;
+		view.reset(MapViewOfFile(mapping.get(), FILE_MAP_WRITE, 0, 0, sizeof(LiveStatsBlock)));
+		if (!view)
+			return false;
+
+		// New mappings are zero filled, only the header needs writing
+		auto b = static_cast<LiveStatsBlock*>(view.get());
+		FILETIME now;
+		GetSystemTimeAsFileTime(&now);
+		b->version = LiveStatsBlock::Version;
+		b->size = sizeof(LiveStatsBlock);
+		b->pid = GetCurrentProcessId();
+		b->startTime = (static_cast<uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+		b->hookCount = static_cast<uint32_t>(LiveStatsBlock::HookCount);
+		b->counterCount = static_cast<uint32_t>(LiveStatsBlock::CounterCount);
+		b->magic.store(LiveStatsBlock::Magic, std::memory_order_release);
+
+		block = b;
+		formatToFileBytes = &Slot(LiveCounter::LoggedBytes);
+		return true;
+	}
+
+	void Add(LiveCounter counter, uint64_t n = 1)
+	{
+		if (block)
+			Slot(counter).fetch_add(n, std::memory_order_relaxed);
+	}
+
+	void AddCall(HookId id)
+	{
+		if (block)
+			block->hookCalls[static_cast<size_t>(id)].value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t>& Slot(LiveCounter counter)
+	{
+		return block->counters[static_cast<size_t>(counter)].value;
+	}
+
+	LiveStatsBlock* block = nullptr;
+	wil::unique_handle mapping;
+	wil::unique_mapview_ptr<void> view;
+};
+
+// Never destroyed, hooks and FormatToFile may still use it during unload
+LiveStats& liveStats = *new LiveStats;
+
+// Set when live stats or any report is enabled, before hooks are attached
+bool hookStatsEnabled = false;
+
+// Counts and times one hook call, and registers the report event on first use. When
+// stats are disabled the only work is one test of "hookStatsEnabled" and tests of
+// "start", which stays zero.
+struct HookTimer
+{
+	explicit HookTimer(HookId id) : id(id), scope(id)
+	{
+		if (hookStatsEnabled)
+			Begin();
+	}
+
+	~HookTimer()
+	{
+		if (start)
+			latencyStats.Record(id, ReadTicks() - start - originalTicks, originalTicks);
+	}
+
+	// Calls the original function, its time is recorded separately
+	template <class Func>
+	auto Original(Func&& func)
+	{
+		if (!start)
+			return func();
+
+		const uint64_t begin = ReadTicks();
+		auto result = func();
+		originalTicks += ReadTicks() - begin;
+		return result;
+	}
+
+	HookTimer(const HookTimer&) = delete;
+	HookTimer& operator=(const HookTimer&) = delete;
+
+private:
+	void Begin()
+	{
+		reportEvent.Ensure();
+		liveStats.AddCall(id);
+		if (latencyStats.Enabled())
+			start = ReadTicks();
+	}
+
+	HookId id;
+	AllocScope scope; // Allocations of the hook and what it calls
+	uint64_t start = 0;
+	uint64_t originalTicks = 0;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+// A FontInfo compiled into a byte mask and value over LOGFONTW, so overriding a font
+// is one blend over the struct instead of a branch per field. Size offsets and scales
+// depend on the incoming values, they run afterwards through a function specialized
+// on which of them are used. Sizes in points or DIPs are resolved there too, at the DPI
+// the caller passes.
+
+#include "DpiSize.hpp"
+#include "Simd.hpp"
+#include <array>
+#include <utility>
+
+
+struct LogFontPatch
+{
+	enum Ops : uint32_t
+	{
+		HeightOffset = 1 << 0,
+		WidthOffset = 1 << 1,
+		HeightScale = 1 << 2,
+		WidthScale = 1 << 3,
+		Dpi = 1 << 4, // Some of the sizes are per DPI
+		AllOps = (1 << 5) - 1
+	};
+
+	static constexpr size_t Size = (sizeof(LOGFONTW) + 15) & ~size_t(15);
+
+	// Overwrites a field with a constant
+	template <class T>
+	void Set(size_t offset, const T& v)
+	{
+		memcpy(value + offset, &v, sizeof(v));
+		memset(mask + offset, 0xFF, sizeof(v));
+	}
+
+	// Same result as wcsncpy_s(lfFaceName, LF_FACESIZE, name, _TRUNCATE)
+	void SetFaceName(std::wstring_view name)
+	{
+		const size_t len = std::min(name.size(), size_t(LF_FACESIZE - 1));
+		const size_t offset = offsetof(LOGFONTW, lfFaceName);
+		memcpy(value + offset, name.data(), len * sizeof(WCHAR));
+		memset(value + offset + len * sizeof(WCHAR), 0, sizeof(WCHAR));
+		memset(mask + offset, 0xFF, (len + 1) * sizeof(WCHAR));
+	}
+
+	// Selects the offset/scale function for a combination of Ops
+	void SetOps(uint32_t ops);
+
+	bool UsesDpi() const
+	{
+		return usesDpi;
+	}
+
+	// "dpi" is only read when UsesDpi
+	void Apply(LOGFONTW& lf, uint32_t dpi) const
+	{
+		auto p = reinterpret_cast<uint8_t*>(&lf);
+		size_t i = 0;
+#ifdef FONTMOD_SSE2
+		for (; i + 16 <= sizeof(LOGFONTW); i += 16)
+		{
+			__m128i m = _mm_load_si128(reinterpret_cast<const __m128i*>(mask + i));
+			__m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(value + i));
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_or_si128(_mm_andnot_si128(m, x), v));
+		}
+#endif
+		for (; i < sizeof(LOGFONTW); i += sizeof(uint32_t))
+		{
+			uint32_t m, v, x;
+			memcpy(&m, mask + i, sizeof(m));
+			memcpy(&v, value + i, sizeof(v));
+			memcpy(&x, p + i, sizeof(x));
+			x = (x & ~m) | v;
+			memcpy(p + i, &x, sizeof(x));
+		}
+
+		if (arithmetic)
+			arithmetic(*this, lf, dpi);
+	}
+
+	long heightOffset = 0;
+	long widthOffset = 0;
+	double heightScale = 1.0;
+	double widthScale = 1.0;
+
+	// Sizes per DPI in DpiUnits, 0 when in pixels
+	double heightPerDpi = 0;
+	double widthPerDpi = 0;
+	double heightOffsetPerDpi = 0;
+	double widthOffsetPerDpi = 0;
+
+private:
+	static_assert(sizeof(LOGFONTW) % sizeof(uint32_t) == 0);
+
+	template <uint32_t ops>
+	static void Arithmetic(const LogFontPatch& patch, LOGFONTW& lf, uint32_t dpi)
+	{
+		long heightOffset = patch.heightOffset;
+		long widthOffset = patch.widthOffset;
+		if constexpr ((ops & Dpi) != 0)
+		{
+			// Sizes are constants at a given DPI, written before the offsets like the others
+			if (patch.heightPerDpi != 0)
+				lf.lfHeight = ResolveDpi(patch.heightPerDpi, dpi);
+			if (patch.widthPerDpi != 0)
+				lf.lfWidth = ResolveDpi(patch.widthPerDpi, dpi);
+			heightOffset += ResolveDpi(patch.heightOffsetPerDpi, dpi);
+			widthOffset += ResolveDpi(patch.widthOffsetPerDpi, dpi);
+		}
+		if constexpr ((ops & HeightOffset) != 0)
+		{
+			if (lf.lfHeight != 0)
+				lf.lfHeight = lf.lfHeight > 0 ? std::max(1L, lf.lfHeight + heightOffset) : std::min(-1L, lf.lfHeight - heightOffset);
+		}
+		if constexpr ((ops & WidthOffset) != 0)
+		{
+			if (lf.lfWidth != 0)
+				lf.lfWidth = std::max(1L, lf.lfWidth + widthOffset);
+		}
+		if constexpr ((ops & HeightScale) != 0)
+		{
+			if (lf.lfHeight != 0)
+				lf.lfHeight = lround(lf.lfHeight * patch.heightScale);
+		}
+		if constexpr ((ops & WidthScale) != 0)
+		{
+			if (lf.lfWidth != 0)
+				lf.lfWidth = lround(lf.lfWidth * patch.widthScale);
+		}
+	}
+
+	using ArithmeticFunc = void (*)(const LogFontPatch&, LOGFONTW&, uint32_t);
+
+	template <size_t... i>
+	static constexpr std::array<ArithmeticFunc, sizeof...(i)> MakeArithmeticTable(std::index_sequence<i...>)
+	{
+		return { (i == 0 ? nullptr : &Arithmetic<static_cast<uint32_t>(i)>)... };
+	}
+
+	alignas(16) uint8_t mask[Size] = {};
+	alignas(16) uint8_t value[Size] = {};
+	ArithmeticFunc arithmetic = nullptr;
+	bool usesDpi = false;
+};
+
+inline void LogFontPatch::SetOps(uint32_t ops)
+{
+	static constexpr auto table = MakeArithmeticTable(std::make_index_sequence<AllOps + 1>());
+	arithmetic = table[ops & AllOps];
+	usesDpi = (ops & Dpi) != 0;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+// One memory cap shared by the runtime caches ("memoryBudget"). Caches register how to
+// read their hit count and how to free bytes, and report bytes as they add and drop
+// entries. When the total goes over the cap, it is trimmed to 7/8 of the cap and the
+// excess is split by size over hits since the last trim, so caches holding much that is
+// rarely hit free the most. Only std types, so it can be checked on any platform.
+//
+// Caches call Enforce after releasing their own locks, trimming takes the lock of each.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+struct MemoryBudget
+{
+	using Id = size_t;
+	static constexpr Id NoId = SIZE_MAX;
+	static constexpr size_t MaxClients = 8;
+	static constexpr int MaxPasses = 4; // Caches may free less than asked
+
+	struct Usage
+	{
+		std::string_view name;
+		size_t bytes;
+		uint64_t hits;
+		uint64_t trimmed; // Bytes freed for the budget
+	};
+
+	bool Enabled() const
+	{
+		return cap != 0;
+	}
+
+	void Enable(size_t bytes)
+	{
+		cap = bytes;
+	}
+
+	size_t Cap() const
+	{
+		return cap;
+	}
+
+	// Config time, before hooks run. "trim" frees about the bytes asked and returns how
+	// many it freed, the cache's Remove calls keep the usage.
+	Id Register(std::string_view name, std::function<uint64_t()> hits, std::function<size_t(size_t)> trim)
+	{
+		if (!Enabled() || clientCount == MaxClients)
+			return NoId;
+		auto& c = clients[clientCount];
+		c.name = name;
+		c.hits = std::move(hits);
+		c.trim = std::move(trim);
+		return clientCount++;
+	}
+
+	// Returns true when over the cap, the caller calls Enforce once its locks are released
+	bool Add(Id id, size_t bytes)
+	{
+		if (id >= clientCount)
+			return false;
+		clients[id].bytes.fetch_add(bytes, std::memory_order_relaxed);
+		return total.fetch_add(bytes, std::memory_order_relaxed) + bytes > cap;
+	}
+
+	void Remove(Id id, size_t bytes)
+	{
+		if (id >= clientCount)
+			return;
+		clients[id].bytes.fetch_sub(bytes, std::memory_order_relaxed);
+		total.fetch_sub(bytes, std::memory_order_relaxed);
+	}
+
+	// One thread trims at a time, others wait and find the total under the cap
+	void Enforce()
+	{
+		std::lock_guard lock(mutex);
+		if (Used() <= cap)
+			return;
+
+		std::vector<double> weights(clientCount);
+		for (size_t i = 0; i < clientCount; ++i)
+		{
+			const uint64_t hits = clients[i].hits();
+			weights[i] = double(clients[i].bytes.load(std::memory_order_relaxed)) / double(1 + hits - clients[i].lastHits);
+			clients[i].lastHits = hits;
+		}
+
+		const size_t target = cap - cap / 8;
+		for (int pass = 0; pass < MaxPasses; ++pass)
+		{
+			const size_t used = Used();
+			if (used <= target)
+				break;
+
+			double sum = 0;
+			for (size_t i = 0; i < clientCount; ++i)
+			{
+				if (clients[i].bytes.load(std::memory_order_relaxed) == 0)
+					weights[i] = 0;
+				sum += weights[i];
+			}
+			if (sum == 0)
+				break;
+
+			size_t freed = 0;
+			for (size_t i = 0; i < clientCount; ++i)
+			{
+				if (weights[i] == 0)
+					continue;
+				const size_t ask = static_cast<size_t>(double(used - target) * weights[i] / sum) + 1;
+				const size_t n = clients[i].trim(ask);
+				clients[i].trimmed.fetch_add(n, std::memory_order_relaxed);
+				freed += n;
+			}
+			if (freed == 0)
+				break;
+		}
+	}
+
+	size_t Used() const
+	{
+		return total.load(std::memory_order_relaxed);
+	}
+
+	// Atomics only, can be read at process exit
+	std::vector<Usage> Snapshot() const
+	{
+		std::vector<Usage> usage;
+		for (size_t i = 0; i < clientCount; ++i)
+		{
+			const auto& c = clients[i];
+			usage.push_back({ c.name, c.bytes.load(std::memory_order_relaxed), c.hits(), c.trimmed.load(std::memory_order_relaxed) });
+		}
+		return usage;
+	}
+
+private:
+	struct Client
+	{
+		std::string_view name;
+		std::function<uint64_t()> hits;
+		std::function<size_t(size_t)> trim;
+		std::atomic<size_t> bytes = 0;
+		std::atomic<uint64_t> trimmed = 0;
+		uint64_t lastHits = 0; // Under the mutex
+	};
+
+	size_t cap = 0;
+	Client clients[MaxClients];
+	size_t clientCount = 0;
+	std::atomic<size_t> total = 0;
+	std::mutex mutex; // Held while trimming
+};
+
+// Never destroyed, hooks may still use it during unload
+MemoryBudget& memoryBudget = *new MemoryBudget;
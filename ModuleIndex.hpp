@@ -0,0 +1,122 @@
+#pragma once
+
+// Address range index of loaded modules, used to find which module a font call
+// comes from. Readers binary search an immutable snapshot published through an
+// atomic pointer, writers (module load notifications) copy and republish it.
+// Only modules named in config, and modules to skip while walking the stack, are kept.
+
+#include <atomic>
+#include <mutex>
+#include <set>
+
+struct ModuleIndex
+{
+	static constexpr uint32_t None = UINT32_MAX;
+	static constexpr uint32_t Skip = UINT32_MAX - 1;
+
+	struct Range
+	{
+		uintptr_t begin;
+		uintptr_t end;
+		uint32_t id;
+	};
+	using Snapshot = std::vector<Range>;
+
+	ModuleIndex()
+	{
+		Publish(std::make_unique<Snapshot>());
+	}
+
+	bool empty() const { return names.empty(); }
+
+	// Config time only. Returns id of a module name, case-insensitive.
+	uint32_t RegisterName(std::wstring_view name)
+	{
+		auto key = Lower(name);
+		auto it = names.find(key);
+		if (it != names.end())
+			return it->second;
+		const auto id = static_cast<uint32_t>(names.size());
+		names.emplace(std::move(key), id);
+		return id;
+	}
+
+	// Frames in these modules are skipped, e.g. gdi32 forwarding to CreateFontIndirectExW
+	void RegisterSkip(std::wstring_view name)
+	{
+		skipNames.insert(Lower(name));
+	}
+
+	void Add(uintptr_t base, size_t size, std::wstring_view name)
+	{
+		auto key = Lower(name);
+		uint32_t id;
+		if (skipNames.count(key))
+			id = Skip;
+		else if (auto it = names.find(key); it != names.end())
+			id = it->second;
+		else
+			return;
+
+		std::lock_guard lock(writeMutex);
+		const Snapshot* snapshot = Load();
+		if (std::any_of(snapshot->begin(), snapshot->end(), [&](const Range& r) { return r.begin == base; }))
+			return;
+
+		auto next = std::make_unique<Snapshot>(*snapshot);
+		Range range{ base, base + size, id };
+		next->insert(std::upper_bound(next->begin(), next->end(), range, [](const Range& a, const Range& b) { return a.begin < b.begin; }), range);
+		Publish(std::move(next));
+	}
+
+	void Remove(uintptr_t base)
+	{
+		std::lock_guard lock(writeMutex);
+		const Snapshot* snapshot = Load();
+		if (std::none_of(snapshot->begin(), snapshot->end(), [&](const Range& r) { return r.begin == base; }))
+			return;
+
+		auto next = std::make_unique<Snapshot>(*snapshot);
+		std::erase_if(*next, [&](const Range& r) { return r.begin == base; });
+		Publish(std::move(next));
+	}
+
+	// Returns module id containing "address", Skip, or None
+	uint32_t Find(uintptr_t address) const
+	{
+		const Snapshot* snapshot = Load();
+		auto it = std::upper_bound(snapshot->begin(), snapshot->end(), address, [](uintptr_t a, const Range& r) { return a < r.begin; });
+		if (it == snapshot->begin())
+			return None;
+		--it;
+		return address < it->end ? it->id : None;
+	}
+
+private:
+	static std::wstring Lower(std::wstring_view s)
+	{
+		std::wstring result(s);
+		for (auto& c : result)
+			c = static_cast<wchar_t>(towlower(c));
+		return result;
+	}
+
+	const Snapshot* Load() const
+	{
+		return current.load(std::memory_order_acquire);
+	}
+
+	// Old snapshots are kept alive, readers may still use them. Module loads are rare.
+	void Publish(std::unique_ptr<Snapshot> next)
+	{
+		current.store(next.get(), std::memory_order_release);
+		retired.push_back(std::move(next));
+	}
+
+	std::unordered_map<std::wstring, uint32_t> names;
+	std::set<std::wstring> skipNames;
+
+	std::mutex writeMutex;
+	std::vector<std::unique_ptr<Snapshot>> retired;
+	std::atomic<const Snapshot*> current;
+};
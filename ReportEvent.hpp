@@ -0,0 +1,44 @@
+#pragma once
+
+// Signaling the event "Local\FontModReport.<pid>" writes every enabled report while
+// the program runs. The wait is registered on first use instead of in DllMain, since
+// it may start a thread pool thread.
+
+#include <mutex>
+
+struct ReportEvent
+{
+	using Callback = void (*)();
+
+	// DllMain, before hooks are attached
+	void SetCallback(Callback cb)
+	{
+		callback = cb;
+	}
+
+	void Ensure()
+	{
+		if (!callback)
+			return;
+
+		std::call_once(registered, [this] {
+			auto name = std::format(L"Local\\FontModReport.{}", GetCurrentProcessId());
+			event.reset(CreateEventW(nullptr, FALSE, FALSE, name.c_str()));
+			if (event)
+			{
+				HANDLE wait;
+				RegisterWaitForSingleObject(&wait, event.get(), [](PVOID context, BOOLEAN) {
+					static_cast<ReportEvent*>(context)->callback();
+				}, this, INFINITE, WT_EXECUTEDEFAULT);
+			}
+		});
+	}
+
+private:
+	Callback callback = nullptr;
+	std::once_flag registered;
+	wil::unique_event_nothrow event;
+};
+
+// Never destroyed, the wait callback may still run during unload
+ReportEvent& reportEvent = *new ReportEvent;
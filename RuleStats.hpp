@@ -0,0 +1,213 @@
+#pragma once
+
+// Hit counts of "fonts" and "gdiplus" rules, and the most frequent face names no rule
+// matched, written as a report at unload. Counters are sharded by processor number,
+// threads on different cores increment different cache lines.
+
+#include <atomic>
+#include <bit>
+#include <mutex>
+
+enum struct RuleSection : uint32_t
+{
+	Fonts,
+	Gdiplus,
+	Count
+};
+
+struct RuleStats
+{
+	static constexpr uint32_t npos = UINT32_MAX;
+	static constexpr size_t SectionCount = static_cast<size_t>(RuleSection::Count);
+	static constexpr size_t MaxMissNames = 4096; // Per shard and section, further names are only counted
+	static constexpr size_t ReportMisses = 30;
+
+	bool Enabled() const
+	{
+		return enabled;
+	}
+
+	// Before rules are parsed
+	void Enable(fs::path path)
+	{
+		reportPath = std::move(path);
+		enabled = true;
+	}
+
+	// Config time. Returns the id to store in the rule, npos when disabled.
+	uint32_t AddRule(RuleSection section, std::wstring_view key)
+	{
+		if (!enabled)
+			return npos;
+		rules.push_back({ section, std::wstring(key) });
+		return static_cast<uint32_t>(rules.size() - 1);
+	}
+
+	// After config is parsed
+	void Start()
+	{
+		if (!enabled)
+			return;
+
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		shardCount = std::bit_ceil(std::clamp<size_t>(si.dwNumberOfProcessors, 1, 64));
+		linesPerShard = std::max<size_t>(1, (rules.size() + CountersPerLine - 1) / CountersPerLine);
+		lines = std::make_unique<CounterLine[]>(shardCount * linesPerShard);
+		missShards = std::make_unique<MissShard[]>(shardCount);
+	}
+
+	void Hit(uint32_t id)
+	{
+		if (id != npos)
+			Counter(Shard(), id).fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void Miss(RuleSection section, std::wstring_view face)
+	{
+		if (!enabled)
+			return;
+
+		auto& shard = missShards[Shard()];
+		std::lock_guard lock(shard.mutex);
+		auto& counts = shard.counts[static_cast<size_t>(section)];
+		if (auto it = counts.find(face); it != counts.end())
+			++it->second;
+		else if (counts.size() < MaxMissNames)
+			counts.emplace(face, 1);
+		else
+			++shard.dropped;
+	}
+
+	// At process exit other threads are gone, one may have died holding a lock
+	void WriteReport(bool atExit)
+	{
+		if (!enabled || !lines)
+			return;
+
+		wil::unique_hfile hFile(CreateFileW(reportPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+		if (!hFile)
+			return;
+
+		std::vector<std::pair<uint64_t, uint32_t>> hits; // Count, rule id
+		size_t unused = 0;
+		for (uint32_t id = 0; id < rules.size(); ++id)
+		{
+			uint64_t n = 0;
+			for (size_t shard = 0; shard < shardCount; ++shard)
+				n += Counter(shard, id).load(std::memory_order_relaxed);
+			hits.emplace_back(n, id);
+			unused += n == 0;
+		}
+		std::stable_sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+		FormatToFile(hFile.get(), "[RuleStats] rules = {}, unused = {}\n\n", rules.size(), unused);
+
+		FormatToFile(hFile.get(), "Hits per rule:\n");
+		for (const auto& [n, id] : hits)
+		{
+			if (n != 0)
+				FormatToFile(hFile.get(), "  {:<8} \"{}\" = {}\n", SectionName(rules[id].section), ToUtf8(rules[id].key), n);
+		}
+
+		FormatToFile(hFile.get(), "\nNever matched, consider removing:\n");
+		for (const auto& [n, id] : hits)
+		{
+			if (n == 0)
+				FormatToFile(hFile.get(), "  {:<8} \"{}\"\n", SectionName(rules[id].section), ToUtf8(rules[id].key));
+		}
+
+		FormatToFile(hFile.get(), "\nMost frequent faces without a rule, consider adding:\n");
+		for (size_t section = 0; section < SectionCount; ++section)
+		{
+			std::unordered_map<std::wstring, uint64_t> merged;
+			uint64_t dropped = 0;
+			for (size_t i = 0; i < shardCount; ++i)
+			{
+				auto& shard = missShards[i];
+				std::unique_lock lock(shard.mutex, std::defer_lock);
+				if (!atExit)
+					lock.lock();
+				else if (!lock.try_lock())
+					continue;
+
+				for (const auto& [face, n] : shard.counts[section])
+					merged[face] += n;
+				dropped += shard.dropped;
+			}
+
+			std::vector<std::pair<uint64_t, const std::wstring*>> top;
+			for (const auto& [face, n] : merged)
+				top.emplace_back(n, &face);
+			const size_t count = std::min(top.size(), ReportMisses);
+			std::partial_sort(top.begin(), top.begin() + count, top.end(), [](const auto& a, const auto& b) { return a.first > b.first || (a.first == b.first && *a.second < *b.second); });
+
+			for (size_t i = 0; i < count; ++i)
+				FormatToFile(hFile.get(), "  {:<8} \"{}\" = {}\n", SectionName(static_cast<RuleSection>(section)), ToUtf8(*top[i].second), top[i].first);
+			if (dropped)
+				FormatToFile(hFile.get(), "  {:<8} (names not tracked) = {}\n", SectionName(static_cast<RuleSection>(section)), dropped);
+		}
+	}
+
+private:
+	static constexpr size_t CountersPerLine = 64 / sizeof(uint64_t);
+
+	struct Rule
+	{
+		RuleSection section;
+		std::wstring key;
+	};
+
+	struct alignas(64) CounterLine
+	{
+		std::atomic<uint64_t> values[CountersPerLine] = {};
+	};
+
+	struct NameHash
+	{
+		using is_transparent = void;
+		size_t operator()(std::wstring_view s) const noexcept { return std::hash<std::wstring_view>()(s); }
+	};
+
+	struct alignas(64) MissShard
+	{
+		std::mutex mutex;
+		std::unordered_map<std::wstring, uint64_t, NameHash, std::equal_to<>> counts[SectionCount];
+		uint64_t dropped = 0;
+	};
+
+	std::atomic<uint64_t>& Counter(size_t shard, uint32_t id)
+	{
+		return lines[shard * linesPerShard + id / CountersPerLine].values[id % CountersPerLine];
+	}
+
+	size_t Shard() const
+	{
+		return GetCurrentProcessorNumber() & (shardCount - 1);
+	}
+
+	static std::string_view SectionName(RuleSection section)
+	{
+		return section == RuleSection::Fonts ? "fonts" : "gdiplus";
+	}
+
+	static std::string ToUtf8(const std::wstring& s)
+	{
+		std::string result;
+		if (!Utf16ToUtf8(s, result))
+			result = "?";
+		return result;
+	}
+
+	bool enabled = false;
+	fs::path reportPath;
+	std::vector<Rule> rules;
+
+	size_t shardCount = 1;
+	size_t linesPerShard = 0; // Each shard has its own cache lines
+	std::unique_ptr<CounterLine[]> lines;
+	std::unique_ptr<MissShard[]> missShards;
+};
+
+// Never destroyed, hooks may still use it during unload
+RuleStats& ruleStats = *new RuleStats;
@@ -2,6 +2,7 @@
 
 void* ryml_allocate(size_t size, void* /*hint*/, void* /*user_data*/)
 {
+	AllocScope scope(AllocPhase::Ryml);
 	return operator new(size);
 }
 
@@ -0,0 +1,47 @@
+#pragma once
+
+// Helpers for reading and writing big-endian OpenType (sfnt) data.
+// https://learn.microsoft.com/en-us/typography/opentype/spec/otff
+
+constexpr uint32_t SfntTag(char a, char b, char c, char d)
+{
+	return (uint32_t(uint8_t(a)) << 24) | (uint32_t(uint8_t(b)) << 16) | (uint32_t(uint8_t(c)) << 8) | uint32_t(uint8_t(d));
+}
+
+inline uint16_t ReadU16BE(const uint8_t* p)
+{
+	return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t ReadU32BE(const uint8_t* p)
+{
+	return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline void WriteU16BE(uint8_t* p, uint16_t v)
+{
+	p[0] = static_cast<uint8_t>(v >> 8);
+	p[1] = static_cast<uint8_t>(v);
+}
+
+inline void WriteU32BE(uint8_t* p, uint32_t v)
+{
+	p[0] = static_cast<uint8_t>(v >> 24);
+	p[1] = static_cast<uint8_t>(v >> 16);
+	p[2] = static_cast<uint8_t>(v >> 8);
+	p[3] = static_cast<uint8_t>(v);
+}
+
+constexpr size_t SfntHeaderSize = 12;
+constexpr size_t SfntTableRecordSize = 16;
+
+constexpr uint32_t SfntPad4(uint32_t size)
+{
+	return (size + 3) & ~3u;
+}
+
+// Table tag as expected by GetFontData (little-endian)
+constexpr uint32_t GdiTableTag(char a, char b, char c, char d)
+{
+	return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Vector instruction sets of the SIMD paths, for MSVC targets and for GCC or Clang
+// builds of the portable headers. x86 and x64 builds always have SSE2 and ARM64 builds
+// always have NEON, other targets use the scalar paths.
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define FONTMOD_SSE2 1
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || (defined(__ARM_NEON) && defined(__aarch64__))
+#define FONTMOD_NEON 1
+#ifdef _MSC_VER
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
@@ -0,0 +1,155 @@
+#pragma once
+
+// Layout of the live statistics block FontMod publishes in shared memory, and a reader
+// for it. Only fixed width types, so viewers on any platform can use this header.
+// Counters may be appended in later versions, readers use "counterCount" from the block.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum struct HookId : uint32_t
+{
+	CreateFontIndirectExW,
+	GetTextMetricsW,
+	GetTextMetricsA,
+	GetGlyphOutlineW,
+	GetGlyphOutlineA,
+	GdipCreateFontFamilyFromName,
+	GdipCreateFont,
+	GdipGetGenericFontFamilySansSerif,
+	GdipGetGenericFontFamilySerif,
+	GdipGetGenericFontFamilyMonospace,
+	EnumFontFamiliesExW,
+	GetFontData,
+	GetTextExtentPoint32W,
+	GetTextExtentExPointW,
+	GetCharWidth32W,
+	GetCharABCWidthsW,
+	ExtTextOutW,
+	Count
+};
+
+constexpr std::array<std::string_view, static_cast<size_t>(HookId::Count)> hookNames = {
+	"CreateFontIndirectExW",
+	"GetTextMetricsW",
+	"GetTextMetricsA",
+	"GetGlyphOutlineW",
+	"GetGlyphOutlineA",
+	"GdipCreateFontFamilyFromName",
+	"GdipCreateFont",
+	"GdipGetGenericFontFamilySansSerif",
+	"GdipGetGenericFontFamilySerif",
+	"GdipGetGenericFontFamilyMonospace",
+	"EnumFontFamiliesExW",
+	"GetFontData",
+	"GetTextExtentPoint32W",
+	"GetTextExtentExPointW",
+	"GetCharWidth32W",
+	"GetCharABCWidthsW",
+	"ExtTextOutW",
+};
+
+enum struct LiveCounter : uint32_t
+{
+	RuleHits, // CreateFont calls matched by a "fonts" rule
+	RuleMisses,
+	FallbackHits, // Missing fonts replaced by FontFallback or fontFallbackChain
+	UserFontsLoaded,
+	LoggedBytes,
+	EnumCacheHits, // EnumFontFamiliesExW calls replayed from EnumFontCache
+	EnumCacheMisses,
+	FontDataHits, // GetFontData calls served by FontDataCache
+	FontDataMisses,
+	FontDataBytesSaved, // Bytes copied from FontDataCache instead of read by GDI
+	TextExtentHits, // Text extents answered by TextExtentCache
+	TextExtentMisses,
+	CharWidthHits, // 256 character blocks copied from CharWidthCache
+	CharWidthMisses,
+	GlyphReplaceStrings, // ExtTextOutW strings rewritten by glyphReplace
+	Count
+};
+
+constexpr std::array<std::string_view, static_cast<size_t>(LiveCounter::Count)> liveCounterNames = {
+	"ruleHits",
+	"ruleMisses",
+	"fallbackHits",
+	"userFontsLoaded",
+	"loggedBytes",
+	"enumCacheHits",
+	"enumCacheMisses",
+	"fontDataHits",
+	"fontDataMisses",
+	"fontDataBytesSaved",
+	"textExtentHits",
+	"textExtentMisses",
+	"charWidthHits",
+	"charWidthMisses",
+	"glyphReplaceStrings",
+};
+
+// Each counter has its own cache line, hooks on different threads don't share lines
+struct alignas(64) LiveCounterSlot
+{
+	std::atomic<uint64_t> value;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Counters are shared across processes");
+
+struct LiveStatsBlock
+{
+	static constexpr uint32_t Magic = 0x54534D46; // "FMST"
+	static constexpr uint32_t Version = 1; // Only changed by incompatible layouts, not by appended counters
+	static constexpr size_t HookCount = static_cast<size_t>(HookId::Count);
+	static constexpr size_t CounterCount = static_cast<size_t>(LiveCounter::Count);
+
+	std::atomic<uint32_t> magic; // Written last, the header is complete once it is set
+	uint32_t version;
+	uint32_t size;
+	uint32_t pid;
+	uint64_t startTime; // FILETIME, 100 ns units since 1601
+	uint32_t hookCount;
+	uint32_t counterCount;
+	LiveCounterSlot hookCalls[HookCount];
+	LiveCounterSlot counters[CounterCount];
+};
+
+// Shared memory name is this prefix followed by the decimal process id
+constexpr std::string_view LiveStatsNamePrefix = "FontModStats.";
+
+struct LiveStatsSnapshot
+{
+	uint32_t pid = 0;
+	uint64_t startTime = 0;
+	std::array<uint64_t, LiveStatsBlock::HookCount> hookCalls = {};
+	std::array<uint64_t, LiveStatsBlock::CounterCount> counters = {};
+};
+
+// Reads a mapped block of "size" bytes. Returns false if it isn't a compatible block.
+inline bool ReadLiveStats(const void* view, size_t size, LiveStatsSnapshot& snapshot)
+{
+	if (size < offsetof(LiveStatsBlock, hookCalls))
+		return false;
+
+	auto block = static_cast<const LiveStatsBlock*>(view);
+	if (block->magic.load(std::memory_order_acquire) != LiveStatsBlock::Magic || block->version != LiveStatsBlock::Version || block->size > size)
+		return false;
+
+	// Blocks from other builds may have fewer or more entries
+	const size_t hookCount = std::min<size_t>(block->hookCount, LiveStatsBlock::HookCount);
+	const size_t counterCount = std::min<size_t>(block->counterCount, LiveStatsBlock::CounterCount);
+	if (offsetof(LiveStatsBlock, hookCalls) + (block->hookCount + block->counterCount) * sizeof(LiveCounterSlot) > block->size)
+		return false;
+
+	auto slots = reinterpret_cast<const LiveCounterSlot*>(reinterpret_cast<const uint8_t*>(view) + offsetof(LiveStatsBlock, hookCalls));
+	snapshot = {};
+	snapshot.pid = block->pid;
+	snapshot.startTime = block->startTime;
+	for (size_t i = 0; i < hookCount; ++i)
+		snapshot.hookCalls[i] = slots[i].value.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < counterCount; ++i)
+		snapshot.counters[i] = slots[block->hookCount + i].value.load(std::memory_order_relaxed);
+	return true;
+}
@@ -0,0 +1,375 @@
+#pragma once
+
+// Results of GetTextExtentPoint32W and GetTextExtentExPointW remembered per selected
+// font, for UIs measuring the same strings again on every repaint. Entries are keyed by
+// a hash of the string and the DC state extents depend on, and the string is compared
+// on a hit. Each font keeps its most recently used entries, and is forgotten when
+// DeleteObject frees it.
+//
+// Only display DCs in GM_COMPATIBLE mode with a fixed scale map mode are cached. DCs
+// with text justification set are not cached, it can't be read back from a DC.
+
+#include "Simd.hpp"
+#include <bit>
+#include <list>
+#include <mutex>
+#include <unordered_set>
+
+// 16 bytes per step: each 64 bit lane adds its data and the product of its two 32 bit
+// halves, mixed with a key and the lane so far so the order of blocks matters. All
+// paths give the same result.
+inline uint64_t HashUtf16(const wchar_t* s, size_t count)
+{
+	constexpr uint64_t Key0 = 0x9E3779B97F4A7C15, Key1 = 0xC2B2AE3D27D4EB4F;
+	const auto* p = reinterpret_cast<const uint8_t*>(s);
+	size_t bytes = count * sizeof(wchar_t);
+	alignas(16) uint8_t tail[16] = {};
+
+#ifdef FONTMOD_SSE2
+	const __m128i key = _mm_set_epi64x(Key1, Key0);
+	__m128i acc = _mm_setzero_si128();
+	auto step = [&](const uint8_t* block) {
+		const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+		const __m128i dk = _mm_xor_si128(_mm_xor_si128(d, key), acc);
+		acc = _mm_add_epi64(acc, _mm_add_epi64(_mm_mul_epu32(dk, _mm_srli_epi64(dk, 32)), d));
+	};
+#elif defined(FONTMOD_NEON)
+	const uint64x2_t key = vcombine_u64(vcreate_u64(Key0), vcreate_u64(Key1));
+	uint64x2_t acc = vdupq_n_u64(0);
+	auto step = [&](const uint8_t* block) {
+		const uint64x2_t d = vreinterpretq_u64_u8(vld1q_u8(block));
+		const uint64x2_t dk = veorq_u64(veorq_u64(d, key), acc);
+		acc = vaddq_u64(acc, vaddq_u64(vmull_u32(vmovn_u64(dk), vshrn_n_u64(dk, 32)), d));
+	};
+#else
+	uint64_t acc[2] = {};
+	auto step = [&](const uint8_t* block) {
+		for (int i = 0; i < 2; ++i)
+		{
+			uint64_t d;
+			memcpy(&d, block + i * 8, 8);
+			const uint64_t dk = d ^ (i ? Key1 : Key0) ^ acc[i];
+			acc[i] += (dk & 0xFFFFFFFF) * (dk >> 32) + d;
+		}
+	};
+#endif
+
+	for (; bytes >= 16; bytes -= 16, p += 16)
+		step(p);
+	if (bytes)
+	{
+		memcpy(tail, p, bytes);
+		step(tail);
+	}
+
+	uint64_t lanes[2];
+#ifdef FONTMOD_SSE2
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+#elif defined(FONTMOD_NEON)
+	vst1q_u64(lanes, acc);
+#else
+	lanes[0] = acc[0];
+	lanes[1] = acc[1];
+#endif
+
+	// Length is mixed in so zero padding of the tail doesn't collide
+	uint64_t h = lanes[0] ^ std::rotl(lanes[1], 29) ^ (count * Key1);
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCD;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53;
+	h ^= h >> 33;
+	return h;
+}
+
+struct TextExtentCache
+{
+	static constexpr size_t ShardCount = 16;
+	static constexpr size_t MaxFontsPerShard = 64;
+	static constexpr int MaxLength = 256; // Longer strings are rarely measured twice
+
+	bool Enabled() const
+	{
+		return entriesPerFont != 0;
+	}
+
+	void Enable(size_t entries)
+	{
+		entriesPerFont = entries;
+	}
+
+	// Config time, after "memoryBudget" is read
+	void UseMemoryBudget()
+	{
+		budgetId = memoryBudget.Register("textExtentCache", [this] { return hits.load(std::memory_order_relaxed); }, [this](size_t bytes) { return Trim(bytes); });
+	}
+
+	template <class Original>
+	BOOL GetExtentPoint(HDC hdc, LPCWSTR text, int count, LPSIZE size, Original original)
+	{
+		Lookup lookup;
+		if (!size || !Prepare(hdc, text, count, Kind::Point, 0, lookup))
+			return original(hdc, text, count, size);
+
+		if (Find(lookup, [&](const Entry& e) { *size = e.size; }))
+			return TRUE;
+
+		BOOL result = original(hdc, text, count, size);
+		if (result)
+			Insert(lookup, *size, 0, nullptr);
+		return result;
+	}
+
+	// "fit" is only valid for the "maxExtent" it was computed with, which is part of the key
+	template <class Original>
+	BOOL GetExtentExPoint(HDC hdc, LPCWSTR text, int count, int maxExtent, LPINT fit, LPINT dx, LPSIZE size, Original original)
+	{
+		const Kind kind = static_cast<Kind>(static_cast<uint32_t>(Kind::ExPoint) | (fit ? FitFlag : 0) | (dx ? DxFlag : 0));
+		Lookup lookup;
+		if (!size || !Prepare(hdc, text, count, kind, fit ? maxExtent : 0, lookup))
+			return original(hdc, text, count, maxExtent, fit, dx, size);
+
+		if (Find(lookup, [&](const Entry& e) {
+			*size = e.size;
+			if (fit)
+				*fit = e.fit;
+			if (dx)
+				std::copy(e.dx.begin(), e.dx.end(), dx);
+		}))
+			return TRUE;
+
+		BOOL result = original(hdc, text, count, maxExtent, fit, dx, size);
+		if (result)
+			Insert(lookup, *size, fit ? *fit : 0, dx);
+		return result;
+	}
+
+	void FontDeleted(HGDIOBJ hFont)
+	{
+		auto& shard = ShardOf(static_cast<HFONT>(hFont));
+		std::lock_guard lock(shard.mutex);
+		if (auto it = shard.fonts.find(static_cast<HFONT>(hFont)); it != shard.fonts.end())
+			EraseFont(shard, it);
+	}
+
+	void JustificationSet(HDC hdc, int breakExtra, int breakCount)
+	{
+		std::lock_guard lock(justifiedMutex);
+		if (breakExtra != 0 && breakCount != 0)
+			justified.insert(hdc);
+		else
+			justified.erase(hdc);
+		hasJustified.store(!justified.empty(), std::memory_order_relaxed);
+	}
+
+	// At process exit other threads are gone, atomics only
+	void LogStats(HANDLE hFile)
+	{
+		FormatToFile(hFile, "[TextExtentCache] hits = {}, misses = {}, uncacheable = {}\n",
+			hits.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed), bypassed.load(std::memory_order_relaxed));
+	}
+
+private:
+	static constexpr uint32_t FitFlag = 0x100;
+	static constexpr uint32_t DxFlag = 0x200;
+
+	enum struct Kind : uint32_t
+	{
+		Point,
+		ExPoint, // Combined with FitFlag and DxFlag
+	};
+
+	struct Key
+	{
+		uint64_t hash;
+		Kind kind;
+		int mapMode;
+		int charExtra;
+		int maxExtent;
+
+		bool operator==(const Key&) const = default;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& k) const noexcept
+		{
+			return static_cast<size_t>(k.hash ^ (uint64_t(static_cast<uint32_t>(k.kind)) << 48) ^ (uint64_t(k.mapMode) << 40) ^ (uint64_t(uint32_t(k.charExtra)) << 8) ^ uint32_t(k.maxExtent));
+		}
+	};
+
+	struct Entry
+	{
+		Key key;
+		std::wstring text;
+		SIZE size;
+		int fit;
+		std::vector<int> dx;
+	};
+
+	struct FontEntries
+	{
+		std::list<Entry> lru; // Most recently used first
+		std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+		size_t bytes = 0; // Of all entries, for the memory budget
+	};
+
+	struct alignas(64) Shard
+	{
+		std::mutex mutex;
+		std::unordered_map<HFONT, FontEntries> fonts;
+	};
+
+	struct Lookup
+	{
+		HFONT font;
+		Key key;
+		std::wstring_view text;
+	};
+
+	bool Prepare(HDC hdc, LPCWSTR text, int count, Kind kind, int maxExtent, Lookup& lookup)
+	{
+		if (!text || count <= 0 || count > MaxLength)
+			return false;
+
+		const int mapMode = GetMapMode(hdc);
+		if (mapMode == MM_ISOTROPIC || mapMode == MM_ANISOTROPIC || GetGraphicsMode(hdc) != GM_COMPATIBLE || GetDeviceCaps(hdc, TECHNOLOGY) != DT_RASDISPLAY || IsJustified(hdc))
+		{
+			bypassed.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		lookup.font = static_cast<HFONT>(GetCurrentObject(hdc, OBJ_FONT));
+		lookup.text = std::wstring_view(text, count);
+		lookup.key = { HashUtf16(text, count), kind, mapMode, GetTextCharacterExtra(hdc), maxExtent };
+		return lookup.font != nullptr;
+	}
+
+	template <class Copy>
+	bool Find(const Lookup& lookup, Copy copy)
+	{
+		auto& shard = ShardOf(lookup.font);
+		{
+			std::lock_guard lock(shard.mutex);
+			if (auto font = shard.fonts.find(lookup.font); font != shard.fonts.end())
+			{
+				auto& entries = font->second;
+				if (auto it = entries.index.find(lookup.key); it != entries.index.end() && it->second->text == lookup.text)
+				{
+					entries.lru.splice(entries.lru.begin(), entries.lru, it->second);
+					copy(*it->second);
+					hits.fetch_add(1, std::memory_order_relaxed);
+					liveStats.Add(LiveCounter::TextExtentHits);
+					return true;
+				}
+			}
+		}
+		misses.fetch_add(1, std::memory_order_relaxed);
+		liveStats.Add(LiveCounter::TextExtentMisses);
+		return false;
+	}
+
+	void Insert(const Lookup& lookup, SIZE size, int fit, const int* dx)
+	{
+		auto& shard = ShardOf(lookup.font);
+		bool overBudget;
+		{
+			std::lock_guard lock(shard.mutex);
+			auto font = shard.fonts.find(lookup.font);
+			if (font == shard.fonts.end())
+			{
+				if (shard.fonts.size() >= MaxFontsPerShard)
+					EraseFont(shard, shard.fonts.begin());
+				font = shard.fonts.try_emplace(lookup.font).first;
+			}
+
+			auto& entries = font->second;
+			if (auto it = entries.index.find(lookup.key); it != entries.index.end())
+			{
+				// Another thread added it, or a different string with the same hash
+				EraseEntry(entries, it->second);
+			}
+
+			Entry e{ lookup.key, std::wstring(lookup.text), size, fit };
+			if (dx)
+				e.dx.assign(dx, dx + lookup.text.size());
+			const size_t bytes = EntryBytes(e);
+			entries.lru.push_front(std::move(e));
+			entries.index.emplace(lookup.key, entries.lru.begin());
+			entries.bytes += bytes;
+			overBudget = memoryBudget.Add(budgetId, bytes);
+			if (entries.lru.size() > entriesPerFont)
+				EraseEntry(entries, std::prev(entries.lru.end()));
+		}
+		if (overBudget)
+			memoryBudget.Enforce();
+	}
+
+	// List and index nodes included, roughly
+	static size_t EntryBytes(const Entry& e)
+	{
+		return sizeof(Entry) + e.text.size() * sizeof(wchar_t) + e.dx.size() * sizeof(int) + 8 * sizeof(void*);
+	}
+
+	// Under the shard lock
+	void EraseEntry(FontEntries& entries, std::list<Entry>::iterator it)
+	{
+		const size_t bytes = EntryBytes(*it);
+		entries.bytes -= bytes;
+		memoryBudget.Remove(budgetId, bytes);
+		entries.index.erase(it->key);
+		entries.lru.erase(it);
+	}
+
+	// Under the shard lock, returns the bytes freed
+	size_t EraseFont(Shard& shard, std::unordered_map<HFONT, FontEntries>::iterator it)
+	{
+		const size_t bytes = it->second.bytes;
+		memoryBudget.Remove(budgetId, bytes);
+		shard.fonts.erase(it);
+		return bytes;
+	}
+
+	// Same as the per shard font limit, whole fonts are dropped
+	size_t Trim(size_t bytes)
+	{
+		size_t freed = 0;
+		for (size_t n = 0; n < ShardCount && freed < bytes; ++n)
+		{
+			auto& shard = shards[nextTrimShard++ % ShardCount];
+			std::lock_guard lock(shard.mutex);
+			while (freed < bytes && !shard.fonts.empty())
+				freed += EraseFont(shard, shard.fonts.begin());
+		}
+		return freed;
+	}
+
+	bool IsJustified(HDC hdc)
+	{
+		if (!hasJustified.load(std::memory_order_relaxed))
+			return false;
+		std::lock_guard lock(justifiedMutex);
+		return justified.contains(hdc);
+	}
+
+	Shard& ShardOf(HFONT hFont)
+	{
+		return shards[(reinterpret_cast<uintptr_t>(hFont) >> 2) % ShardCount];
+	}
+
+	size_t entriesPerFont = 0;
+	Shard shards[ShardCount];
+	MemoryBudget::Id budgetId = MemoryBudget::NoId;
+	size_t nextTrimShard = 0; // Only used by MemoryBudget::Enforce, one at a time
+
+	std::mutex justifiedMutex;
+	std::unordered_set<HDC> justified; // DCs where SetTextJustification set a break extra
+	std::atomic<bool> hasJustified = false;
+
+	std::atomic<uint64_t> hits = 0;
+	std::atomic<uint64_t> misses = 0;
+	std::atomic<uint64_t> bypassed = 0;
+};
+
+// Never destroyed, hooks may still use it during unload
+TextExtentCache& textExtentCache = *new TextExtentCache;
@@ -0,0 +1,128 @@
+#pragma once
+
+// Effective DPI of the thread creating a font, for "fonts" sizes in points or DIPs. Kept
+// per thread in a DpiCache (DpiSize.hpp) and only looked up again when the thread's DPI
+// awareness context changes, or set from WM_DPICHANGED of the thread's windows through a
+// thread hook, so CreateFont doesn't query windows and monitors.
+//
+// Unaware threads are scaled by the system and use 96. Per monitor aware threads use the
+// DPI of their active window, else of their first visible window. The hook is installed
+// once such a window is found, threads that never own a top level window don't get one.
+// Until then the system DPI is used and looked up again now and then, not on every call.
+// Without the DPI APIs of Windows 10 1607 the screen DC's DPI is used.
+
+#include "DpiSize.hpp"
+
+struct ThreadDpi
+{
+	// Config time, when a rule has sizes per DPI
+	void Enable()
+	{
+		HMODULE user32 = GetModuleHandleW(L"user32.dll");
+		getThreadDpiAwarenessContext = GetProcAddressByFunctionDeclaration(user32, GetThreadDpiAwarenessContext);
+		getAwarenessFromDpiAwarenessContext = GetProcAddressByFunctionDeclaration(user32, GetAwarenessFromDpiAwarenessContext);
+		getDpiForWindow = GetProcAddressByFunctionDeclaration(user32, GetDpiForWindow);
+		getDpiForSystem = GetProcAddressByFunctionDeclaration(user32, GetDpiForSystem);
+		if (!getAwarenessFromDpiAwarenessContext || !getDpiForWindow || !getDpiForSystem)
+			getThreadDpiAwarenessContext = nullptr;
+	}
+
+	uint32_t Get()
+	{
+		if (!getThreadDpiAwarenessContext)
+			return SystemDpi();
+
+		auto& cache = ThreadCache();
+		return cache.Get(getThreadDpiAwarenessContext(), GetTickCount64(), [&](bool& final) { return Query(cache.context, final); });
+	}
+
+	// DPI of the process as a whole, for fonts not created by a thread of the program
+	uint32_t SystemDpi() const
+	{
+		if (getDpiForSystem)
+			return getDpiForSystem();
+
+		static const uint32_t screenDpi = [] {
+			HDC hdc = GetDC(nullptr);
+			const int dpi = hdc ? GetDeviceCaps(hdc, LOGPIXELSY) : 0;
+			if (hdc)
+				ReleaseDC(nullptr, hdc);
+			return dpi > 0 ? static_cast<uint32_t>(dpi) : DefaultDpi;
+		}();
+		return screenDpi;
+	}
+
+private:
+	static DpiCache<DPI_AWARENESS_CONTEXT>& ThreadCache()
+	{
+		thread_local DpiCache<DPI_AWARENESS_CONTEXT> cache;
+		return cache;
+	}
+
+	// Clears "final" for threads that have no window yet
+	uint32_t Query(DPI_AWARENESS_CONTEXT context, bool& final)
+	{
+		switch (getAwarenessFromDpiAwarenessContext(context))
+		{
+		case DPI_AWARENESS_UNAWARE:
+			return USER_DEFAULT_SCREEN_DPI;
+		case DPI_AWARENESS_SYSTEM_AWARE:
+			return getDpiForSystem();
+		default:
+			break;
+		}
+
+		HWND hwnd = nullptr;
+		GUITHREADINFO gti = { sizeof(gti) };
+		if (GetGUIThreadInfo(GetCurrentThreadId(), &gti))
+			hwnd = gti.hwndActive;
+		if (!hwnd)
+		{
+			EnumThreadWindows(GetCurrentThreadId(), [](HWND h, LPARAM param) -> BOOL {
+				if (!IsWindowVisible(h))
+					return TRUE;
+				*reinterpret_cast<HWND*>(param) = h;
+				return FALSE;
+			}, reinterpret_cast<LPARAM>(&hwnd));
+		}
+		if (!hwnd)
+		{
+			final = false;
+			return getDpiForSystem();
+		}
+
+		// Its windows may move between monitors from now on
+		HookThread();
+		return getDpiForWindow(hwnd);
+	}
+
+	// Thread hooks are removed by the system when their thread exits
+	static void HookThread()
+	{
+		thread_local bool hooked = false;
+		if (hooked)
+			return;
+		hooked = true;
+		SetWindowsHookExW(WH_CALLWNDPROC, OnCallWndProc, nullptr, GetCurrentThreadId());
+	}
+
+	// Before the window procedure, so fonts it creates for the new DPI use it
+	static LRESULT CALLBACK OnCallWndProc(int code, WPARAM wParam, LPARAM lParam)
+	{
+		if (code == HC_ACTION)
+		{
+			auto msg = reinterpret_cast<const CWPSTRUCT*>(lParam);
+			if (msg->message == WM_DPICHANGED)
+				ThreadCache().Changed(HIWORD(msg->wParam));
+		}
+		return CallNextHookEx(nullptr, code, wParam, lParam);
+	}
+
+	decltype(GetThreadDpiAwarenessContext)* getThreadDpiAwarenessContext = nullptr;
+	decltype(GetAwarenessFromDpiAwarenessContext)* getAwarenessFromDpiAwarenessContext = nullptr;
+	decltype(GetDpiForWindow)* getDpiForWindow = nullptr;
+	decltype(GetDpiForSystem)* getDpiForSystem = nullptr;
+};
+
+// Never destroyed, hooks may still use it during unload
+ThreadDpi& threadDpi = *new ThreadDpi;
@@ -0,0 +1,236 @@
+#pragma once
+
+// Single pass validating UTF-8 <-> UTF-16 conversion, with a vectorized ASCII fast
+// path. Rejects the same input as MultiByteToWideChar(MB_ERR_INVALID_CHARS) and
+// WideCharToMultiByte(WC_ERR_INVALID_CHARS): overlong forms, encoded surrogates,
+// code points above U+10FFFF, truncated sequences and unpaired surrogates.
+//
+// Code units are any 16 bit type, wchar_t on Windows and char16_t elsewhere. The string
+// functions convert into a scratch buffer and only assign the output on success, so it
+// is left untouched on failure like with the Win32 functions.
+
+#include "Simd.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+constexpr size_t UtfInvalid = SIZE_MAX;
+
+// "out" must have room for "size" code units. Returns code units written, or UtfInvalid.
+template <class Char16>
+size_t ConvertUtf8ToUtf16(const char* in, size_t size, Char16* out)
+{
+	static_assert(sizeof(Char16) == 2, "UTF-16 code units expected");
+	const auto* s = reinterpret_cast<const uint8_t*>(in);
+	const auto* end = s + size;
+	Char16* d = out;
+
+	while (s < end)
+	{
+		// ASCII runs, 16 bytes at a time
+#ifdef FONTMOD_SSE2
+		while (end - s >= 16)
+		{
+			__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+			if (_mm_movemask_epi8(chunk) != 0)
+				break;
+			const __m128i zero = _mm_setzero_si128();
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_unpacklo_epi8(chunk, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(d + 8), _mm_unpackhi_epi8(chunk, zero));
+			s += 16;
+			d += 16;
+		}
+#elif defined(FONTMOD_NEON)
+		while (end - s >= 16)
+		{
+			uint8x16_t chunk = vld1q_u8(s);
+			if (vmaxvq_u8(chunk) >= 0x80)
+				break;
+			vst1q_u16(reinterpret_cast<uint16_t*>(d), vmovl_u8(vget_low_u8(chunk)));
+			vst1q_u16(reinterpret_cast<uint16_t*>(d + 8), vmovl_high_u8(chunk));
+			s += 16;
+			d += 16;
+		}
+#endif
+		if (s == end)
+			break;
+
+		const uint8_t c = *s;
+		if (c < 0x80)
+		{
+			*d++ = c;
+			++s;
+			continue;
+		}
+
+		size_t len;
+		uint32_t cp;
+		uint8_t lo = 0x80, hi = 0xBF; // Allowed range of second byte
+		if (c >= 0xC2 && c <= 0xDF)
+		{
+			len = 2;
+			cp = c & 0x1F;
+		}
+		else if (c >= 0xE0 && c <= 0xEF)
+		{
+			len = 3;
+			cp = c & 0x0F;
+			if (c == 0xE0)
+				lo = 0xA0; // Overlong
+			else if (c == 0xED)
+				hi = 0x9F; // Surrogates
+		}
+		else if (c >= 0xF0 && c <= 0xF4)
+		{
+			len = 4;
+			cp = c & 0x07;
+			if (c == 0xF0)
+				lo = 0x90; // Overlong
+			else if (c == 0xF4)
+				hi = 0x8F; // Above U+10FFFF
+		}
+		else
+		{
+			return UtfInvalid;
+		}
+
+		if (static_cast<size_t>(end - s) < len || s[1] < lo || s[1] > hi)
+			return UtfInvalid;
+		for (size_t i = 1; i < len; ++i)
+		{
+			if ((s[i] & 0xC0) != 0x80)
+				return UtfInvalid;
+			cp = (cp << 6) | (s[i] & 0x3F);
+		}
+		s += len;
+
+		if (cp >= 0x10000)
+		{
+			cp -= 0x10000;
+			*d++ = static_cast<Char16>(0xD800 | (cp >> 10));
+			*d++ = static_cast<Char16>(0xDC00 | (cp & 0x3FF));
+		}
+		else
+		{
+			*d++ = static_cast<Char16>(cp);
+		}
+	}
+
+	return static_cast<size_t>(d - out);
+}
+
+// "out" must have room for 3 * "size" bytes. Returns bytes written, or UtfInvalid.
+template <class Char16>
+size_t ConvertUtf16ToUtf8(const Char16* in, size_t size, char* out)
+{
+	static_assert(sizeof(Char16) == 2, "UTF-16 code units expected");
+	const Char16* s = in;
+	const Char16* end = in + size;
+	auto* d = reinterpret_cast<uint8_t*>(out);
+
+	while (s < end)
+	{
+		// ASCII runs, 8 code units at a time
+#ifdef FONTMOD_SSE2
+		while (end - s >= 8)
+		{
+			__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+			__m128i high = _mm_and_si128(chunk, _mm_set1_epi16(static_cast<short>(0xFF80)));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF)
+				break;
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(d), _mm_packus_epi16(chunk, chunk));
+			s += 8;
+			d += 8;
+		}
+#elif defined(FONTMOD_NEON)
+		while (end - s >= 8)
+		{
+			uint16x8_t chunk = vld1q_u16(reinterpret_cast<const uint16_t*>(s));
+			if (vmaxvq_u16(chunk) >= 0x80)
+				break;
+			vst1_u8(d, vmovn_u16(chunk));
+			s += 8;
+			d += 8;
+		}
+#endif
+		if (s == end)
+			break;
+
+		uint32_t cp = static_cast<uint16_t>(*s++);
+		if (cp < 0x80)
+		{
+			*d++ = static_cast<uint8_t>(cp);
+		}
+		else if (cp < 0x800)
+		{
+			*d++ = static_cast<uint8_t>(0xC0 | (cp >> 6));
+			*d++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+		}
+		else if (cp >= 0xD800 && cp <= 0xDFFF)
+		{
+			if (cp >= 0xDC00 || s == end || *s < 0xDC00 || *s > 0xDFFF)
+				return UtfInvalid; // Unpaired surrogate
+			cp = 0x10000 + ((cp - 0xD800) << 10) + (static_cast<uint16_t>(*s++) - 0xDC00);
+			*d++ = static_cast<uint8_t>(0xF0 | (cp >> 18));
+			*d++ = static_cast<uint8_t>(0x80 | ((cp >> 12) & 0x3F));
+			*d++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+			*d++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+		}
+		else
+		{
+			*d++ = static_cast<uint8_t>(0xE0 | (cp >> 12));
+			*d++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+			*d++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+		}
+	}
+
+	return static_cast<size_t>(d - reinterpret_cast<uint8_t*>(out));
+}
+
+// Strings up to this size are converted on the stack, longer ones in a heap buffer that
+// isn't zero filled
+constexpr size_t UtfStackBuffer = 256;
+
+template <class Char16>
+bool Utf8ToUtf16(std::string_view utf8, std::basic_string<Char16>& utf16)
+{
+	// Each byte produces at most one UTF-16 code unit
+	Char16 stack[UtfStackBuffer];
+	std::unique_ptr<Char16[]> heap;
+	Char16* buffer = stack;
+	if (utf8.size() > UtfStackBuffer)
+	{
+		heap = std::make_unique_for_overwrite<Char16[]>(utf8.size());
+		buffer = heap.get();
+	}
+
+	const size_t length = ConvertUtf8ToUtf16(utf8.data(), utf8.size(), buffer);
+	if (length == UtfInvalid)
+		return false;
+
+	utf16.assign(buffer, length);
+	return true;
+}
+
+template <class Char16>
+bool Utf16ToUtf8(std::basic_string_view<Char16> utf16, std::string& utf8)
+{
+	// Each code unit produces at most three bytes, a surrogate pair four
+	char stack[UtfStackBuffer * 3];
+	std::unique_ptr<char[]> heap;
+	char* buffer = stack;
+	if (utf16.size() > UtfStackBuffer)
+	{
+		heap = std::make_unique_for_overwrite<char[]>(utf16.size() * 3);
+		buffer = heap.get();
+	}
+
+	const size_t length = ConvertUtf16ToUtf8(utf16.data(), utf16.size(), buffer);
+	if (length == UtfInvalid)
+		return false;
+
+	utf8.assign(buffer, length);
+	return true;
+}
@@ -1,101 +1,18 @@
 #pragma once
 
-// https://msdn.microsoft.com/en-us/magazine/mt763237
-bool Utf8ToUtf16(std::string_view utf8, std::wstring& utf16)
-{
-	if (utf8.empty())
-	{
-		utf16.clear();
-		return true;
-	}
-
-	constexpr DWORD kFlags = MB_ERR_INVALID_CHARS;
-
-	const int utf8Length = static_cast<int>(utf8.length());
-
-	const int utf16Length = MultiByteToWideChar(
-		CP_UTF8,
-		kFlags,
-		utf8.data(),
-		utf8Length,
-		nullptr,
-		0
-	);
-
-	if (utf16Length == 0)
-	{
-		return false;
-	}
-
-	utf16.resize(utf16Length);
-
-	int result = MultiByteToWideChar(
-		CP_UTF8,
-		kFlags,
-		utf8.data(),
-		utf8Length,
-		utf16.data(),
-		utf16Length
-	);
+#include <atomic>
 
-	if (result == 0)
-	{
-		return false;
-	}
-
-	return true;
-}
+#include "Utf.hpp"
 
 bool Utf8ToUtf16(c4::csubstr utf8, std::wstring& utf16)
 {
 	return Utf8ToUtf16(std::string_view(utf8.data(), utf8.size()), utf16);
 }
 
+// For face names and other arrays of WCHAR, which the template can't deduce from
 bool Utf16ToUtf8(std::wstring_view utf16, std::string& utf8)
 {
-	if (utf16.empty())
-	{
-		utf8.clear();
-		return true;
-	}
-
-	constexpr DWORD kFlags = WC_ERR_INVALID_CHARS;
-
-	const int utf16Length = static_cast<int>(utf16.length());
-
-	const int utf8Length = WideCharToMultiByte(
-		CP_UTF8,
-		kFlags,
-		utf16.data(),
-		utf16Length,
-		nullptr,
-		0,
-		nullptr, nullptr
-	);
-
-	if (utf8Length == 0)
-	{
-		return false;
-	}
-
-	utf8.resize(utf8Length);
-
-	int result = WideCharToMultiByte(
-		CP_UTF8,
-		kFlags,
-		utf16.data(),
-		utf16Length,
-		utf8.data(),
-		utf8Length,
-		nullptr, nullptr
-	);
-
-	if (result == 0)
-	{
-		return false;
-	}
-
-	return true;
+	return Utf16ToUtf8<wchar_t>(utf16, utf8);
 }
 
 inline bool stol(const std::string& str, long& out)
@@ -201,6 +118,9 @@ bool iequals(std::wstring_view a, std::wstring_view b)
 		[](wchar_t a, wchar_t b) { return a == b || tolower(a) == tolower(b); });
 }
 
+// Bytes written by FormatToFile are added here when set (live stats)
+std::atomic<uint64_t>* formatToFileBytes = nullptr;
+
 template <size_t buf_size = 64>
 struct format_to_file_buffer
 {
@@ -212,6 +132,8 @@ struct format_to_file_buffer
 	{
 		DWORD written;
 		WriteFile(hFile, buf, static_cast<DWORD>(len), &written, nullptr);
+		if (formatToFileBytes)
+			formatToFileBytes->fetch_add(len, std::memory_order_relaxed);
 		len = 0;
 	}
 
@@ -0,0 +1,150 @@
+#pragma once
+
+// WOFF / WOFF2 to sfnt decoding, so that web fonts in the "fonts" folder can be
+// handed to AddFontMemResourceEx without going through temporary files.
+// https://www.w3.org/TR/WOFF/ https://www.w3.org/TR/WOFF2/
+
+#include "Sfnt.hpp"
+#include <zlib.h>
+#ifndef FONTMOD_NO_WOFF2 // Portable builds without the woff2 library, WOFF2 files are then rejected
+#include <woff2/decode.h>
+#include <woff2/output.h>
+#endif
+
+// Decoded fonts larger than this are rejected, as headers can claim up to 4 GB. Real
+// fonts are far smaller, CJK fonts with all their glyphs included.
+constexpr size_t MaxDecodedFontSize = 128 << 20;
+
+enum struct WebFontFormat
+{
+	None,
+	Woff,
+	Woff2
+};
+
+WebFontFormat GetWebFontFormat(const uint8_t* data, size_t size)
+{
+	if (size < 4)
+		return WebFontFormat::None;
+
+	switch (ReadU32BE(data))
+	{
+	case SfntTag('w', 'O', 'F', 'F'):
+		return WebFontFormat::Woff;
+	case SfntTag('w', 'O', 'F', '2'):
+		return WebFontFormat::Woff2;
+	}
+	return WebFontFormat::None;
+}
+
+// Decodes WOFF 1.0 into sfnt. "sfnt" is resized to the output size, its capacity is
+// kept between calls so callers can reuse one buffer for many files.
+bool DecodeWoff(const uint8_t* data, size_t size, std::vector<uint8_t>& sfnt)
+{
+	constexpr size_t headerSize = 44;
+	constexpr size_t entrySize = 20;
+
+	if (size < headerSize || GetWebFontFormat(data, size) != WebFontFormat::Woff)
+		return false;
+	if (ReadU32BE(data + 8) != size)
+		return false;
+
+	const uint16_t numTables = ReadU16BE(data + 12);
+	if (numTables == 0 || headerSize + size_t(numTables) * entrySize > size)
+		return false;
+
+	// Compute output size first, so the buffer is allocated only once
+	uint64_t sfntSize = SfntHeaderSize + uint64_t(numTables) * SfntTableRecordSize;
+	for (uint16_t i = 0; i < numTables; ++i)
+	{
+		const uint8_t* entry = data + headerSize + i * entrySize;
+		const uint32_t offset = ReadU32BE(entry + 4);
+		const uint32_t compLength = ReadU32BE(entry + 8);
+		const uint32_t origLength = ReadU32BE(entry + 12);
+
+		// Checked before padding, which would wrap lengths close to 4 GB to 0
+		if (uint64_t(offset) + compLength > size || compLength > origLength || origLength > MaxDecodedFontSize)
+			return false;
+		sfntSize += SfntPad4(origLength);
+	}
+	if (sfntSize > MaxDecodedFontSize)
+		return false;
+
+	sfnt.assign(static_cast<size_t>(sfntSize), 0);
+	uint8_t* out = sfnt.data();
+
+	uint16_t entrySelector = 0;
+	while ((2u << entrySelector) <= numTables)
+		++entrySelector;
+	const uint16_t searchRange = static_cast<uint16_t>((1u << entrySelector) * 16);
+
+	WriteU32BE(out, ReadU32BE(data + 4)); // flavor
+	WriteU16BE(out + 4, numTables);
+	WriteU16BE(out + 6, searchRange);
+	WriteU16BE(out + 8, entrySelector);
+	WriteU16BE(out + 10, static_cast<uint16_t>(numTables * 16 - searchRange));
+
+	uint32_t tableOffset = static_cast<uint32_t>(SfntHeaderSize + size_t(numTables) * SfntTableRecordSize);
+	for (uint16_t i = 0; i < numTables; ++i)
+	{
+		const uint8_t* entry = data + headerSize + i * entrySize;
+		const uint32_t offset = ReadU32BE(entry + 4);
+		const uint32_t compLength = ReadU32BE(entry + 8);
+		const uint32_t origLength = ReadU32BE(entry + 12);
+
+		uint8_t* record = out + SfntHeaderSize + i * SfntTableRecordSize;
+		WriteU32BE(record, ReadU32BE(entry)); // tag
+		WriteU32BE(record + 4, ReadU32BE(entry + 16)); // checksum
+		WriteU32BE(record + 8, tableOffset);
+		WriteU32BE(record + 12, origLength);
+
+		if (uint64_t(tableOffset) + origLength > sfnt.size())
+			return false;
+		if (compLength == origLength)
+		{
+			memcpy(out + tableOffset, data + offset, origLength);
+		}
+		else
+		{
+			uLongf destLen = origLength;
+			if (uncompress(out + tableOffset, &destLen, data + offset, compLength) != Z_OK || destLen != origLength)
+				return false;
+		}
+
+		tableOffset += SfntPad4(origLength);
+	}
+
+	return true;
+}
+
+bool DecodeWoff2(const uint8_t* data, size_t size, std::vector<uint8_t>& sfnt)
+{
+#ifdef FONTMOD_NO_WOFF2
+	return false;
+#else
+	// From the header, the output buffer is allocated before anything is decoded
+	const size_t finalSize = woff2::ComputeWOFF2FinalSize(data, size);
+	if (finalSize == 0 || finalSize > MaxDecodedFontSize)
+		return false;
+
+	sfnt.resize(finalSize);
+	woff2::WOFF2MemoryOut out(sfnt.data(), sfnt.size());
+	if (!woff2::ConvertWOFF2ToTTF(data, size, &out))
+		return false;
+
+	sfnt.resize(out.Size());
+	return true;
+#endif
+}
+
+bool DecodeWebFont(const uint8_t* data, size_t size, std::vector<uint8_t>& sfnt)
+{
+	switch (GetWebFontFormat(data, size))
+	{
+	case WebFontFormat::Woff:
+		return DecodeWoff(data, size, sfnt);
+	case WebFontFormat::Woff2:
+		return DecodeWoff2(data, size, sfnt);
+	}
+	return false;
+}
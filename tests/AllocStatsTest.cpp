@@ -0,0 +1,121 @@
+// Built with FONTMOD_ALLOC_PROFILE, so this test's own operator new is the profiled one.
+// Other allocations of the test (gtest's) are charged to "other".
+
+#include "AllocStats.hpp"
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <thread>
+
+static_assert(allocProfileBuild, "AllocStatsTest is built with FONTMOD_ALLOC_PROFILE");
+
+namespace
+{
+	AllocStats::Usage Find(std::string_view scope)
+	{
+		for (const auto& u : allocStats.Snapshot())
+		{
+			if (u.scope == scope)
+				return u;
+		}
+		return { scope };
+	}
+}
+
+TEST(AllocStats, ScopeNames)
+{
+	EXPECT_EQ(AllocScopeName(AllocScopeOf(AllocPhase::Other)), "other");
+	EXPECT_EQ(AllocScopeName(AllocScopeOf(AllocPhase::Reports)), "reports");
+	EXPECT_EQ(AllocScopeName(AllocScopeOf(HookId::CreateFontIndirectExW)), "CreateFontIndirectExW");
+	EXPECT_EQ(AllocScopeName(AllocScopeOf(HookId::ExtTextOutW)), "ExtTextOutW");
+	EXPECT_EQ(AllocScopeName(AllocScopeCount - 1), hookNames.back());
+}
+
+// Scopes nest, and frees are charged to the scope that allocated
+TEST(AllocStats, NestedScopes)
+{
+	std::string* kept;
+	{
+		AllocScope config(AllocPhase::Config);
+		std::map<int, std::string> map;
+		for (int i = 0; i < 100; ++i)
+			map[i] = std::string(100, 'x');
+		{
+			AllocScope ryml(AllocPhase::Ryml);
+			kept = new std::string(1000, 'y');
+		}
+	}
+	delete kept; // In no scope
+
+	const auto config = Find("config");
+	EXPECT_GE(config.allocations, 200u); // Nodes and strings
+	EXPECT_EQ(config.frees, config.allocations);
+	EXPECT_EQ(config.live, 0);
+	EXPECT_GE(config.peak, 100 * 100);
+
+	const auto ryml = Find("ryml");
+	EXPECT_EQ(ryml.allocations, 2u);
+	EXPECT_EQ(ryml.frees, 2u);
+	EXPECT_EQ(ryml.live, 0);
+	EXPECT_GE(ryml.bytes, 1000 + sizeof(std::string));
+	EXPECT_EQ(ryml.peak, static_cast<int64_t>(ryml.bytes));
+}
+
+TEST(AllocStats, LiveBytes)
+{
+	std::vector<char*> blocks;
+	{
+		AllocScope warmup(AllocPhase::Warmup);
+		blocks.reserve(10);
+		for (int i = 0; i < 10; ++i)
+			blocks.push_back(new char[100]);
+	}
+	auto warmup = Find("warmup");
+	EXPECT_EQ(warmup.allocations, 11u);
+	EXPECT_EQ(warmup.live, static_cast<int64_t>(1000 + 10 * sizeof(char*)));
+
+	for (char* block : blocks)
+		delete[] block;
+	warmup = Find("warmup");
+	EXPECT_EQ(warmup.live, static_cast<int64_t>(10 * sizeof(char*)));
+	EXPECT_EQ(warmup.peak, static_cast<int64_t>(1000 + 10 * sizeof(char*)));
+}
+
+// Each thread has its own scope, and counts stay exact across threads
+TEST(AllocStats, Threads)
+{
+	constexpr int Threads = 8;
+	constexpr int Blocks = 10000;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < Threads; ++t)
+	{
+		threads.emplace_back([] {
+			AllocScope hook(HookId::ExtTextOutW);
+			for (int i = 0; i < Blocks; ++i)
+				delete[] new char[64];
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	const auto hook = Find("ExtTextOutW");
+	EXPECT_EQ(hook.allocations, uint64_t(Threads) * Blocks);
+	EXPECT_EQ(hook.frees, uint64_t(Threads) * Blocks);
+	EXPECT_EQ(hook.bytes, uint64_t(Threads) * Blocks * 64);
+	EXPECT_EQ(hook.live, 0);
+	EXPECT_GE(hook.peak, 64);
+	EXPECT_LE(hook.peak, Threads * 64);
+	EXPECT_EQ(Find("GetFontData").allocations, 0u); // Unused scopes aren't listed
+}
+
+TEST(AllocStats, KeepsAlignment)
+{
+	AllocScope scope(AllocPhase::Startup);
+	for (size_t size : { 1, 7, 16, 33, 4096 })
+	{
+		void* p = operator new(size);
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % __STDCPP_DEFAULT_NEW_ALIGNMENT__, 0u) << size;
+		operator delete(p);
+	}
+	EXPECT_EQ(operator new(SIZE_MAX / 2, std::nothrow), nullptr);
+}
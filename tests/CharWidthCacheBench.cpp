@@ -0,0 +1,103 @@
+// CharWidthCache against calling GDI directly, on the fake GDI. The argument is the spin
+// count of a fake GDI call, 0 shows the cache's own overhead, higher ones stand in for
+// the kernel transition of real GDI.
+
+#include "FakeGdi.hpp"
+#include "MemoryBudget.hpp"
+#include "CharWidthCache.hpp"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+	// One font selected into a screen DC, shared by all benchmark threads
+	struct Fixture
+	{
+		Fixture()
+		{
+			LOGFONTW lf = {};
+			lf.lfHeight = -16;
+			wcscpy(lf.lfFaceName, L"Segoe UI");
+			font = CreateFontIndirectW(&lf);
+			hdc = CreateCompatibleDC(nullptr);
+			SelectObject(hdc, font);
+			cache.enabled = true;
+		}
+
+		HDC hdc;
+		HFONT font;
+		CharWidthCache cache;
+	};
+
+	Fixture& Shared()
+	{
+		static Fixture fixture;
+		return fixture;
+	}
+
+	// A line of mixed Latin and CJK text, measured one character at a time as layout
+	// loops do
+	constexpr std::wstring_view Line = L"FontMod \x5FAE\x8F6F\x96C5\x9ED1 replaces fonts of Win32 programs \x4E2D\x6587";
+
+	void Direct(benchmark::State& state)
+	{
+		fakeGdi.callCost = static_cast<uint32_t>(state.range(0));
+		Fixture& f = Shared();
+		for (auto _ : state)
+		{
+			for (wchar_t ch : Line)
+			{
+				INT width;
+				GetCharWidth32W(f.hdc, ch, ch, &width);
+				benchmark::DoNotOptimize(width);
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * Line.size());
+	}
+
+	void Cached(benchmark::State& state)
+	{
+		fakeGdi.callCost = static_cast<uint32_t>(state.range(0));
+		Fixture& f = Shared();
+		for (auto _ : state)
+		{
+			for (wchar_t ch : Line)
+			{
+				INT width;
+				f.cache.GetWidths(f.hdc, ch, ch, &width, GetCharWidth32W);
+				benchmark::DoNotOptimize(width);
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * Line.size());
+	}
+
+	// ABC widths of a whole block, as text renderers prefetch them
+	void DirectAbcBlock(benchmark::State& state)
+	{
+		fakeGdi.callCost = static_cast<uint32_t>(state.range(0));
+		Fixture& f = Shared();
+		ABC abc[CharWidthCache::BlockSize];
+		for (auto _ : state)
+		{
+			GetCharABCWidthsW(f.hdc, 0x20, 0x7E, abc);
+			benchmark::DoNotOptimize(abc);
+		}
+	}
+
+	void CachedAbcBlock(benchmark::State& state)
+	{
+		fakeGdi.callCost = static_cast<uint32_t>(state.range(0));
+		Fixture& f = Shared();
+		ABC abc[CharWidthCache::BlockSize];
+		for (auto _ : state)
+		{
+			f.cache.GetABCWidths(f.hdc, 0x20, 0x7E, abc, GetCharABCWidthsW);
+			benchmark::DoNotOptimize(abc);
+		}
+	}
+}
+
+BENCHMARK(Direct)->Arg(0)->Arg(100)->Arg(1000);
+BENCHMARK(Cached)->Arg(0)->Arg(100)->Arg(1000);
+BENCHMARK(Cached)->Arg(100)->Threads(4)->UseRealTime();
+BENCHMARK(DirectAbcBlock)->Arg(0)->Arg(1000);
+BENCHMARK(CachedAbcBlock)->Arg(0)->Arg(1000);
@@ -0,0 +1,92 @@
+// Parsing "cmap" of a large font and checking a charset against it, as done once
+// per fallback font and once per charset
+
+#include "FakeGdi.hpp"
+#include "Coverage.hpp"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+	// Format 4 subtable in the shape of a CJK font: many short segments mapped through
+	// glyphIdArray, so the per code point path is taken
+	std::vector<uint8_t> CjkCmap()
+	{
+		std::vector<std::pair<uint16_t, uint16_t>> segments;
+		for (uint32_t start = 0x20; start < 0xFF00; start += 96)
+			segments.push_back({ static_cast<uint16_t>(start), static_cast<uint16_t>(start + 15) });
+		segments.push_back({ 0xFFFF, 0xFFFF });
+
+		const uint16_t segCount = static_cast<uint16_t>(segments.size());
+		size_t glyphs = 0;
+		for (auto& [start, end] : segments)
+			glyphs += end - start + 1;
+		const size_t length = 16 + segCount * 8 + glyphs * 2;
+
+		std::vector<uint8_t> cmap(12 + length);
+		WriteU16BE(&cmap[2], 1);
+		WriteU16BE(&cmap[4], 3);
+		WriteU16BE(&cmap[6], 1);
+		WriteU32BE(&cmap[8], 12);
+
+		uint8_t* sub = &cmap[12];
+		WriteU16BE(sub, 4);
+		WriteU16BE(sub + 2, static_cast<uint16_t>(length));
+		WriteU16BE(sub + 6, segCount * 2);
+		uint8_t* rangeOffsets = sub + 16 + segCount * 6;
+		uint8_t* glyphIds = sub + 16 + segCount * 8;
+		size_t glyph = 0;
+		for (uint16_t i = 0; i < segCount; ++i)
+		{
+			const auto [start, end] = segments[i];
+			WriteU16BE(sub + 14 + i * 2, end);
+			WriteU16BE(sub + 16 + segCount * 2 + i * 2, start);
+			WriteU16BE(rangeOffsets + i * 2, static_cast<uint16_t>(glyphIds + glyph * 2 - (rangeOffsets + i * 2)));
+			for (uint32_t cp = start; cp <= end; ++cp, ++glyph)
+				WriteU16BE(glyphIds + glyph * 2, static_cast<uint16_t>(glyph + 1));
+		}
+		return cmap;
+	}
+
+	void ParseCmap(benchmark::State& state)
+	{
+		const auto cmap = CjkCmap();
+		for (auto _ : state)
+		{
+			CoverageSet coverage;
+			benchmark::DoNotOptimize(ParseCmapCoverage(cmap.data(), cmap.size(), coverage));
+		}
+		state.SetBytesProcessed(state.iterations() * cmap.size());
+	}
+
+	void ContainsCharset(benchmark::State& state)
+	{
+		const auto cmap = CjkCmap();
+		CoverageSet coverage;
+		ParseCmapCoverage(cmap.data(), cmap.size(), coverage);
+		const BYTE charSets[] = { ANSI_CHARSET, SHIFTJIS_CHARSET, HANGUL_CHARSET, GB2312_CHARSET, RUSSIAN_CHARSET };
+		size_t i = 0;
+		for (auto _ : state)
+		{
+			CoverageSet required = CoverageSet::FromText(GetCharsetSample(charSets[i++ % std::size(charSets)]));
+			required.AddText(L"中文 sample text");
+			benchmark::DoNotOptimize(coverage.ContainsAll(required));
+		}
+	}
+
+	// Selection once memoized, the cost paid by every CreateFont of a missing face
+	void SelectMemoized(benchmark::State& state)
+	{
+		const auto cmap = CjkCmap();
+		FontFallbackChain chain;
+		chain.names = { L"A", L"B", L"C", L"D" };
+		chain.sample = L"中文";
+		auto load = [&](const std::wstring&, CoverageSet& coverage) { ParseCmapCoverage(cmap.data(), cmap.size(), coverage); };
+		BYTE charSet = 0;
+		for (auto _ : state)
+			benchmark::DoNotOptimize(chain.SelectForCharset(charSet++, load));
+	}
+}
+
+BENCHMARK(ParseCmap);
+BENCHMARK(ContainsCharset);
+BENCHMARK(SelectMemoized);
@@ -0,0 +1,187 @@
+#include "FakeGdi.hpp"
+#include "Coverage.hpp"
+#include <gtest/gtest.h>
+
+namespace
+{
+	struct Segment
+	{
+		uint16_t start, end;
+	};
+
+	// "cmap" with one format 4 subtable for Windows Unicode BMP, mapping every segment with idDelta
+	std::vector<uint8_t> Format4Cmap(std::vector<Segment> segments)
+	{
+		segments.push_back({ 0xFFFF, 0xFFFF });
+		const uint16_t segCount = static_cast<uint16_t>(segments.size());
+		const size_t length = 16 + segCount * 8;
+		std::vector<uint8_t> cmap(12 + length);
+		WriteU16BE(&cmap[2], 1);
+		WriteU16BE(&cmap[4], 3);
+		WriteU16BE(&cmap[6], 1);
+		WriteU32BE(&cmap[8], 12);
+
+		uint8_t* sub = &cmap[12];
+		WriteU16BE(sub, 4);
+		WriteU16BE(sub + 2, static_cast<uint16_t>(length));
+		WriteU16BE(sub + 6, segCount * 2);
+		for (uint16_t i = 0; i < segCount; ++i)
+		{
+			WriteU16BE(sub + 14 + i * 2, segments[i].end);
+			WriteU16BE(sub + 16 + segCount * 2 + i * 2, segments[i].start);
+			WriteU16BE(sub + 16 + segCount * 4 + i * 2, 1);
+		}
+		return cmap;
+	}
+
+	// "cmap" with one format 12 subtable for Windows Unicode full repertoire
+	std::vector<uint8_t> Format12Cmap(const std::vector<std::pair<uint32_t, uint32_t>>& groups)
+	{
+		std::vector<uint8_t> cmap(12 + 16 + groups.size() * 12);
+		WriteU16BE(&cmap[2], 1);
+		WriteU16BE(&cmap[4], 3);
+		WriteU16BE(&cmap[6], 10);
+		WriteU32BE(&cmap[8], 12);
+
+		uint8_t* sub = &cmap[12];
+		WriteU16BE(sub, 12);
+		WriteU32BE(sub + 4, static_cast<uint32_t>(cmap.size() - 12));
+		WriteU32BE(sub + 12, static_cast<uint32_t>(groups.size()));
+		for (size_t i = 0; i < groups.size(); ++i)
+		{
+			WriteU32BE(sub + 16 + i * 12, groups[i].first);
+			WriteU32BE(sub + 20 + i * 12, groups[i].second);
+			WriteU32BE(sub + 24 + i * 12, 1);
+		}
+		return cmap;
+	}
+}
+
+TEST(Coverage, AddAndContains)
+{
+	CoverageSet set;
+	set.Add(L'A');
+	set.AddRange(0x4E00, 0x9FFF);
+	set.Add(0x1F600);
+
+	EXPECT_TRUE(set.Contains(L'A'));
+	EXPECT_FALSE(set.Contains(L'B'));
+	EXPECT_TRUE(set.Contains(0x4E00));
+	EXPECT_TRUE(set.Contains(0x9FFF));
+	EXPECT_FALSE(set.Contains(0xA000));
+	EXPECT_FALSE(set.Contains(0x1F600));
+}
+
+TEST(Coverage, ContainsAll)
+{
+	CoverageSet font;
+	font.AddRange(0x20, 0x7E);
+	font.AddRange(0x3040, 0x30FF);
+
+	EXPECT_TRUE(font.ContainsAll(CoverageSet::FromText(L"AZaz09")));
+	EXPECT_TRUE(font.ContainsAll(CoverageSet::FromText(L"あいアイ")));
+	EXPECT_FALSE(font.ContainsAll(CoverageSet::FromText(L"あいアイ日本語")));
+	EXPECT_TRUE(font.ContainsAll(CoverageSet()));
+}
+
+TEST(Coverage, TextSkipsSurrogates)
+{
+	CoverageSet set;
+	set.AddText(std::wstring{ L'a', wchar_t(0xD83D), wchar_t(0xDE00), L'b' });
+	EXPECT_TRUE(set.Contains(L'a'));
+	EXPECT_TRUE(set.Contains(L'b'));
+	EXPECT_FALSE(set.Contains(0xD83D));
+	EXPECT_FALSE(set.Contains(0xDE00));
+
+	CoverageSet font;
+	font.AddRange(L'a', L'z');
+	EXPECT_TRUE(font.ContainsAll(set));
+}
+
+TEST(Coverage, ParseFormat4)
+{
+	auto cmap = Format4Cmap({ { 0x20, 0x7E }, { 0x4E00, 0x4E10 } });
+	CoverageSet set;
+	ASSERT_TRUE(ParseCmapCoverage(cmap.data(), cmap.size(), set));
+	EXPECT_TRUE(set.Contains(L' '));
+	EXPECT_TRUE(set.Contains(L'~'));
+	EXPECT_FALSE(set.Contains(0x7F));
+	EXPECT_TRUE(set.Contains(0x4E10));
+	EXPECT_FALSE(set.Contains(0x4E11));
+	EXPECT_FALSE(set.Contains(0xFFFF));
+}
+
+TEST(Coverage, ParseFormat12)
+{
+	auto cmap = Format12Cmap({ { 0x41, 0x5A }, { 0x3000, 0x33FF }, { 0x20000, 0x2A6DF } });
+	CoverageSet set;
+	ASSERT_TRUE(ParseCmapCoverage(cmap.data(), cmap.size(), set));
+	EXPECT_TRUE(set.Contains(L'A'));
+	EXPECT_FALSE(set.Contains(L'a'));
+	EXPECT_TRUE(set.Contains(0x3000));
+	EXPECT_TRUE(set.Contains(0x33FF));
+	EXPECT_FALSE(set.Contains(0x3400));
+}
+
+// Offsets and counts near 4 GB must not wrap around the bounds checks
+TEST(Coverage, RejectsOutOfRangeOffsets)
+{
+	for (uint32_t offset : { 0xFFFFFFFFu, 0xFFFFFFFEu, 0xFFFFFFF0u, 0xFFFFFFF4u })
+	{
+		auto cmap = Format4Cmap({ { 0x20, 0x7E } });
+		WriteU32BE(&cmap[8], offset);
+		CoverageSet set;
+		EXPECT_FALSE(ParseCmapCoverage(cmap.data(), cmap.size(), set)) << offset;
+	}
+
+	auto cmap = Format12Cmap({ { 0x41, 0x5A } });
+	WriteU32BE(&cmap[12 + 12], 0xFFFFFFFF);
+	CoverageSet set;
+	EXPECT_FALSE(ParseCmapCoverage(cmap.data(), cmap.size(), set));
+
+	// Truncated anywhere, never read past the end
+	auto full = Format4Cmap({ { 0x20, 0x7E }, { 0x4E00, 0x4E10 } });
+	for (size_t size = 0; size < full.size(); ++size)
+	{
+		std::vector<uint8_t> truncated(full.begin(), full.begin() + size);
+		CoverageSet partial;
+		ParseCmapCoverage(truncated.data(), truncated.size(), partial);
+	}
+}
+
+TEST(Coverage, ChainSelectsFirstCovering)
+{
+	FontFallbackChain chain;
+	chain.names = { L"Latin", L"Japanese", L"Everything" };
+	int loads = 0;
+	auto load = [&](const std::wstring& name, CoverageSet& coverage) {
+		++loads;
+		coverage.AddRange(0x20, 0x7E);
+		if (name != L"Latin")
+			coverage.AddRange(0x3040, 0x30FF), coverage.AddRange(0x4E00, 0x9FFF);
+		if (name == L"Everything")
+			coverage.AddRange(0xAC00, 0xD7A3);
+	};
+
+	EXPECT_EQ(*chain.SelectForCharset(ANSI_CHARSET, load), L"Latin");
+	EXPECT_EQ(*chain.SelectForCharset(SHIFTJIS_CHARSET, load), L"Japanese");
+	EXPECT_EQ(*chain.SelectForCharset(HANGUL_CHARSET, load), L"Everything");
+	EXPECT_EQ(chain.SelectForCharset(GREEK_CHARSET, load), nullptr);
+	EXPECT_EQ(loads, 3);
+}
+
+TEST(Coverage, ChainRequiresSampleText)
+{
+	FontFallbackChain chain;
+	chain.names = { L"Latin", L"Chinese" };
+	chain.sample = L"中文";
+	auto load = [](const std::wstring& name, CoverageSet& coverage) {
+		coverage.AddRange(0x20, 0x7E);
+		if (name == L"Chinese")
+			coverage.AddRange(0x4E00, 0x9FFF);
+	};
+
+	// The charset alone would pick "Latin"
+	EXPECT_EQ(*chain.SelectForCharset(ANSI_CHARSET, load), L"Chinese");
+	EXPECT_EQ(chain.SelectForCharset(GREEK_CHARSET, load), nullptr);
+}
@@ -0,0 +1,160 @@
+#include "DpiSize.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+namespace
+{
+	// Windows' MulDiv, rounding half away from zero
+	long MulDiv(long a, long b, long c)
+	{
+		return std::lround(double(a) * b / c);
+	}
+
+	ScaledSize Parse(std::string_view text)
+	{
+		ScaledSize size;
+		EXPECT_TRUE(ParseScaledSize(text, size)) << text;
+		return size;
+	}
+}
+
+TEST(DpiSize, ParsesUnits)
+{
+	ScaledSize s = Parse("12");
+	EXPECT_EQ(s.unit, SizeUnit::Pixel);
+	EXPECT_EQ(s.Pixels(), 12);
+	EXPECT_FALSE(s.DpiRelative());
+	EXPECT_EQ(Parse("-12").Pixels(), -12);
+	EXPECT_EQ(Parse("+2").Pixels(), 2);
+
+	s = Parse("9pt");
+	EXPECT_EQ(s.unit, SizeUnit::Point);
+	EXPECT_EQ(s.value, 9);
+	EXPECT_TRUE(s.DpiRelative());
+	EXPECT_EQ(Parse("10.5pt").value, 10.5);
+
+	s = Parse("-12dip");
+	EXPECT_EQ(s.unit, SizeUnit::Dip);
+	EXPECT_EQ(s.value, -12);
+	EXPECT_EQ(Parse("+1.5pt").value, 1.5);
+
+	// Zero is the same at every DPI
+	EXPECT_FALSE(Parse("0pt").DpiRelative());
+}
+
+TEST(DpiSize, RejectsMalformed)
+{
+	for (std::string_view bad : { "", "pt", "dip", "12.5", "9 pt", "9px", "9PT", "1e9pt", "nanpt", "infdip", "12pt ", " 12", "--1", "0x10", "+", "++1", "+-1", "-+1", "+pt" })
+	{
+		ScaledSize s{ 7, SizeUnit::Dip };
+		EXPECT_FALSE(ParseScaledSize(bad, s)) << bad;
+		EXPECT_EQ(s.value, 7) << bad; // Untouched
+	}
+}
+
+// Whole points and DIPs resolve exactly as the MulDiv Windows programs use
+TEST(DpiSize, ResolvesLikeMulDiv)
+{
+	for (uint32_t dpi : { 72u, 96u, 100u, 120u, 144u, 168u, 192u, 240u, 288u })
+	{
+		for (int n = 1; n <= 72; ++n)
+		{
+			const ScaledSize pt = Parse(std::to_string(n) + "pt");
+			EXPECT_EQ(ResolveDpi(pt.HeightPerDpi(), dpi), -MulDiv(n, dpi, 72)) << n << "pt at " << dpi;
+			EXPECT_EQ(ResolveDpi(pt.OffsetPerDpi(), dpi), MulDiv(n, dpi, 72)) << n << "pt at " << dpi;
+
+			EXPECT_EQ(ResolveDpi(Parse(std::to_string(n) + "dip").HeightPerDpi(), dpi), MulDiv(n, dpi, 96)) << n << "dip at " << dpi;
+			EXPECT_EQ(ResolveDpi(Parse("-" + std::to_string(n) + "dip").HeightPerDpi(), dpi), -MulDiv(n, dpi, 96)) << n << "dip at " << dpi;
+		}
+	}
+
+	// Half points, 10.5pt at 96 DPI is 14 pixels
+	EXPECT_EQ(ResolveDpi(Parse("10.5pt").HeightPerDpi(), 96), -14);
+	EXPECT_EQ(ResolveDpi(Parse("9pt").HeightPerDpi(), 144), -18);
+}
+
+TEST(DpiCache, OneLookupPerContext)
+{
+	DpiCache<const void*> cache;
+	int queries = 0;
+	uint32_t dpi = 144;
+	auto query = [&](bool&) { ++queries; return dpi; };
+	const int a = 0, b = 0;
+
+	for (int i = 0; i < 1000; ++i)
+		EXPECT_EQ(cache.Get(&a, i, query), 144u);
+	EXPECT_EQ(queries, 1);
+
+	// A context switch looks it up again
+	dpi = 120;
+	EXPECT_EQ(cache.Get(&b, 0, query), 120u);
+	EXPECT_EQ(queries, 2);
+	EXPECT_EQ(cache.Get(&a, 0, query), 120u);
+	EXPECT_EQ(queries, 3);
+}
+
+TEST(DpiCache, Notifications)
+{
+	DpiCache<int> cache;
+	int queries = 0;
+	uint32_t dpi = 96;
+	auto query = [&](bool&) { ++queries; return dpi; };
+
+	EXPECT_EQ(cache.Get(1, 0, query), 96u);
+	cache.Changed(192); // WM_DPICHANGED carries the new DPI
+	EXPECT_EQ(cache.Get(1, 0, query), 192u);
+	EXPECT_EQ(queries, 1);
+
+	dpi = 120;
+	cache.Changed(0);
+	EXPECT_EQ(cache.Get(1, 0, query), 120u);
+	EXPECT_EQ(queries, 2);
+
+	dpi = 0; // Failed lookups fall back
+	cache.Changed(0);
+	EXPECT_EQ(cache.Get(1, 0, query), DefaultDpi);
+}
+
+// Threads without windows keep the system DPI for a while instead of asking every time,
+// and keep it for good once a window is found
+TEST(DpiCache, ProvisionalLookupsRetryLater)
+{
+	DpiCache<int> cache;
+	int queries = 0;
+	bool hasWindow = false;
+	auto query = [&](bool& final) {
+		++queries;
+		final = hasWindow;
+		return hasWindow ? 144u : 96u;
+	};
+
+	const uint64_t start = 1000000;
+	for (uint64_t t = start; t < start + DpiCache<int>::RetryInterval; t += 10)
+		EXPECT_EQ(cache.Get(1, t, query), 96u);
+	EXPECT_EQ(queries, 1);
+
+	EXPECT_EQ(cache.Get(1, start + DpiCache<int>::RetryInterval, query), 96u);
+	EXPECT_EQ(queries, 2);
+
+	hasWindow = true;
+	EXPECT_EQ(cache.Get(1, start + 2 * DpiCache<int>::RetryInterval, query), 144u);
+	EXPECT_EQ(queries, 3);
+	for (uint64_t t = start; t < start + 100 * DpiCache<int>::RetryInterval; t += 100)
+		EXPECT_EQ(cache.Get(1, t, query), 144u);
+	EXPECT_EQ(queries, 3);
+
+	// A notification makes a provisional value final
+	DpiCache<int> other;
+	hasWindow = false;
+	other.Get(1, 0, query);
+	other.Changed(168);
+	EXPECT_EQ(other.Get(1, 10 * DpiCache<int>::RetryInterval, query), 168u);
+	EXPECT_EQ(queries, 4);
+
+	// A clock at zero still retries
+	DpiCache<int> early;
+	early.Get(1, 0, query);
+	EXPECT_EQ(queries, 5);
+	early.Get(1, DpiCache<int>::RetryInterval, query);
+	EXPECT_EQ(queries, 6);
+}
@@ -0,0 +1,73 @@
+// Compiling and matching a config with hundreds of face name patterns, a match is
+// paid by every CreateFont without an exact "fonts" rule
+
+#include "FakeGdi.hpp"
+#include "FacePattern.hpp"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+	// "Family *" prefixes and anchored regexes, then a few "*Gothic" catch-alls at the end,
+	// like a large shared config. Unanchored starts are what grow the DFA: before a
+	// sticky match they combine with every prefix pattern, so configs keep them last.
+	std::vector<std::wstring> Patterns(size_t count)
+	{
+		static const wchar_t* const words[] = { L"Sans", L"Serif", L"Gothic", L"Mincho", L"Mono", L"UI", L"Text", L"Display", L"Code", L"Hei" };
+		std::vector<std::wstring> patterns;
+		for (size_t i = 0; i < count - std::size(words); ++i)
+		{
+			const std::wstring word = words[i % std::size(words)];
+			const std::wstring family = L"Family" + std::to_wstring(i);
+			switch (i % 3)
+			{
+			case 0:
+				patterns.push_back(family + L" *");
+				break;
+			case 1:
+				patterns.push_back(family + L"?" + word + L"*");
+				break;
+			case 2:
+				patterns.push_back(L"^" + family + L"( " + word + L")?$");
+				break;
+			}
+		}
+		for (auto word : words)
+			patterns.push_back(L"* " + std::wstring(word));
+		return patterns;
+	}
+
+	FacePatternSet Build(size_t count)
+	{
+		FacePatternSet set;
+		std::wstring errMsg;
+		for (const auto& pattern : Patterns(count))
+			set.Add(pattern, errMsg);
+		if (!set.Compile(errMsg))
+			throw std::runtime_error("patterns too complex");
+		return set;
+	}
+
+	void CompilePatterns(benchmark::State& state)
+	{
+		for (auto _ : state)
+			benchmark::DoNotOptimize(Build(state.range(0)));
+	}
+
+	void MatchFaceName(benchmark::State& state)
+	{
+		const auto count = static_cast<size_t>(state.range(0));
+		const auto set = Build(count);
+		const std::wstring names[] = {
+			L"Family" + std::to_wstring(count / 2) + L" Bold",
+			L"Microsoft YaHei UI",
+			L"MS Shell Dlg 2",
+			L"Family" + std::to_wstring(count - 1) + L" Code",
+		};
+		size_t i = 0;
+		for (auto _ : state)
+			benchmark::DoNotOptimize(set.Match(names[i++ % std::size(names)]));
+	}
+}
+
+BENCHMARK(CompilePatterns)->Arg(100)->Arg(300)->Unit(benchmark::kMillisecond);
+BENCHMARK(MatchFaceName)->Arg(100)->Arg(300);
@@ -0,0 +1,101 @@
+#include "FakeGdi.hpp"
+#include "FacePattern.hpp"
+#include <gtest/gtest.h>
+
+namespace
+{
+	FacePatternSet Compile(std::initializer_list<std::wstring_view> keys)
+	{
+		FacePatternSet set;
+		std::wstring errMsg;
+		for (auto key : keys)
+			EXPECT_TRUE(set.Add(key, errMsg)) << testing::PrintToString(std::wstring(key));
+		EXPECT_TRUE(set.Compile(errMsg));
+		EXPECT_EQ(errMsg, L"");
+		return set;
+	}
+}
+
+TEST(FacePattern, IsPattern)
+{
+	EXPECT_TRUE(FacePatternSet::IsPattern(L"MS *"));
+	EXPECT_TRUE(FacePatternSet::IsPattern(L"Arial?"));
+	EXPECT_TRUE(FacePatternSet::IsPattern(L"^Arial$"));
+	EXPECT_FALSE(FacePatternSet::IsPattern(L"Arial"));
+	EXPECT_FALSE(FacePatternSet::IsPattern(L""));
+}
+
+TEST(FacePattern, Wildcards)
+{
+	auto set = Compile({ L"MS *", L"*Gothic", L"Arial?", L"*Mincho*", L"A.(B)" });
+	EXPECT_EQ(set.Match(L"MS Shell Dlg"), 0u);
+	EXPECT_EQ(set.Match(L"MS "), 0u);
+	EXPECT_EQ(set.Match(L"MS"), FacePatternSet::npos);
+	EXPECT_EQ(set.Match(L"Yu Gothic"), 1u);
+	EXPECT_EQ(set.Match(L"Yu Gothic UI"), FacePatternSet::npos);
+	EXPECT_EQ(set.Match(L"Arial1"), 2u);
+	EXPECT_EQ(set.Match(L"Arial"), FacePatternSet::npos);
+	EXPECT_EQ(set.Match(L"MS PMincho Light"), 0u);
+	EXPECT_EQ(set.Match(L"PMincho"), 3u);
+	// Regex characters of wildcards are literal
+	EXPECT_EQ(set.Match(L"A.(B)"), 4u);
+	EXPECT_EQ(set.Match(L"AxB"), FacePatternSet::npos);
+}
+
+TEST(FacePattern, Regex)
+{
+	auto set = Compile({ L"^Arial( Narrow)?$", L"^[A-C]+[^0-9]\\.x$", L"^Segoe UI", L"^(Cambria|Calibri) Math$" });
+	EXPECT_EQ(set.Match(L"Arial"), 0u);
+	EXPECT_EQ(set.Match(L"Arial Narrow"), 0u);
+	EXPECT_EQ(set.Match(L"Arial Black"), FacePatternSet::npos);
+	EXPECT_EQ(set.Match(L"ABCz.x"), 1u);
+	EXPECT_EQ(set.Match(L"ABC1.x"), FacePatternSet::npos);
+	EXPECT_EQ(set.Match(L"ABCzyx"), FacePatternSet::npos);
+	EXPECT_EQ(set.Match(L"Segoe UI Semibold"), 2u);
+	EXPECT_EQ(set.Match(L"Calibri Math"), 3u);
+	EXPECT_EQ(set.Match(L"Cambria Math"), 3u);
+}
+
+TEST(FacePattern, FirstPatternInConfigOrderWins)
+{
+	auto set = Compile({ L"Segoe UI*", L"*", L"^Segoe UI$" });
+	EXPECT_EQ(set.Match(L"Segoe UI"), 0u);
+	EXPECT_EQ(set.Match(L"Segoe UI Light"), 0u);
+	EXPECT_EQ(set.Match(L"Tahoma"), 1u);
+	EXPECT_EQ(set.Match(L""), 1u);
+}
+
+TEST(FacePattern, IgnoresCase)
+{
+	auto set = Compile({ L"ms *", L"^[a-c]RIAL$" });
+	EXPECT_EQ(set.Match(L"MS Sans Serif"), 0u);
+	EXPECT_EQ(set.Match(L"Ms sans serif"), 0u);
+	EXPECT_EQ(set.Match(L"ARIAL"), 1u);
+	EXPECT_EQ(set.Match(L"arial"), 1u);
+}
+
+TEST(FacePattern, InvalidPatternReportsRegexPosition)
+{
+	for (std::wstring_view key : { L"^Arial(", L"^Ari[al", L"^Ari)al", L"^*x", L"^[z-a]", L"^abc\\" })
+	{
+		FacePatternSet set;
+		std::wstring errMsg;
+		EXPECT_FALSE(set.Add(key, errMsg)) << testing::PrintToString(std::wstring(key));
+		EXPECT_NE(errMsg.find(std::wstring(L"\"") + std::wstring(key) + L"\""), errMsg.npos) << testing::PrintToString(errMsg);
+	}
+
+	FacePatternSet set;
+	std::wstring errMsg;
+	EXPECT_FALSE(set.Add(L"^Arial)", errMsg));
+	EXPECT_EQ(errMsg, L"Invalid font name pattern \"^Arial)\" at 6.\n");
+}
+
+TEST(FacePattern, TooComplex)
+{
+	// Classic exponential blow up of ".*a.{n}"
+	FacePatternSet set;
+	std::wstring errMsg;
+	ASSERT_TRUE(set.Add(L"^.*a..............$", errMsg));
+	EXPECT_FALSE(set.Compile(errMsg));
+	EXPECT_NE(errMsg.find(L"too complex"), errMsg.npos);
+}
@@ -0,0 +1,466 @@
+#pragma once
+
+// Win32 types and a fake GDI, so FontMod's headers that don't call Windows directly
+// can be built, tested and benchmarked on other platforms. Fonts and DCs are plain
+// objects, widths come from a made up font model, and each call can spin for "callCost"
+// iterations to stand in for the kernel transition of real GDI.
+//
+// Included first by tests of headers that use Win32 types, in place of pch.h. Like FontMod.cpp, it also provides
+// what the headers expect from the rest of FontMod: FormatToFile and liveStats.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if __has_include(<format>)
+#include <format>
+#else
+// libstdc++ 12 has no <format>, fmt has the same interface
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+namespace std
+{
+	using fmt::format;
+	using fmt::make_format_args;
+	using fmt::vformat;
+}
+#endif
+
+#include "StatsLayout.hpp"
+#include "Utf.hpp"
+
+namespace fs = std::filesystem;
+
+// Types and constants, values as in the Windows SDK
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned long DWORD;
+typedef long LONG; // 64 bit on LP64 platforms, which only changes the size of LOGFONTW
+typedef unsigned long ULONG;
+typedef int INT;
+typedef unsigned int UINT;
+typedef wchar_t WCHAR; // 32 bit outside Windows, code units above 0xFFFF aren't used
+typedef const WCHAR* LPCWSTR;
+typedef WCHAR* LPWSTR;
+typedef INT* LPINT;
+typedef void* HANDLE;
+typedef void* HGDIOBJ;
+typedef void* HMODULE;
+
+typedef struct HDC__* HDC;
+typedef struct HFONT__* HFONT;
+
+#define TRUE 1
+#define FALSE 0
+#define GDI_ERROR 0xFFFFFFFF
+#define LF_FACESIZE 32
+
+#define ANSI_CHARSET 0
+#define DEFAULT_CHARSET 1
+#define SYMBOL_CHARSET 2
+#define SHIFTJIS_CHARSET 128
+#define HANGUL_CHARSET 129
+#define GB2312_CHARSET 134
+#define CHINESEBIG5_CHARSET 136
+#define OEM_CHARSET 255
+#define JOHAB_CHARSET 130
+#define HEBREW_CHARSET 177
+#define ARABIC_CHARSET 178
+#define GREEK_CHARSET 161
+#define TURKISH_CHARSET 162
+#define VIETNAMESE_CHARSET 163
+#define THAI_CHARSET 222
+#define EASTEUROPE_CHARSET 238
+#define RUSSIAN_CHARSET 204
+#define MAC_CHARSET 77
+#define BALTIC_CHARSET 186
+
+#define FW_NORMAL 400
+#define FW_BOLD 700
+
+#define MM_TEXT 1
+#define MM_ISOTROPIC 7
+#define MM_ANISOTROPIC 8
+#define GM_COMPATIBLE 1
+#define GM_ADVANCED 2
+#define TECHNOLOGY 2
+#define LOGPIXELSY 90
+#define DT_RASPRINTER 2
+#define DT_RASDISPLAY 1
+#define OBJ_FONT 6
+
+#define MAX_PATH 260
+#define GENERIC_WRITE 0x40000000
+#define FILE_SHARE_READ 1
+#define CREATE_ALWAYS 2
+#define FILE_ATTRIBUTE_NORMAL 0x80
+
+struct SIZE
+{
+	LONG cx;
+	LONG cy;
+};
+typedef SIZE* LPSIZE;
+
+struct ABC
+{
+	int abcA;
+	UINT abcB;
+	int abcC;
+};
+typedef ABC* LPABC;
+
+struct LOGFONTW
+{
+	LONG lfHeight;
+	LONG lfWidth;
+	LONG lfEscapement;
+	LONG lfOrientation;
+	LONG lfWeight;
+	BYTE lfItalic;
+	BYTE lfUnderline;
+	BYTE lfStrikeOut;
+	BYTE lfCharSet;
+	BYTE lfOutPrecision;
+	BYTE lfClipPrecision;
+	BYTE lfQuality;
+	BYTE lfPitchAndFamily;
+	WCHAR lfFaceName[LF_FACESIZE];
+};
+
+#define DEFINE_ENUM_FLAG_OPERATORS(T) \
+	constexpr T operator|(T a, T b) { return static_cast<T>(static_cast<std::underlying_type_t<T>>(a) | static_cast<std::underlying_type_t<T>>(b)); } \
+	constexpr T operator&(T a, T b) { return static_cast<T>(static_cast<std::underlying_type_t<T>>(a) & static_cast<std::underlying_type_t<T>>(b)); } \
+	constexpr T& operator|=(T& a, T b) { return a = a | b; }
+
+// Fake GDI objects
+
+struct HFONT__
+{
+	LOGFONTW lf;
+};
+
+struct HDC__
+{
+	HFONT font = nullptr;
+	int mapMode = MM_TEXT;
+	int graphicsMode = GM_COMPATIBLE;
+	int technology = DT_RASDISPLAY;
+	int dpi = 96;
+	int charExtra = 0;
+};
+
+struct FakeGdi
+{
+	// Spin iterations per call, 0 in tests
+	std::atomic<uint32_t> callCost = 0;
+	// Calls that reached the fake GDI, to check what caches saved
+	std::atomic<uint64_t> calls = 0;
+
+	void Call()
+	{
+		calls.fetch_add(1, std::memory_order_relaxed);
+		for (uint32_t i = callCost.load(std::memory_order_relaxed); i; --i)
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+	}
+
+	// Advance of a character in a font: half or full em by script, a little per code
+	// point so blocks differ, one more for bold
+	static int Advance(const LOGFONTW& lf, UINT ch)
+	{
+		const int em = lf.lfHeight ? static_cast<int>(std::abs(lf.lfHeight)) : 16;
+		return (ch < 0x2E80 ? em / 2 : em) + static_cast<int>(ch % 3) + (lf.lfWeight >= FW_BOLD);
+	}
+};
+
+inline FakeGdi fakeGdi;
+
+inline HFONT CreateFontIndirectW(const LOGFONTW* lf)
+{
+	fakeGdi.Call();
+	return new HFONT__{ *lf };
+}
+
+inline BOOL DeleteObject(HGDIOBJ obj)
+{
+	fakeGdi.Call();
+	delete static_cast<HFONT>(obj);
+	return obj != nullptr;
+}
+
+inline HDC CreateCompatibleDC(HDC)
+{
+	fakeGdi.Call();
+	return new HDC__;
+}
+
+inline BOOL DeleteDC(HDC hdc)
+{
+	fakeGdi.Call();
+	delete hdc;
+	return hdc != nullptr;
+}
+
+inline HGDIOBJ SelectObject(HDC hdc, HGDIOBJ obj)
+{
+	fakeGdi.Call();
+	return std::exchange(hdc->font, static_cast<HFONT>(obj));
+}
+
+inline HGDIOBJ GetCurrentObject(HDC hdc, UINT type)
+{
+	return type == OBJ_FONT ? hdc->font : nullptr;
+}
+
+inline int GetMapMode(HDC hdc)
+{
+	return hdc->mapMode;
+}
+
+inline int GetGraphicsMode(HDC hdc)
+{
+	return hdc->graphicsMode;
+}
+
+inline int GetTextCharacterExtra(HDC hdc)
+{
+	return hdc->charExtra;
+}
+
+inline int GetDeviceCaps(HDC hdc, int index)
+{
+	return index == TECHNOLOGY ? hdc->technology : index == LOGPIXELSY ? hdc->dpi : 0;
+}
+
+inline BOOL GetCharWidth32W(HDC hdc, UINT first, UINT last, LPINT buffer)
+{
+	fakeGdi.Call();
+	if (!hdc->font || first > last)
+		return FALSE;
+	for (UINT ch = first; ch <= last; ++ch)
+		buffer[ch - first] = FakeGdi::Advance(hdc->font->lf, ch);
+	return TRUE;
+}
+
+inline BOOL GetCharABCWidthsW(HDC hdc, UINT first, UINT last, LPABC buffer)
+{
+	fakeGdi.Call();
+	if (!hdc->font || first > last)
+		return FALSE;
+	for (UINT ch = first; ch <= last; ++ch)
+		buffer[ch - first] = { 1, static_cast<UINT>(FakeGdi::Advance(hdc->font->lf, ch) - 2), 1 };
+	return TRUE;
+}
+
+inline BOOL GetTextExtentExPointW(HDC hdc, LPCWSTR text, int count, int maxExtent, LPINT fit, LPINT dx, LPSIZE size)
+{
+	fakeGdi.Call();
+	if (!hdc->font || count < 0)
+		return FALSE;
+	LONG cx = 0;
+	int fitted = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		cx += FakeGdi::Advance(hdc->font->lf, static_cast<UINT>(text[i]));
+		if (cx <= maxExtent)
+			fitted = i + 1;
+		if (dx)
+			dx[i] = static_cast<int>(cx);
+	}
+	if (fit)
+		*fit = fitted;
+	size->cx = cx;
+	size->cy = hdc->font->lf.lfHeight ? std::abs(hdc->font->lf.lfHeight) : 16;
+	return TRUE;
+}
+
+inline BOOL GetTextExtentPoint32W(HDC hdc, LPCWSTR text, int count, LPSIZE size)
+{
+	return GetTextExtentExPointW(hdc, text, count, 0, nullptr, nullptr, size);
+}
+
+// GDI+ flat API used by the font hooks. Families and fonts are plain objects too, any
+// family name exists.
+
+typedef float REAL;
+enum GpStatus
+{
+	Ok = 0,
+	InvalidParameter = 2
+};
+
+struct GpFontFamily
+{
+	std::wstring name;
+};
+
+struct GpFont
+{
+	std::wstring family;
+	REAL emSize;
+	INT style;
+	int unit;
+};
+
+inline GpStatus GdipCreateFontFamilyFromName(const WCHAR* name, void* /* fontCollection */, GpFontFamily** fontFamily)
+{
+	fakeGdi.Call();
+	if (!name || !fontFamily)
+		return InvalidParameter;
+	*fontFamily = new GpFontFamily{ name };
+	return Ok;
+}
+
+inline GpStatus GdipGetFamilyName(const GpFontFamily* fontFamily, WCHAR* name, WORD /* language */)
+{
+	fakeGdi.Call();
+	if (!fontFamily || !name)
+		return InvalidParameter;
+	const size_t length = std::min(fontFamily->name.size(), size_t(LF_FACESIZE - 1));
+	std::copy_n(fontFamily->name.c_str(), length, name);
+	name[length] = 0;
+	return Ok;
+}
+
+inline GpStatus GdipCreateFont(const GpFontFamily* fontFamily, REAL emSize, INT style, int unit, GpFont** font)
+{
+	fakeGdi.Call();
+	if (!fontFamily || !font)
+		return InvalidParameter;
+	*font = new GpFont{ fontFamily->name, emSize, style, unit };
+	return Ok;
+}
+
+inline GpStatus GdipDeleteFont(GpFont* font)
+{
+	delete font;
+	return Ok;
+}
+
+inline GpStatus GdipDeleteFontFamily(GpFontFamily* fontFamily)
+{
+	delete fontFamily;
+	return Ok;
+}
+
+// Case mapping of the C library, which is enough for the ASCII names tests use
+inline DWORD CharLowerBuffW(LPWSTR text, DWORD length)
+{
+	for (DWORD i = 0; i < length; ++i)
+		text[i] = static_cast<WCHAR>(std::towlower(text[i]));
+	return length;
+}
+
+// Files are strings in memory, by path. Reports written with CreateFileW and FormatToFile
+// can be read back from here.
+inline std::unordered_map<std::string, std::string> fakeFiles;
+
+// Takes a path, as callers pass fs::path::c_str() which is narrow outside Windows
+inline HANDLE CreateFileW(const fs::path& path, DWORD, DWORD, void*, DWORD, DWORD, HANDLE)
+{
+	std::string& file = fakeFiles[path.string()];
+	file.clear();
+	return &file;
+}
+
+// No modules have paths
+inline DWORD GetModuleFileNameW(HMODULE, LPWSTR, DWORD)
+{
+	return 0;
+}
+
+namespace wil
+{
+	// Fake files don't need closing
+	struct unique_hfile
+	{
+		explicit unique_hfile(HANDLE h) : h(h)
+		{
+		}
+
+		HANDLE get() const
+		{
+			return h;
+		}
+
+		explicit operator bool() const
+		{
+			return h != nullptr;
+		}
+
+		HANDLE h;
+	};
+}
+
+// The rest of FontMod
+
+// As in Util.hpp, for arrays of WCHAR the template can't deduce from. WCHAR is 32 bit
+// here, the units are narrowed first.
+inline bool Utf16ToUtf8(std::wstring_view utf16, std::string& utf8)
+{
+	const std::u16string units(utf16.begin(), utf16.end());
+	return Utf16ToUtf8(std::u16string_view(units), utf8);
+}
+
+// fs::path::native(), already narrow outside Windows
+inline bool Utf16ToUtf8(const std::string& native, std::string& utf8)
+{
+	utf8 = native;
+	return true;
+}
+
+// Bytes written by FormatToFile are added here when set (live stats)
+inline std::atomic<uint64_t>* formatToFileBytes = nullptr;
+
+// Reports are appended to the std::string passed as the handle
+template <class... Types>
+void FormatToFile(HANDLE hFile, const std::string_view fmt, const Types&... args)
+{
+	const std::string text = std::vformat(fmt, std::make_format_args(args...));
+	if (formatToFileBytes)
+		formatToFileBytes->fetch_add(text.size(), std::memory_order_relaxed);
+	if (hFile)
+		static_cast<std::string*>(hFile)->append(text);
+}
+
+// LiveStats.hpp without the shared memory, counters stay in the process
+struct FakeLiveStats
+{
+	void Add(LiveCounter counter, uint64_t n = 1)
+	{
+		counters[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+	}
+
+	void AddCall(HookId id)
+	{
+		hookCalls[static_cast<size_t>(id)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	uint64_t Get(LiveCounter counter) const
+	{
+		return counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+	}
+
+	std::array<std::atomic<uint64_t>, LiveStatsBlock::HookCount> hookCalls = {};
+	std::array<std::atomic<uint64_t>, LiveStatsBlock::CounterCount> counters = {};
+};
+
+inline FakeLiveStats liveStats;
@@ -0,0 +1,116 @@
+#include "FakeGdi.hpp"
+#include "FontConditions.hpp"
+#include <gtest/gtest.h>
+
+namespace
+{
+	LOGFONTW Font(long height, long weight = FW_NORMAL, BYTE charSet = DEFAULT_CHARSET)
+	{
+		LOGFONTW lf = {};
+		lf.lfHeight = height;
+		lf.lfWeight = weight;
+		lf.lfCharSet = charSet;
+		return lf;
+	}
+
+	FontCondition Heights(long min, long max)
+	{
+		FontCondition c;
+		c.heightMin = min;
+		c.heightMax = max;
+		return c;
+	}
+
+	// Value of the variant found, 0 for none
+	int Find(const ConditionalRules<int>& rules, const LOGFONTW& lf, uint32_t module = UINT32_MAX)
+	{
+		const int* found = rules.Find(lf, module);
+		return found ? *found : 0;
+	}
+}
+
+TEST(FontConditions, HeightIsAbsolute)
+{
+	ConditionalRules<int> rules;
+	rules.Add(Heights(0, 14), 1);
+	rules.Add(Heights(15, 100), 2);
+	rules.Compile();
+
+	EXPECT_EQ(Find(rules, Font(12)), 1);
+	EXPECT_EQ(Find(rules, Font(-12)), 1);
+	EXPECT_EQ(Find(rules, Font(14)), 1);
+	EXPECT_EQ(Find(rules, Font(-15)), 2);
+	EXPECT_EQ(Find(rules, Font(100)), 2);
+	EXPECT_EQ(Find(rules, Font(101)), 0);
+}
+
+TEST(FontConditions, ExtremeHeights)
+{
+	ConditionalRules<int> rules;
+	rules.Add(Heights(1000, LONG_MAX), 1);
+	rules.Add(FontCondition(), 2);
+	rules.Compile();
+
+	EXPECT_EQ(Find(rules, Font(LONG_MIN)), 1);
+	EXPECT_EQ(Find(rules, Font(LONG_MAX)), 1);
+	EXPECT_EQ(Find(rules, Font(-LONG_MAX)), 1);
+	EXPECT_EQ(Find(rules, Font(0)), 2);
+}
+
+// Variants added first win where they overlap, whatever the order of their ranges
+TEST(FontConditions, OverlappingPriority)
+{
+	ConditionalRules<int> rules;
+	rules.Add(Heights(10, 20), 1);
+	rules.Add(Heights(0, 30), 2);
+	rules.Add(Heights(15, 40), 3);
+	rules.Add(FontCondition(), 4);
+	rules.Compile();
+
+	EXPECT_EQ(Find(rules, Font(5)), 2);
+	EXPECT_EQ(Find(rules, Font(10)), 1);
+	EXPECT_EQ(Find(rules, Font(15)), 1);
+	EXPECT_EQ(Find(rules, Font(20)), 1);
+	EXPECT_EQ(Find(rules, Font(21)), 2);
+	EXPECT_EQ(Find(rules, Font(30)), 2);
+	EXPECT_EQ(Find(rules, Font(31)), 3);
+	EXPECT_EQ(Find(rules, Font(40)), 3);
+	EXPECT_EQ(Find(rules, Font(41)), 4);
+}
+
+// A higher priority variant that fails on weight or charset lets the next one match
+TEST(FontConditions, OverlappingWeightAndCharset)
+{
+	FontCondition bold = Heights(0, 20);
+	bold.weightMin = 600;
+	FontCondition japanese = Heights(0, 20);
+	japanese.charsets.reset();
+	japanese.charsets.set(SHIFTJIS_CHARSET);
+
+	ConditionalRules<int> rules;
+	rules.Add(std::move(bold), 1);
+	rules.Add(std::move(japanese), 2);
+	rules.Add(Heights(0, 20), 3);
+	rules.Compile();
+
+	EXPECT_EQ(Find(rules, Font(12, FW_BOLD, SHIFTJIS_CHARSET)), 1);
+	EXPECT_EQ(Find(rules, Font(12, FW_NORMAL, SHIFTJIS_CHARSET)), 2);
+	EXPECT_EQ(Find(rules, Font(12, FW_NORMAL, ANSI_CHARSET)), 3);
+	EXPECT_EQ(Find(rules, Font(21, FW_BOLD, SHIFTJIS_CHARSET)), 0);
+}
+
+TEST(FontConditions, Modules)
+{
+	FontCondition qt;
+	qt.modules = { 7 };
+
+	ConditionalRules<int> rules;
+	rules.Add(std::move(qt), 1);
+	rules.Add(FontCondition(), 2);
+	rules.Compile();
+
+	EXPECT_TRUE(rules.HasModuleConditions());
+	EXPECT_EQ(Find(rules, Font(12), 7), 1);
+	EXPECT_EQ(Find(rules, Font(12), 8), 2);
+	EXPECT_EQ(Find(rules, Font(12)), 2);
+}
@@ -0,0 +1,108 @@
+#include "FakeGdi.hpp"
+#include "FontHandleStats.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+
+namespace
+{
+	struct Totals
+	{
+		unsigned long long created = 0, deleted = 0, live = 0, peakLive = 0, signatures = 0;
+	};
+
+	Totals Report(FontHandleStats& stats, const fs::path& path)
+	{
+		stats.WriteReport(false);
+		Totals t;
+		EXPECT_EQ(sscanf(fakeFiles[path.string()].c_str(), "[FontHandles] created = %llu, deleted = %llu, live = %llu, peak live = %llu, signatures = %llu",
+			&t.created, &t.deleted, &t.live, &t.peakLive, &t.signatures), 5);
+		return t;
+	}
+
+	LOGFONTW Font(const WCHAR* face, LONG height)
+	{
+		LOGFONTW lf = {};
+		lf.lfHeight = height;
+		lf.lfWeight = FW_NORMAL;
+		wcscpy(lf.lfFaceName, face);
+		return lf;
+	}
+
+	HFONT Handle(uintptr_t value)
+	{
+		return reinterpret_cast<HFONT>(value);
+	}
+}
+
+TEST(FontHandleStats, CountsCreatedAndDeleted)
+{
+	FontHandleStats stats;
+	stats.Enable("handles.txt");
+	const LOGFONTW segoe = Font(L"Segoe UI", -12), yahei = Font(L"Microsoft YaHei", -12);
+	for (uintptr_t h = 0x100; h < 0x110; ++h)
+		stats.Created(Handle(h), h % 2 ? segoe : yahei, nullptr);
+	for (uintptr_t h = 0x100; h < 0x108; ++h)
+		stats.Deleted(Handle(h));
+	stats.Deleted(Handle(0x999)); // Not created through the hooks
+
+	const Totals t = Report(stats, "handles.txt");
+	EXPECT_EQ(t.created, 16u);
+	EXPECT_EQ(t.deleted, 8u);
+	EXPECT_EQ(t.live, 8u);
+	EXPECT_EQ(t.peakLive, 16u);
+	EXPECT_EQ(t.signatures, 2u);
+	EXPECT_NE(fakeFiles["handles.txt"].find("live = 4, created = 8, name = \"Segoe UI\", height = -12"), std::string::npos);
+}
+
+// A handle value seen again without our DeleteObject hook (deleted by a path we don't
+// hook) counts the earlier font as deleted, in its signature and in the total
+TEST(FontHandleStats, ReusedHandleCountsAsDeleted)
+{
+	FontHandleStats stats;
+	stats.Enable("reused.txt");
+	const LOGFONTW segoe = Font(L"Segoe UI", -12), yahei = Font(L"Microsoft YaHei", -16);
+	stats.Created(Handle(0x200), segoe, nullptr);
+	stats.Created(Handle(0x200), yahei, nullptr);
+	stats.Created(Handle(0x200), yahei, nullptr);
+
+	const Totals t = Report(stats, "reused.txt");
+	EXPECT_EQ(t.created, 3u);
+	EXPECT_EQ(t.deleted, 2u);
+	EXPECT_EQ(t.live, 1u);
+	EXPECT_EQ(t.created - t.deleted, t.live);
+	const std::string& report = fakeFiles["reused.txt"];
+	EXPECT_EQ(report.find("Segoe UI"), std::string::npos);
+	EXPECT_NE(report.find("live = 1, created = 2, name = \"Microsoft YaHei\""), std::string::npos);
+}
+
+// Totals stay consistent through growth, tombstones and reuse
+TEST(FontHandleStats, TotalsMatchLiveHandles)
+{
+	FontHandleStats stats;
+	stats.Enable("random.txt");
+	const LOGFONTW lf = Font(L"Segoe UI", -12);
+	std::vector<bool> alive(4096);
+	size_t live = 0;
+	uint32_t x = 1;
+	for (int i = 0; i < 200000; ++i)
+	{
+		x = x * 1664525 + 1013904223;
+		const size_t h = (x >> 8) % alive.size();
+		if ((x >> 4) % 3)
+		{
+			stats.Created(Handle(h + 1), lf, nullptr);
+			live += !alive[h];
+			alive[h] = true;
+		}
+		else
+		{
+			stats.Deleted(Handle(h + 1));
+			live -= alive[h];
+			alive[h] = false;
+		}
+	}
+
+	const Totals t = Report(stats, "random.txt");
+	EXPECT_EQ(t.live, live);
+	EXPECT_EQ(t.created - t.deleted, t.live);
+}
@@ -0,0 +1,188 @@
+#include "FakeGdi.hpp"
+#include "FontInfo.hpp"
+#include <gtest/gtest.h>
+
+namespace
+{
+	FontInfo Rule(std::wstring name)
+	{
+		FontInfo info;
+		info.name = std::move(name);
+		CompileOverride(info);
+		return info;
+	}
+
+	FontInfo Variants(std::vector<std::pair<FontCondition, std::wstring>> variants)
+	{
+		auto rules = std::make_shared<ConditionalRules<FontInfo>>();
+		for (auto& [condition, name] : variants)
+			rules->Add(condition, Rule(name));
+		rules->Compile();
+		FontInfo info;
+		info.variants = std::move(rules);
+		return info;
+	}
+
+	FontCondition Heights(long min, long max)
+	{
+		FontCondition c;
+		c.heightMin = min;
+		c.heightMax = max;
+		return c;
+	}
+
+	// MatchFontRule lookups over plain maps
+	struct TestRules
+	{
+		std::unordered_map<std::wstring, FontInfo> fonts;
+		std::vector<std::wstring> installed;
+		std::vector<std::wstring> chain;
+		bool chainCovers = true; // Whether the chain has a font for the charset
+		uint32_t module = UINT32_MAX;
+
+		const FontInfo* All() const { return Find(L"FontAll"); }
+		const FontInfo* Face(const WCHAR* face) const { return Find(face); }
+		const FontInfo* Fallback() const { return Find(L"FontFallback"); }
+		bool HasFallbackChain() const { return !chain.empty(); }
+		bool FaceExists(const WCHAR* face) const { return std::find(installed.begin(), installed.end(), face) != installed.end(); }
+		const std::wstring* SelectFallback(BYTE) const { return chainCovers ? &chain.front() : nullptr; }
+		uint32_t CallerModule() const { return module; }
+
+		const FontInfo* Find(const std::wstring& key) const
+		{
+			auto it = fonts.find(key);
+			return it != fonts.end() ? &it->second : nullptr;
+		}
+	};
+
+	LOGFONTW Font(const wchar_t* face, long height = -12)
+	{
+		LOGFONTW lf = {};
+		lf.lfHeight = height;
+		lf.lfWeight = FW_NORMAL;
+		wcscpy(lf.lfFaceName, face);
+		return lf;
+	}
+
+	std::wstring Name(const FontRuleMatch& match)
+	{
+		return match.info ? match.info->name : L"(none)";
+	}
+}
+
+TEST(FontInfo, FaceRule)
+{
+	TestRules rules;
+	rules.fonts.emplace(L"Tahoma", Rule(L"Segoe UI"));
+	rules.installed = { L"Tahoma" };
+
+	auto match = MatchFontRule(Font(L"Tahoma"), rules);
+	EXPECT_EQ(Name(match), L"Segoe UI");
+	EXPECT_FALSE(match.isFallback);
+	EXPECT_EQ(MatchFontRule(Font(L"Arial"), rules).info, nullptr);
+}
+
+TEST(FontInfo, FontAllReplacesFaceRules)
+{
+	TestRules rules;
+	rules.fonts.emplace(L"Tahoma", Rule(L"Segoe UI"));
+	rules.fonts.emplace(L"FontAll", Rule(L"Microsoft YaHei"));
+	EXPECT_EQ(Name(MatchFontRule(Font(L"Tahoma"), rules)), L"Microsoft YaHei");
+}
+
+TEST(FontInfo, VariantIsResolved)
+{
+	TestRules rules;
+	rules.fonts.emplace(L"Tahoma", Variants({ { Heights(0, 14), L"Small" }, { Heights(15, 100), L"Large" } }));
+	rules.installed = { L"Tahoma" };
+
+	EXPECT_EQ(Name(MatchFontRule(Font(L"Tahoma", -12), rules)), L"Small");
+	EXPECT_EQ(Name(MatchFontRule(Font(L"Tahoma", 20), rules)), L"Large");
+	// Installed face, no variant matches, no fallback
+	EXPECT_EQ(MatchFontRule(Font(L"Tahoma", 200), rules).info, nullptr);
+}
+
+TEST(FontInfo, ModuleIsOnlyAskedForWhenNeeded)
+{
+	struct CountingRules : TestRules
+	{
+		uint32_t CallerModule()
+		{
+			++asked;
+			return module;
+		}
+		int asked = 0;
+	} rules;
+
+	FontCondition qt;
+	qt.modules = { 3 };
+	rules.fonts.emplace(L"Tahoma", Variants({ { qt, L"Qt" }, { FontCondition(), L"Other" } }));
+	rules.fonts.emplace(L"Arial", Variants({ { Heights(0, 100), L"Arial" } }));
+
+	rules.module = 3;
+	EXPECT_EQ(Name(MatchFontRule(Font(L"Tahoma"), rules)), L"Qt");
+	rules.module = 4;
+	EXPECT_EQ(Name(MatchFontRule(Font(L"Tahoma"), rules)), L"Other");
+	EXPECT_EQ(rules.asked, 2);
+	MatchFontRule(Font(L"Arial"), rules);
+	EXPECT_EQ(rules.asked, 2);
+}
+
+TEST(FontInfo, MissingFaceFallsBack)
+{
+	TestRules rules;
+	rules.fonts.emplace(L"FontFallback", Rule(L"Fallback"));
+	rules.installed = { L"Tahoma" };
+
+	auto match = MatchFontRule(Font(L"Missing"), rules);
+	EXPECT_EQ(Name(match), L"Fallback");
+	EXPECT_TRUE(match.isFallback);
+	EXPECT_EQ(match.fallbackName, nullptr);
+	EXPECT_EQ(MatchFontRule(Font(L"Tahoma"), rules).info, nullptr);
+}
+
+// A rule whose variants don't match is no reason to skip the fallback of a missing face
+TEST(FontInfo, UnmatchedVariantsFallBack)
+{
+	TestRules rules;
+	rules.fonts.emplace(L"Missing", Variants({ { Heights(0, 14), L"Small" } }));
+	rules.fonts.emplace(L"FontFallback", Rule(L"Fallback"));
+
+	EXPECT_EQ(Name(MatchFontRule(Font(L"Missing", 12), rules)), L"Small");
+	auto match = MatchFontRule(Font(L"Missing", 40), rules);
+	EXPECT_EQ(Name(match), L"Fallback");
+	EXPECT_TRUE(match.isFallback);
+}
+
+TEST(FontInfo, FallbackChain)
+{
+	TestRules rules;
+	rules.chain = { L"Chained" };
+
+	// Chain only, the rule applied is empty and the name comes from the chain
+	auto match = MatchFontRule(Font(L"Missing"), rules);
+	ASSERT_NE(match.info, nullptr);
+	EXPECT_EQ(match.info->name, L"");
+	ASSERT_NE(match.fallbackName, nullptr);
+	EXPECT_EQ(*match.fallbackName, L"Chained");
+	EXPECT_TRUE(match.isFallback);
+
+	// With "FontFallback", its style and the chain's name
+	rules.fonts.emplace(L"FontFallback", Variants({ { Heights(0, 14), L"Fallback" } }));
+	match = MatchFontRule(Font(L"Missing", 12), rules);
+	EXPECT_EQ(Name(match), L"Fallback");
+	EXPECT_EQ(*match.fallbackName, L"Chained");
+
+	// "FontFallback" variants don't match, still the chain's name
+	match = MatchFontRule(Font(L"Missing", 40), rules);
+	EXPECT_EQ(Name(match), L"");
+	EXPECT_EQ(*match.fallbackName, L"Chained");
+
+	// Nothing in the chain covers the charset
+	rules.chainCovers = false;
+	match = MatchFontRule(Font(L"Missing", 12), rules);
+	EXPECT_EQ(Name(match), L"Fallback");
+	EXPECT_EQ(match.fallbackName, nullptr);
+	rules.fonts.clear();
+	EXPECT_EQ(MatchFontRule(Font(L"Missing"), rules).info, nullptr);
+}
@@ -0,0 +1,153 @@
+#include "FontProfile.hpp"
+#include <gtest/gtest.h>
+
+namespace
+{
+	FontProfileEntry Entry(std::string face, uint32_t uses, int32_t height = -12)
+	{
+		FontProfileEntry e;
+		e.face = std::move(face);
+		e.uses = uses;
+		e.height = height;
+		e.weight = 400;
+		e.charSet = 1;
+		e.quality = 5;
+		return e;
+	}
+
+	std::vector<std::string> Faces(const std::vector<FontProfileEntry>& entries)
+	{
+		std::vector<std::string> faces;
+		for (const auto& e : entries)
+			faces.push_back(e.face + " " + std::to_string(e.uses));
+		return faces;
+	}
+}
+
+TEST(FontProfile, RoundTrips)
+{
+	FontProfileEntry full = Entry("Microsoft YaHei UI", 7, -16);
+	full.width = -3;
+	full.escapement = 900;
+	full.orientation = -900;
+	full.weight = 700;
+	full.italic = 1;
+	full.underline = 1;
+	full.strikeOut = 1;
+	full.charSet = 255;
+	full.outPrecision = 3;
+	full.clipPrecision = 2;
+	full.quality = 6;
+	full.pitchAndFamily = 0x22;
+	const std::vector<FontProfileEntry> entries = { full, Entry("Segoe UI", UINT32_MAX), Entry("\xE5\xBE\xAE\xE8\xBD\xAF\xE9\x9B\x85\xE9\xBB\x91", 1, INT32_MIN) };
+
+	const std::string text = SerializeFontProfile(entries);
+	EXPECT_TRUE(text.starts_with("FontModProfile 1\r\n7 -16 -3 900 -900 700 1 1 1 255 3 2 6 34 Microsoft YaHei UI\r\n"));
+
+	std::vector<FontProfileEntry> parsed;
+	ASSERT_TRUE(ParseFontProfile(text, parsed));
+	ASSERT_EQ(parsed.size(), entries.size());
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		EXPECT_TRUE(parsed[i].SameFont(entries[i])) << i;
+		EXPECT_EQ(parsed[i].uses, entries[i].uses) << i;
+	}
+}
+
+TEST(FontProfile, RejectsOtherHeaders)
+{
+	std::vector<FontProfileEntry> parsed;
+	EXPECT_FALSE(ParseFontProfile("", parsed));
+	EXPECT_FALSE(ParseFontProfile("FontModProfile 2\n1 -12 0 0 0 400 0 0 0 1 0 0 5 0 Segoe UI\n", parsed));
+	EXPECT_FALSE(ParseFontProfile("\xEF\xBB\xBF" "FontModProfile 1\n", parsed));
+	EXPECT_TRUE(parsed.empty());
+
+	EXPECT_TRUE(ParseFontProfile("FontModProfile 1", parsed));
+	EXPECT_TRUE(ParseFontProfile("FontModProfile 1\n", parsed));
+	EXPECT_TRUE(parsed.empty());
+}
+
+// A damaged profile only loses its damaged lines. LF line ends are read too.
+TEST(FontProfile, SkipsBadLines)
+{
+	const std::string_view text =
+		"FontModProfile 1\n"
+		"3 -12 0 0 0 400 0 0 0 1 0 0 5 0 Segoe UI\n"
+		"3 -12 0 0 0 400 0 0 0 1 0 0 5 0\n" // No face
+		"3 -12 0 0 0 400 0 0 0 1 0 0 5 0 \n" // Empty face
+		"3 -12 0 0 0 400 0 0 0 256 0 0 5 0 Arial\n" // Byte out of range
+		"-1 -12 0 0 0 400 0 0 0 1 0 0 5 0 Arial\n" // Negative uses
+		"3 -12 0 0 0 400 0 0 0 1 0 0 5 Arial\n" // Missing field
+		"3 -12 0 0 0 400 0 0 0 1 0 0 5  0 Arial\n" // Double space
+		"3 -12 0 0 0 99999999999 0 0 0 1 0 0 5 0 Arial\n" // Overflow
+		"garbage\n"
+		"\n"
+		"5 -16 0 0 0 700 0 0 0 134 0 0 5 0 SimSun  \r\n";
+
+	std::vector<FontProfileEntry> parsed;
+	ASSERT_TRUE(ParseFontProfile(text, parsed));
+	ASSERT_EQ(parsed.size(), 2u);
+	EXPECT_EQ(parsed[0].face, "Segoe UI");
+	EXPECT_EQ(parsed[1].face, "SimSun  "); // Only the line end is trimmed
+	EXPECT_EQ(parsed[1].uses, 5u);
+	EXPECT_EQ(parsed[1].charSet, 134);
+}
+
+TEST(FontProfile, MergeHalvesSavedUses)
+{
+	std::vector<FontProfileEntry> saved = { Entry("Segoe UI", 10), Entry("Arial", 1), Entry("Tahoma", 6) };
+	MergeFontProfile(saved, { Entry("Segoe UI", 1), Entry("Consolas", 4) }, 64);
+
+	// Arial halves to 0 and is dropped, Segoe UI adds up, Consolas is new
+	EXPECT_EQ(Faces(saved), (std::vector<std::string>{ "Segoe UI 6", "Consolas 4", "Tahoma 3" }));
+}
+
+// Fonts differing in any field are different entries
+TEST(FontProfile, MergeMatchesWholeFont)
+{
+	std::vector<FontProfileEntry> saved = { Entry("Segoe UI", 8) };
+	FontProfileEntry bold = Entry("Segoe UI", 1);
+	bold.weight = 700;
+	FontProfileEntry larger = Entry("Segoe UI", 1, -16);
+	MergeFontProfile(saved, { bold, larger, Entry("Segoe UI", 2) }, 64);
+
+	ASSERT_EQ(saved.size(), 3u);
+	EXPECT_EQ(saved[0].uses, 6u);
+	EXPECT_EQ(saved[0].weight, 400);
+	EXPECT_EQ(saved[1].weight, 700);
+	EXPECT_EQ(saved[2].height, -16);
+}
+
+TEST(FontProfile, MergeKeepsMostUsed)
+{
+	std::vector<FontProfileEntry> saved;
+	std::vector<FontProfileEntry> session;
+	for (uint32_t i = 1; i <= 100; ++i)
+		session.push_back(Entry("Font " + std::to_string(i), i));
+	MergeFontProfile(saved, session, 3);
+	EXPECT_EQ(Faces(saved), (std::vector<std::string>{ "Font 100 100", "Font 99 99", "Font 98 98" }));
+
+	// Equal uses keep their order, saved fonts first
+	saved = { Entry("A", 4), Entry("B", 4) };
+	MergeFontProfile(saved, { Entry("C", 2) }, 64);
+	EXPECT_EQ(Faces(saved), (std::vector<std::string>{ "A 2", "B 2", "C 2" }));
+}
+
+TEST(FontProfile, MergeSaturatesUses)
+{
+	std::vector<FontProfileEntry> saved = { Entry("Segoe UI", UINT32_MAX) };
+	MergeFontProfile(saved, { Entry("Segoe UI", UINT32_MAX) }, 64);
+	EXPECT_EQ(saved[0].uses, UINT32_MAX);
+}
+
+// Faces that would break the line format or come back empty are not saved
+TEST(FontProfile, MergeDropsUnwritableFaces)
+{
+	std::vector<FontProfileEntry> saved;
+	MergeFontProfile(saved, { Entry("", 5), Entry("Bad\nFace", 5), Entry("Bad\rFace", 5), Entry("Good", 1) }, 64);
+	EXPECT_EQ(Faces(saved), (std::vector<std::string>{ "Good 1" }));
+
+	std::vector<FontProfileEntry> parsed;
+	ASSERT_TRUE(ParseFontProfile(SerializeFontProfile(saved), parsed));
+	EXPECT_EQ(Faces(parsed), Faces(saved));
+}
@@ -0,0 +1,92 @@
+// Cost of "glyphReplace" per ExtTextOutW string: the vector scan of GlyphReplaceTable
+// against looking up every character in the configured map, as GetGlyphOutlineW does.
+// The argument is the string length.
+
+#include "GlyphReplace.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+	// Full width punctuation to ASCII, a typical map
+	std::unordered_map<uint32_t, uint32_t> Map()
+	{
+		std::unordered_map<uint32_t, uint32_t> map;
+		for (uint32_t c = 0xFF01; c <= 0xFF0F; ++c)
+			map[c] = c - 0xFF01 + 0x21;
+		map[0x3002] = '.';
+		map[0x3001] = ',';
+		return map;
+	}
+
+	const GlyphReplaceTable& Table()
+	{
+		static const GlyphReplaceTable table = [] {
+			GlyphReplaceTable t;
+			t.Build(Map());
+			return t;
+		}();
+		return table;
+	}
+
+	// Latin and CJK text, with a mapped character every "every" code units, 0 for none
+	std::u16string Text(size_t length, size_t every)
+	{
+		constexpr std::u16string_view words = u"FontMod \x5FAE\x8F6F\x96C5\x9ED1 replaces fonts \x4E2D\x6587 ";
+		std::u16string text;
+		while (text.size() < length)
+			text += words;
+		text.resize(length);
+		for (size_t i = every ? every - 1 : length; i < length; i += every)
+			text[i] = u'\xFF0C';
+		return text;
+	}
+
+	void TableFind(benchmark::State& state, size_t every)
+	{
+		const auto& table = Table();
+		const std::u16string text = Text(static_cast<size_t>(state.range(0)), every);
+		for (auto _ : state)
+			benchmark::DoNotOptimize(table.Find(text.data(), text.size()));
+		state.SetBytesProcessed(state.iterations() * text.size() * sizeof(char16_t));
+	}
+
+	// Copy and replace, what the hook does once Find found a mapped character
+	void TableReplace(benchmark::State& state, size_t every)
+	{
+		const auto& table = Table();
+		const std::u16string text = Text(static_cast<size_t>(state.range(0)), every);
+		std::u16string copy;
+		for (auto _ : state)
+		{
+			copy = text;
+			benchmark::DoNotOptimize(table.Replace(copy.data(), copy.size()));
+		}
+		state.SetBytesProcessed(state.iterations() * text.size() * sizeof(char16_t));
+	}
+
+	void MapPerChar(benchmark::State& state, size_t every)
+	{
+		const auto map = Map();
+		const std::u16string text = Text(static_cast<size_t>(state.range(0)), every);
+		std::u16string copy;
+		for (auto _ : state)
+		{
+			copy = text;
+			for (auto& c : copy)
+			{
+				if (auto it = map.find(c); it != map.end())
+					c = static_cast<char16_t>(it->second);
+			}
+			benchmark::DoNotOptimize(copy.data());
+		}
+		state.SetBytesProcessed(state.iterations() * text.size() * sizeof(char16_t));
+	}
+}
+
+BENCHMARK_CAPTURE(TableFind, NoneMapped, 0)->Arg(16)->Arg(64)->Arg(512);
+BENCHMARK_CAPTURE(TableReplace, Sparse, 64)->Arg(64)->Arg(512);
+BENCHMARK_CAPTURE(TableReplace, Dense, 4)->Arg(64)->Arg(512);
+BENCHMARK_CAPTURE(MapPerChar, NoneMapped, 0)->Arg(16)->Arg(64)->Arg(512);
+BENCHMARK_CAPTURE(MapPerChar, Sparse, 64)->Arg(64)->Arg(512);
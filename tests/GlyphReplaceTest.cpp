@@ -0,0 +1,149 @@
+// GlyphReplaceTable's vector scan against looking up every code unit in the map
+
+#include "GlyphReplace.hpp"
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <string>
+
+namespace
+{
+	using Map = std::map<uint32_t, uint32_t>;
+
+	// What ExtTextOutW should get: BMP characters other than surrogates, mapped to the same
+	uint16_t Expected(const Map& map, char16_t c)
+	{
+		auto usable = [](uint32_t c) { return c <= 0xFFFF && (c < 0xD800 || c > 0xDFFF); };
+		auto it = map.find(c);
+		return it != map.end() && usable(it->first) && usable(it->second) ? static_cast<uint16_t>(it->second) : static_cast<uint16_t>(c);
+	}
+
+	// Checks Find and Replace on "text" and every suffix of it, so that all lengths and
+	// alignments are covered
+	void Check(const GlyphReplaceTable& table, const Map& map, const std::u16string& text)
+	{
+		for (size_t start = 0; start <= text.size(); ++start)
+		{
+			std::u16string s = text.substr(start);
+			std::u16string expected = s;
+			size_t first = s.size(), count = 0;
+			for (size_t i = 0; i < s.size(); ++i)
+			{
+				expected[i] = Expected(map, s[i]);
+				if (expected[i] != s[i])
+				{
+					first = std::min(first, i);
+					++count;
+				}
+			}
+
+			ASSERT_EQ(table.Find(s.data(), s.size()), first) << "length " << s.size();
+			ASSERT_EQ(table.Replace(s.data(), s.size()), count) << "length " << s.size();
+			ASSERT_EQ(s, expected) << "length " << s.size();
+		}
+	}
+
+	// Code units around the edges of the mapped range and of the map's entries, where
+	// the range test would be wrong first, and a few others
+	std::u16string RandomText(std::mt19937& random, const Map& map, size_t length)
+	{
+		std::vector<uint16_t> pool = { 0, 1, 0x7F, 0x8000, 0xD800, 0xDFFF, 0xFFFE, 0xFFFF };
+		for (const auto& [from, to] : map)
+		{
+			for (int d = -1; d <= 1; ++d)
+				pool.push_back(static_cast<uint16_t>(from + d));
+		}
+
+		std::u16string text(length, 0);
+		for (auto& c : text)
+			c = random() % 4 ? static_cast<char16_t>(pool[random() % pool.size()]) : static_cast<char16_t>(random());
+		return text;
+	}
+}
+
+TEST(GlyphReplace, EmptyTable)
+{
+	GlyphReplaceTable table;
+	EXPECT_EQ(table.Build(Map{}), 0u);
+	EXPECT_TRUE(table.Empty());
+	std::u16string text = u"text";
+	EXPECT_EQ(table.Find(text.data(), text.size()), text.size());
+	EXPECT_EQ(table.Replace(text.data(), text.size()), 0u);
+}
+
+// Surrogates and characters outside the BMP would change the string length
+TEST(GlyphReplace, SkipsUnusableEntries)
+{
+	const Map map = {
+		{ 0xD83D, 'a' },
+		{ 'b', 0xDE00 },
+		{ 0x1F600, 'c' },
+		{ 'd', 0x1F600 },
+		{ 'e', 'e' },
+		{ 0xFF01, '!' },
+	};
+	GlyphReplaceTable table;
+	EXPECT_EQ(table.Build(map), 5u);
+	EXPECT_FALSE(table.Empty());
+	Check(table, map, u"abcde\xFF01 \xD83D\xDE00 abcde\xFF01");
+}
+
+TEST(GlyphReplace, NoUsableEntries)
+{
+	GlyphReplaceTable table;
+	EXPECT_EQ(table.Build(Map{ { 0x1F600, 'a' }, { 'b', 'b' } }), 2u);
+	EXPECT_TRUE(table.Empty());
+	Check(table, {}, u"ab\xD83D\xDE00 ab ab ab ab");
+}
+
+// The range starts at 0, nothing wraps below it
+TEST(GlyphReplace, LowZero)
+{
+	const Map map = { { 0, ' ' }, { 5, '5' }, { 0x3002, '.' } };
+	GlyphReplaceTable table;
+	table.Build(map);
+	std::mt19937 random(1);
+	for (size_t length : { 7, 8, 9, 15, 16, 17, 33 })
+		Check(table, map, RandomText(random, map, length));
+}
+
+// The range is every code unit, the range test passes for all of them
+TEST(GlyphReplace, FullSpan)
+{
+	const Map map = { { 0, '0' }, { 0x8000, '8' }, { 0xFFFF, 'F' } };
+	GlyphReplaceTable table;
+	table.Build(map);
+	std::mt19937 random(2);
+	for (size_t length : { 7, 8, 9, 15, 16, 17, 33 })
+		Check(table, map, RandomText(random, map, length));
+}
+
+// A range of one code unit
+TEST(GlyphReplace, SingleEntry)
+{
+	const Map map = { { 0x3002, '.' } };
+	GlyphReplaceTable table;
+	table.Build(map);
+	Check(table, map, u"\x3001\x3002\x3003 \x3002\x3002\x3002\x3002\x3002\x3002\x3002\x3002\x3002");
+}
+
+TEST(GlyphReplace, MatchesMapOnRandomText)
+{
+	std::mt19937 random(3);
+	for (int round = 0; round < 200; ++round)
+	{
+		// Clustered maps like full width punctuation, and sparse ones across the BMP
+		Map map;
+		const uint32_t base = random() % 0x10000;
+		const size_t entries = 1 + random() % 24;
+		for (size_t i = 0; i < entries; ++i)
+		{
+			const uint32_t from = round % 2 ? (base + random() % 64) % 0x10000 : random() % 0x10000;
+			map[from] = random() % 16 ? random() % 0x10000 : 0x10000 + random() % 0x1000;
+		}
+
+		GlyphReplaceTable table;
+		table.Build(map);
+		Check(table, map, RandomText(random, map, random() % 70));
+	}
+}
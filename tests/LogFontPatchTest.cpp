@@ -0,0 +1,180 @@
+#include "FakeGdi.hpp"
+#include "FontInfo.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace
+{
+	using OF = FontInfo::OverrideFlags;
+
+	// Field by field override, as OverrideLogFont did before rules were compiled into patches
+	void ReferenceOverride(const FontInfo& info, LOGFONTW& lf, uint32_t dpi)
+	{
+		auto has = [&](OF flag) { return (info.overrideFlags & flag) == flag; };
+		auto pixels = [&](const ScaledSize& size, bool isHeight) {
+			if (!size.DpiRelative())
+				return size.Pixels();
+			return ResolveDpi(isHeight ? size.HeightPerDpi() : size.OffsetPerDpi(), dpi);
+		};
+		auto offset = [&](const ScaledSize& size) { return size.DpiRelative() ? ResolveDpi(size.OffsetPerDpi(), dpi) : size.Pixels(); };
+
+		if (!info.name.empty())
+		{
+			const size_t len = std::min(info.name.size(), size_t(LF_FACESIZE - 1));
+			std::copy_n(info.name.begin(), len, lf.lfFaceName);
+			lf.lfFaceName[len] = 0;
+		}
+		if (has(OF::Height))
+			lf.lfHeight = pixels(info.height, true);
+		if (has(OF::Width))
+			lf.lfWidth = pixels(info.width, false);
+		if (has(OF::HeightOffset) && lf.lfHeight != 0)
+		{
+			const long o = offset(info.heightOffset);
+			lf.lfHeight = lf.lfHeight > 0 ? std::max(1L, lf.lfHeight + o) : std::min(-1L, lf.lfHeight - o);
+		}
+		if (has(OF::WidthOffset) && lf.lfWidth != 0)
+			lf.lfWidth = std::max(1L, lf.lfWidth + offset(info.widthOffset));
+		if (has(OF::HeightScale) && lf.lfHeight != 0)
+			lf.lfHeight = std::lround(lf.lfHeight * info.heightScale);
+		if (has(OF::WidthScale) && lf.lfWidth != 0)
+			lf.lfWidth = std::lround(lf.lfWidth * info.widthScale);
+		if (has(OF::Weight))
+			lf.lfWeight = info.weight;
+		if (has(OF::Italic))
+			lf.lfItalic = info.italic;
+		if (has(OF::Underline))
+			lf.lfUnderline = info.underLine;
+		if (has(OF::StrikeOut))
+			lf.lfStrikeOut = info.strikeOut;
+		if (has(OF::Charset))
+			lf.lfCharSet = info.charSet;
+		if (has(OF::OutPrecision))
+			lf.lfOutPrecision = info.outPrecision;
+		if (has(OF::ClipPrecision))
+			lf.lfClipPrecision = info.clipPrecision;
+		if (has(OF::Quality))
+			lf.lfQuality = info.quality;
+		if (has(OF::PitchAndFamily))
+			lf.lfPitchAndFamily = info.pitchAndFamily;
+	}
+
+	ScaledSize RandomSize(std::mt19937_64& rng, long range)
+	{
+		static constexpr SizeUnit units[] = { SizeUnit::Pixel, SizeUnit::Point, SizeUnit::Dip };
+		const SizeUnit unit = units[rng() % 3];
+		const long whole = static_cast<long>(rng() % (2 * range + 1)) - range;
+		return { unit == SizeUnit::Pixel ? double(whole) : whole + (rng() % 2) * 0.5, unit };
+	}
+
+	FontInfo RandomRule(std::mt19937_64& rng)
+	{
+		FontInfo info;
+		info.overrideFlags = static_cast<OF>(rng() & 0xFFFE);
+		for (size_t i = rng() % 3 ? rng() % 40 : 0; i; --i)
+			info.name.push_back(static_cast<wchar_t>(L'a' + rng() % 26));
+		info.height = RandomSize(rng, 100);
+		info.width = RandomSize(rng, 100);
+		info.heightOffset = RandomSize(rng, 10);
+		info.widthOffset = RandomSize(rng, 10);
+		info.heightScale = (rng() % 400) / 100.0;
+		info.widthScale = (rng() % 400) / 100.0;
+		info.weight = static_cast<long>(rng() % 1000);
+		info.italic = rng() & 1;
+		info.underLine = rng() & 1;
+		info.strikeOut = rng() & 1;
+		info.charSet = static_cast<BYTE>(rng());
+		info.outPrecision = static_cast<BYTE>(rng());
+		info.clipPrecision = static_cast<BYTE>(rng());
+		info.quality = static_cast<BYTE>(rng());
+		info.pitchAndFamily = static_cast<BYTE>(rng());
+		CompileOverride(info);
+		return info;
+	}
+
+	LOGFONTW RandomFont(std::mt19937_64& rng)
+	{
+		LOGFONTW lf;
+		for (size_t i = 0; i < sizeof(lf); ++i)
+			reinterpret_cast<uint8_t*>(&lf)[i] = static_cast<uint8_t>(rng());
+		lf.lfHeight = rng() % 4 ? static_cast<long>(rng() % 400) - 200 : 0;
+		lf.lfWidth = rng() % 4 ? static_cast<long>(rng() % 400) - 200 : 0;
+		return lf;
+	}
+
+	void ExpectSame(const LOGFONTW& a, const LOGFONTW& b)
+	{
+		EXPECT_EQ(a.lfHeight, b.lfHeight);
+		EXPECT_EQ(a.lfWidth, b.lfWidth);
+		EXPECT_EQ(std::wstring_view(a.lfFaceName, LF_FACESIZE), std::wstring_view(b.lfFaceName, LF_FACESIZE));
+		EXPECT_EQ(memcmp(&a, &b, sizeof(a)), 0);
+	}
+}
+
+TEST(LogFontPatch, MatchesFieldByFieldOverride)
+{
+	std::mt19937_64 rng(32);
+	for (int i = 0; i < 100000; ++i)
+	{
+		const FontInfo info = RandomRule(rng);
+		const uint32_t dpi = std::array{ 96u, 120u, 144u, 192u }[rng() % 4];
+		LOGFONTW a = RandomFont(rng);
+		LOGFONTW b = a;
+		OverrideLogFont(info, a, dpi);
+		ReferenceOverride(info, b, dpi);
+		ExpectSame(a, b);
+		if (HasFailure())
+			FAIL() << "case " << i;
+	}
+}
+
+TEST(LogFontPatch, FaceNameTruncated)
+{
+	FontInfo info;
+	info.name = std::wstring(40, L'x');
+	CompileOverride(info);
+
+	LOGFONTW lf = {};
+	std::fill(std::begin(lf.lfFaceName), std::end(lf.lfFaceName), L'y');
+	OverrideLogFont(info, lf, DefaultDpi);
+	EXPECT_EQ(std::wstring(lf.lfFaceName), std::wstring(LF_FACESIZE - 1, L'x'));
+}
+
+// Offsets shrink fonts down to 1 pixel, never to 0 (default size) or across the sign
+TEST(LogFontPatch, OffsetsKeepSign)
+{
+	FontInfo info;
+	info.overrideFlags = OF::HeightOffset | OF::WidthOffset;
+	info.heightOffset = { -50 };
+	info.widthOffset = { -50 };
+	CompileOverride(info);
+
+	LOGFONTW lf = {};
+	lf.lfHeight = -12;
+	lf.lfWidth = 6;
+	OverrideLogFont(info, lf, DefaultDpi);
+	EXPECT_EQ(lf.lfHeight, -1);
+	EXPECT_EQ(lf.lfWidth, 1);
+
+	lf.lfHeight = 0;
+	lf.lfWidth = 0;
+	OverrideLogFont(info, lf, DefaultDpi);
+	EXPECT_EQ(lf.lfHeight, 0);
+	EXPECT_EQ(lf.lfWidth, 0);
+}
+
+TEST(LogFontPatch, PointsFollowDpi)
+{
+	FontInfo info;
+	info.overrideFlags = OF::Height | OF::HeightOffset;
+	info.height = { 9, SizeUnit::Point };
+	info.heightOffset = { 1, SizeUnit::Dip };
+	CompileOverride(info);
+	EXPECT_TRUE(info.patch.UsesDpi());
+
+	LOGFONTW lf = {};
+	OverrideLogFont(info, lf, 96);
+	EXPECT_EQ(lf.lfHeight, -13);
+	OverrideLogFont(info, lf, 144);
+	EXPECT_EQ(lf.lfHeight, -20);
+}
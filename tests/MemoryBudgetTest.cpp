@@ -0,0 +1,208 @@
+#include "MemoryBudget.hpp"
+#include <gtest/gtest.h>
+#include <list>
+#include <random>
+#include <thread>
+
+namespace
+{
+	// A cache of fixed size entries behind its own lock, reporting to the budget the
+	// way the runtime caches do: Add under the lock, Enforce after releasing it, Remove
+	// for whatever is dropped, whether by its own limit or by a trim
+	class FakeCache
+	{
+	public:
+		FakeCache(MemoryBudget& budget, std::string_view name, size_t entryBytes, size_t maxEntries)
+			: budget(budget), entryBytes(entryBytes), maxEntries(maxEntries)
+		{
+			id = budget.Register(name, [this] { return hits.load(std::memory_order_relaxed); }, [this](size_t bytes) { return Trim(bytes); });
+		}
+
+		MemoryBudget::Id Id() const
+		{
+			return id;
+		}
+
+		void Get(uint64_t key)
+		{
+			bool overBudget = false;
+			{
+				std::lock_guard lock(mutex);
+				for (auto it = entries.begin(); it != entries.end(); ++it)
+				{
+					if (*it == key)
+					{
+						entries.splice(entries.begin(), entries, it);
+						hits.fetch_add(1, std::memory_order_relaxed);
+						return;
+					}
+				}
+				entries.push_front(key);
+				bytes += entryBytes;
+				overBudget = budget.Add(id, entryBytes);
+				if (entries.size() > maxEntries)
+					Drop();
+			}
+			if (overBudget)
+				budget.Enforce();
+		}
+
+		size_t Bytes()
+		{
+			std::lock_guard lock(mutex);
+			return bytes;
+		}
+
+		std::atomic<uint64_t> hits = 0;
+
+	private:
+		// Under the lock
+		void Drop()
+		{
+			entries.pop_back();
+			bytes -= entryBytes;
+			budget.Remove(id, entryBytes);
+		}
+
+		size_t Trim(size_t want)
+		{
+			std::lock_guard lock(mutex);
+			size_t freed = 0;
+			while (freed < want && !entries.empty())
+			{
+				Drop();
+				freed += entryBytes;
+			}
+			return freed;
+		}
+
+		MemoryBudget& budget;
+		MemoryBudget::Id id;
+		size_t entryBytes;
+		size_t maxEntries;
+		std::mutex mutex;
+		std::list<uint64_t> entries; // Most recently used first
+		size_t bytes = 0;
+	};
+}
+
+TEST(MemoryBudget, DisabledRegistersNothing)
+{
+	MemoryBudget budget;
+	EXPECT_EQ(budget.Register("cache", [] { return 0; }, [](size_t) { return 0; }), MemoryBudget::NoId);
+	EXPECT_FALSE(budget.Add(MemoryBudget::NoId, 1 << 20));
+	budget.Remove(MemoryBudget::NoId, 1 << 20);
+	EXPECT_EQ(budget.Used(), 0u);
+	EXPECT_TRUE(budget.Snapshot().empty());
+}
+
+TEST(MemoryBudget, TrimsToSevenEighths)
+{
+	MemoryBudget budget;
+	budget.Enable(64 * 1024);
+	FakeCache cache(budget, "cache", 1024, SIZE_MAX);
+	for (uint64_t key = 0; key < 64; ++key)
+		cache.Get(key);
+	EXPECT_EQ(budget.Used(), 64u * 1024);
+
+	cache.Get(64); // One over
+	EXPECT_LE(budget.Used(), 56u * 1024);
+	EXPECT_EQ(budget.Used(), cache.Bytes());
+	EXPECT_EQ(budget.Snapshot()[0].trimmed, 65u * 1024 - budget.Used());
+}
+
+// Of two caches holding the same bytes, the one hit less gives up more
+TEST(MemoryBudget, TrimsColdCachesMore)
+{
+	MemoryBudget budget;
+	budget.Enable(64 * 1024);
+	FakeCache hot(budget, "hot", 1024, SIZE_MAX), cold(budget, "cold", 1024, SIZE_MAX);
+	for (uint64_t key = 0; key < 32; ++key)
+		hot.Get(key), cold.Get(key);
+	for (int i = 0; i < 100; ++i)
+		hot.Get(i % 32);
+
+	cold.Get(1000);
+	EXPECT_LE(budget.Used(), 56u * 1024);
+	EXPECT_GT(hot.Bytes(), cold.Bytes());
+	EXPECT_EQ(budget.Used(), hot.Bytes() + cold.Bytes());
+}
+
+// Threads filling caches of different sizes and hit rates at once. Whatever the
+// interleaving of Add, Remove, Enforce and trims, the budget's accounting matches what
+// the caches hold, and the total never stays over the cap.
+TEST(MemoryBudget, Stress)
+{
+	constexpr size_t Cap = 256 * 1024;
+	constexpr int Threads = 8;
+	constexpr int Operations = 50000;
+
+	MemoryBudget budget;
+	budget.Enable(Cap);
+	std::vector<std::unique_ptr<FakeCache>> caches;
+	caches.push_back(std::make_unique<FakeCache>(budget, "small", 64, 4096));
+	caches.push_back(std::make_unique<FakeCache>(budget, "large", 4096, 64));
+	caches.push_back(std::make_unique<FakeCache>(budget, "medium", 512, 1024));
+	caches.push_back(std::make_unique<FakeCache>(budget, "unbounded", 1024, SIZE_MAX));
+
+	std::atomic<size_t> peak = 0;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < Threads; ++t)
+	{
+		threads.emplace_back([&, t] {
+			std::mt19937_64 rng(t);
+			for (int i = 0; i < Operations; ++i)
+			{
+				auto& cache = *caches[rng() % caches.size()];
+				// Skewed keys, so some entries are hit again
+				const uint64_t key = rng() % 4 ? rng() % 64 : rng() % 100000;
+				cache.Get(key);
+				size_t used = budget.Used(), seen = peak.load();
+				while (used > seen && !peak.compare_exchange_weak(seen, used))
+				{
+				}
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	size_t held = 0;
+	const auto snapshot = budget.Snapshot();
+	ASSERT_EQ(snapshot.size(), caches.size());
+	for (size_t i = 0; i < caches.size(); ++i)
+	{
+		EXPECT_EQ(snapshot[i].bytes, caches[i]->Bytes()) << snapshot[i].name;
+		EXPECT_EQ(snapshot[i].hits, caches[i]->hits.load()) << snapshot[i].name;
+		held += caches[i]->Bytes();
+	}
+	EXPECT_EQ(budget.Used(), held);
+	EXPECT_LE(budget.Used(), Cap);
+
+	// Between an Add going over and its Enforce, each thread may add one more entry
+	EXPECT_LE(peak.load(), Cap + Threads * 4096);
+	EXPECT_GT(snapshot[3].trimmed, 0u);
+}
+
+// Trims that free nothing, or less than asked, end after a few passes
+TEST(MemoryBudget, StubbornCachesEnd)
+{
+	MemoryBudget budget;
+	budget.Enable(1024);
+	int trims = 0;
+	const auto id = budget.Register("stubborn", [] { return 0; }, [&](size_t) { ++trims; return 0; });
+	EXPECT_TRUE(budget.Add(id, 4096));
+	budget.Enforce();
+	EXPECT_EQ(trims, 1);
+	EXPECT_EQ(budget.Used(), 4096u);
+
+	MemoryBudget slowBudget;
+	slowBudget.Enable(1024);
+	int slowTrims = 0;
+	MemoryBudget::Id slow = MemoryBudget::NoId;
+	slow = slowBudget.Register("slow", [] { return 0; }, [&](size_t) { ++slowTrims; slowBudget.Remove(slow, 1); return 1; });
+	EXPECT_TRUE(slowBudget.Add(slow, 4096));
+	slowBudget.Enforce();
+	EXPECT_EQ(slowTrims, MemoryBudget::MaxPasses);
+	EXPECT_EQ(slowBudget.Used(), 4096u - MemoryBudget::MaxPasses);
+}
@@ -0,0 +1,31 @@
+// Finding the module of a return address, once per stack frame walked by CreateFont
+// calls of rules with a "module" condition
+
+#include "FakeGdi.hpp"
+#include "ModuleIndex.hpp"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+	void FindModule(benchmark::State& state)
+	{
+		const auto count = static_cast<uintptr_t>(state.range(0));
+		ModuleIndex index;
+		for (uintptr_t i = 0; i < count; ++i)
+		{
+			const auto name = L"module" + std::to_wstring(i) + L".dll";
+			index.RegisterName(name);
+			index.Add(0x10000000 + i * 0x100000, 0x80000, name);
+		}
+
+		// Addresses inside modules and in the gaps between them
+		std::vector<uintptr_t> addresses;
+		for (uintptr_t i = 0; i < 64; ++i)
+			addresses.push_back(0x10000000 + (i * 7919 % count) * 0x100000 + (i % 2 ? 0x1234 : 0x90000));
+		size_t i = 0;
+		for (auto _ : state)
+			benchmark::DoNotOptimize(index.Find(addresses[i++ % addresses.size()]));
+	}
+}
+
+BENCHMARK(FindModule)->Arg(4)->Arg(64)->Arg(512);
@@ -0,0 +1,79 @@
+#include "FakeGdi.hpp"
+#include "ModuleIndex.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(ModuleIndex, FindsNamedModules)
+{
+	ModuleIndex index;
+	const uint32_t qt = index.RegisterName(L"Qt5Gui.dll");
+	const uint32_t app = index.RegisterName(L"app.exe");
+	EXPECT_EQ(index.RegisterName(L"QT5GUI.DLL"), qt);
+	index.RegisterSkip(L"gdi32.dll");
+
+	index.Add(0x10000, 0x1000, L"qt5gui.dll");
+	index.Add(0x40000, 0x2000, L"App.exe");
+	index.Add(0x20000, 0x1000, L"GDI32.dll");
+	index.Add(0x30000, 0x1000, L"other.dll");
+
+	EXPECT_EQ(index.Find(0xFFFF), ModuleIndex::None);
+	EXPECT_EQ(index.Find(0x10000), qt);
+	EXPECT_EQ(index.Find(0x10FFF), qt);
+	EXPECT_EQ(index.Find(0x11000), ModuleIndex::None);
+	EXPECT_EQ(index.Find(0x20800), ModuleIndex::Skip);
+	EXPECT_EQ(index.Find(0x30000), ModuleIndex::None);
+	EXPECT_EQ(index.Find(0x41FFF), app);
+	EXPECT_EQ(index.Find(UINTPTR_MAX), ModuleIndex::None);
+}
+
+TEST(ModuleIndex, AddTwiceAndRemove)
+{
+	ModuleIndex index;
+	const uint32_t id = index.RegisterName(L"a.dll");
+	index.Add(0x10000, 0x1000, L"a.dll");
+	index.Add(0x10000, 0x1000, L"a.dll");
+	EXPECT_EQ(index.Find(0x10000), id);
+
+	index.Remove(0x10000);
+	EXPECT_EQ(index.Find(0x10000), ModuleIndex::None);
+	index.Remove(0x10000);
+
+	// Loaded again at another address
+	index.Add(0x50000, 0x1000, L"a.dll");
+	EXPECT_EQ(index.Find(0x10000), ModuleIndex::None);
+	EXPECT_EQ(index.Find(0x50000), id);
+}
+
+// Readers keep finding modules that stay loaded while others load and unload
+TEST(ModuleIndex, ReadersDuringUpdates)
+{
+	ModuleIndex index;
+	const uint32_t stable = index.RegisterName(L"stable.dll");
+	index.RegisterName(L"churn.dll");
+	index.Add(0x100000, 0x1000, L"stable.dll");
+
+	std::atomic<bool> done = false;
+	std::atomic<uint64_t> wrong = 0;
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; ++i)
+	{
+		readers.emplace_back([&] {
+			while (!done.load(std::memory_order_relaxed))
+			{
+				if (index.Find(0x100800) != stable)
+					wrong.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+	}
+
+	for (uintptr_t i = 0; i < 2000; ++i)
+	{
+		const uintptr_t base = (i % 2 ? 0x200000 : 0x10000) + (i % 16) * 0x1000;
+		index.Add(base, 0x1000, L"churn.dll");
+		index.Remove(base);
+	}
+	done = true;
+	for (auto& t : readers)
+		t.join();
+	EXPECT_EQ(wrong, 0u);
+}
@@ -0,0 +1,54 @@
+// Per call cost of applying a "fonts" rule to a LOGFONTW in CreateFont
+
+#include "FakeGdi.hpp"
+#include "FontInfo.hpp"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+	using OF = FontInfo::OverrideFlags;
+
+	LOGFONTW Incoming()
+	{
+		LOGFONTW lf = {};
+		lf.lfHeight = -16;
+		lf.lfWeight = FW_NORMAL;
+		lf.lfCharSet = DEFAULT_CHARSET;
+		wcscpy(lf.lfFaceName, L"MS Shell Dlg");
+		return lf;
+	}
+
+	FontInfo Rule(OF flags)
+	{
+		FontInfo info;
+		info.name = L"Segoe UI";
+		info.overrideFlags = flags;
+		info.height = { 9, SizeUnit::Point };
+		info.heightOffset = { 2 };
+		info.widthOffset = { 1 };
+		info.heightScale = 1.25;
+		info.widthScale = 1.1;
+		info.weight = FW_BOLD;
+		info.quality = 5;
+		CompileOverride(info);
+		return info;
+	}
+
+	void Override(benchmark::State& state, OF flags)
+	{
+		const FontInfo info = Rule(flags);
+		const LOGFONTW incoming = Incoming();
+		for (auto _ : state)
+		{
+			LOGFONTW lf = incoming;
+			OverrideLogFont(info, lf, 144);
+			benchmark::DoNotOptimize(lf);
+		}
+	}
+}
+
+BENCHMARK_CAPTURE(Override, NameOnly, OF::None);
+BENCHMARK_CAPTURE(Override, Constants, OF::Weight | OF::Quality);
+BENCHMARK_CAPTURE(Override, Offsets, OF::HeightOffset | OF::WidthOffset);
+BENCHMARK_CAPTURE(Override, Scales, OF::HeightScale | OF::WidthScale);
+BENCHMARK_CAPTURE(Override, PointSize, OF::Height | OF::Weight);
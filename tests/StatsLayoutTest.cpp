@@ -0,0 +1,176 @@
+// StatsLayout.hpp and the viewers' reader, over a block published in POSIX shared memory
+// the way LiveStats.hpp publishes it in a Windows mapping
+
+#include "tools/LiveStatsSource.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+
+namespace
+{
+	// A block of "size" bytes for this process, removed when destroyed
+	class PublishedBlock
+	{
+	public:
+		explicit PublishedBlock(size_t size = sizeof(LiveStatsBlock)) : size(size)
+		{
+			name = "/" + std::string(LiveStatsNamePrefix) + std::to_string(getpid());
+			const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+			if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)
+				return;
+			view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			close(fd);
+			if (view == MAP_FAILED)
+				view = nullptr;
+		}
+
+		~PublishedBlock()
+		{
+			if (view)
+				munmap(view, size);
+			shm_unlink(name.c_str());
+		}
+
+		// Same header as LiveStats::Publish, "counterCount" can be lowered for older builds
+		LiveStatsBlock* Publish(uint32_t counterCount = LiveStatsBlock::CounterCount)
+		{
+			auto b = static_cast<LiveStatsBlock*>(view);
+			b->version = LiveStatsBlock::Version;
+			b->size = static_cast<uint32_t>(size);
+			b->pid = static_cast<uint32_t>(getpid());
+			b->startTime = LiveStatsNow();
+			b->hookCount = static_cast<uint32_t>(LiveStatsBlock::HookCount);
+			b->counterCount = counterCount;
+			b->magic.store(LiveStatsBlock::Magic, std::memory_order_release);
+			return b;
+		}
+
+		void* view = nullptr;
+
+	private:
+		std::string name;
+		size_t size;
+	};
+
+	uint32_t Self()
+	{
+		return static_cast<uint32_t>(getpid());
+	}
+}
+
+TEST(StatsLayout, Layout)
+{
+	// Viewers built by other compilers map the same bytes
+	static_assert(offsetof(LiveStatsBlock, startTime) == 16);
+	static_assert(offsetof(LiveStatsBlock, hookCalls) == 64);
+	static_assert(sizeof(LiveCounterSlot) == 64);
+	static_assert(sizeof(LiveStatsBlock) == 64 * (1 + LiveStatsBlock::HookCount + LiveStatsBlock::CounterCount));
+	static_assert(hookNames.size() == LiveStatsBlock::HookCount);
+	static_assert(liveCounterNames.size() == LiveStatsBlock::CounterCount);
+	for (auto name : hookNames)
+		EXPECT_FALSE(name.empty());
+	for (auto name : liveCounterNames)
+		EXPECT_FALSE(name.empty());
+}
+
+TEST(StatsLayout, FindsAndReadsPublishedBlock)
+{
+	PublishedBlock published;
+	ASSERT_NE(published.view, nullptr);
+	LiveStatsBlock* block = published.Publish();
+	block->hookCalls[static_cast<size_t>(HookId::CreateFontIndirectExW)].value = 12;
+	block->counters[static_cast<size_t>(LiveCounter::RuleHits)].value = 7;
+	block->counters[static_cast<size_t>(LiveCounter::GlyphReplaceStrings)].value = 3;
+
+	const auto processes = FindLiveStatsProcesses();
+	auto self = std::find_if(processes.begin(), processes.end(), [](const auto& p) { return p.pid == Self(); });
+	ASSERT_NE(self, processes.end());
+	EXPECT_EQ(self->name, "StatsLayoutTest");
+
+	LiveStatsView view;
+	ASSERT_TRUE(view.Open(Self()));
+	LiveStatsSnapshot snapshot;
+	ASSERT_TRUE(view.Read(snapshot));
+	EXPECT_EQ(snapshot.pid, Self());
+	EXPECT_EQ(snapshot.startTime, block->startTime);
+	EXPECT_EQ(snapshot.hookCalls[static_cast<size_t>(HookId::CreateFontIndirectExW)], 12u);
+	EXPECT_EQ(snapshot.counters[static_cast<size_t>(LiveCounter::RuleHits)], 7u);
+	EXPECT_EQ(snapshot.counters[static_cast<size_t>(LiveCounter::GlyphReplaceStrings)], 3u);
+
+	// The mapping is live, later increments are seen without reopening
+	block->counters[static_cast<size_t>(LiveCounter::RuleHits)].value.fetch_add(1);
+	ASSERT_TRUE(view.Read(snapshot));
+	EXPECT_EQ(snapshot.counters[static_cast<size_t>(LiveCounter::RuleHits)], 8u);
+}
+
+TEST(StatsLayout, NotFoundWithoutBlock)
+{
+	LiveStatsView view;
+	EXPECT_FALSE(view.Open(Self()));
+	LiveStatsSnapshot snapshot;
+	EXPECT_FALSE(view.Read(snapshot));
+
+	const auto processes = FindLiveStatsProcesses();
+	EXPECT_TRUE(std::none_of(processes.begin(), processes.end(), [](const auto& p) { return p.pid == Self(); }));
+}
+
+// A block published before the header is complete isn't read
+TEST(StatsLayout, RejectsIncompleteBlock)
+{
+	PublishedBlock published;
+	ASSERT_NE(published.view, nullptr);
+	LiveStatsView view;
+	ASSERT_TRUE(view.Open(Self()));
+	LiveStatsSnapshot snapshot;
+	EXPECT_FALSE(view.Read(snapshot));
+
+	published.Publish();
+	EXPECT_TRUE(view.Read(snapshot));
+}
+
+// Builds with fewer counters publish smaller blocks, the missing counters read as zero
+TEST(StatsLayout, ReadsOlderBlock)
+{
+	constexpr uint32_t oldCounters = 5;
+	PublishedBlock published(64 * (1 + LiveStatsBlock::HookCount + oldCounters));
+	ASSERT_NE(published.view, nullptr);
+	LiveStatsBlock* block = published.Publish(oldCounters);
+	block->counters[oldCounters - 1].value = 9;
+
+	LiveStatsView view;
+	ASSERT_TRUE(view.Open(Self()));
+	LiveStatsSnapshot snapshot;
+	ASSERT_TRUE(view.Read(snapshot));
+	EXPECT_EQ(snapshot.counters[oldCounters - 1], 9u);
+	for (size_t i = oldCounters; i < LiveStatsBlock::CounterCount; ++i)
+		EXPECT_EQ(snapshot.counters[i], 0u);
+}
+
+TEST(StatsLayout, RejectsIncompatibleBlocks)
+{
+	std::vector<uint8_t> bytes(sizeof(LiveStatsBlock));
+	auto block = reinterpret_cast<LiveStatsBlock*>(bytes.data());
+	block->version = LiveStatsBlock::Version;
+	block->size = sizeof(LiveStatsBlock);
+	block->hookCount = static_cast<uint32_t>(LiveStatsBlock::HookCount);
+	block->counterCount = static_cast<uint32_t>(LiveStatsBlock::CounterCount);
+	block->magic = LiveStatsBlock::Magic;
+
+	LiveStatsSnapshot snapshot;
+	ASSERT_TRUE(ReadLiveStats(bytes.data(), bytes.size(), snapshot));
+
+	// Mapped smaller than the header, or than the size the block claims
+	EXPECT_FALSE(ReadLiveStats(bytes.data(), offsetof(LiveStatsBlock, hookCalls) - 1, snapshot));
+	EXPECT_FALSE(ReadLiveStats(bytes.data(), bytes.size() - 64, snapshot));
+
+	block->version = LiveStatsBlock::Version + 1;
+	EXPECT_FALSE(ReadLiveStats(bytes.data(), bytes.size(), snapshot));
+	block->version = LiveStatsBlock::Version;
+
+	// Counts that don't fit the block
+	block->counterCount += 1;
+	EXPECT_FALSE(ReadLiveStats(bytes.data(), bytes.size(), snapshot));
+	block->counterCount -= 1;
+
+	block->magic = 0;
+	EXPECT_FALSE(ReadLiveStats(bytes.data(), bytes.size(), snapshot));
+}
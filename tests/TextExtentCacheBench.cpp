@@ -0,0 +1,126 @@
+// TextExtentCache against calling GDI directly, on the fake GDI. The argument is the spin
+// count of a fake GDI call, see CharWidthCacheBench.cpp.
+
+#include "FakeGdi.hpp"
+#include "MemoryBudget.hpp"
+#include "TextExtentCache.hpp"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+	struct Fixture
+	{
+		Fixture()
+		{
+			LOGFONTW lf = {};
+			lf.lfHeight = -16;
+			wcscpy(lf.lfFaceName, L"Segoe UI");
+			font = CreateFontIndirectW(&lf);
+			hdc = CreateCompatibleDC(nullptr);
+			SelectObject(hdc, font);
+			cache.Enable(256);
+
+			// Labels of a list redrawn on every repaint
+			for (int i = 0; i < 64; ++i)
+				labels.push_back(std::format(L"Item {} \x2014 {}", i, i % 3 ? L"Microsoft YaHei UI" : L"Segoe UI"));
+		}
+
+		HDC hdc;
+		HFONT font;
+		TextExtentCache cache;
+		std::vector<std::wstring> labels;
+	};
+
+	Fixture& Shared()
+	{
+		static Fixture fixture;
+		return fixture;
+	}
+
+	void Direct(benchmark::State& state)
+	{
+		fakeGdi.callCost = static_cast<uint32_t>(state.range(0));
+		Fixture& f = Shared();
+		for (auto _ : state)
+		{
+			for (const auto& label : f.labels)
+			{
+				SIZE size;
+				GetTextExtentPoint32W(f.hdc, label.c_str(), static_cast<int>(label.size()), &size);
+				benchmark::DoNotOptimize(size);
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * f.labels.size());
+	}
+
+	void Cached(benchmark::State& state)
+	{
+		fakeGdi.callCost = static_cast<uint32_t>(state.range(0));
+		Fixture& f = Shared();
+		for (auto _ : state)
+		{
+			for (const auto& label : f.labels)
+			{
+				SIZE size;
+				f.cache.GetExtentPoint(f.hdc, label.c_str(), static_cast<int>(label.size()), &size, GetTextExtentPoint32W);
+				benchmark::DoNotOptimize(size);
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * f.labels.size());
+	}
+
+	// Strings never measured before, the cost of a miss and an insert on top of GDI
+	void CachedUnique(benchmark::State& state)
+	{
+		fakeGdi.callCost = static_cast<uint32_t>(state.range(0));
+		Fixture& f = Shared();
+		std::wstring text = L"Unique 000000000";
+		uint64_t n = 0;
+		for (auto _ : state)
+		{
+			for (size_t i = text.size(), v = ++n; v; v /= 10)
+				text[--i] = static_cast<wchar_t>(L'0' + v % 10);
+			SIZE size;
+			f.cache.GetExtentPoint(f.hdc, text.c_str(), static_cast<int>(text.size()), &size, GetTextExtentPoint32W);
+			benchmark::DoNotOptimize(size);
+		}
+	}
+
+	// Per character positions, as edit controls ask for them
+	void DirectDx(benchmark::State& state)
+	{
+		fakeGdi.callCost = static_cast<uint32_t>(state.range(0));
+		Fixture& f = Shared();
+		const std::wstring& label = f.labels[1];
+		std::vector<INT> dx(label.size());
+		for (auto _ : state)
+		{
+			SIZE size;
+			INT fit;
+			GetTextExtentExPointW(f.hdc, label.c_str(), static_cast<int>(label.size()), 100, &fit, dx.data(), &size);
+			benchmark::DoNotOptimize(dx.data());
+		}
+	}
+
+	void CachedDx(benchmark::State& state)
+	{
+		fakeGdi.callCost = static_cast<uint32_t>(state.range(0));
+		Fixture& f = Shared();
+		const std::wstring& label = f.labels[1];
+		std::vector<INT> dx(label.size());
+		for (auto _ : state)
+		{
+			SIZE size;
+			INT fit;
+			f.cache.GetExtentExPoint(f.hdc, label.c_str(), static_cast<int>(label.size()), 100, &fit, dx.data(), &size, GetTextExtentExPointW);
+			benchmark::DoNotOptimize(dx.data());
+		}
+	}
+}
+
+BENCHMARK(Direct)->Arg(0)->Arg(100)->Arg(1000);
+BENCHMARK(Cached)->Arg(0)->Arg(100)->Arg(1000);
+BENCHMARK(Cached)->Arg(100)->Threads(4)->UseRealTime();
+BENCHMARK(CachedUnique)->Arg(0)->Arg(1000);
+BENCHMARK(DirectDx)->Arg(0)->Arg(1000);
+BENCHMARK(CachedDx)->Arg(0)->Arg(1000);
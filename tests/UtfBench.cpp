@@ -0,0 +1,49 @@
+// UTF-8 <-> UTF-16 conversion of config keys, face names and a whole config file
+
+#include "Utf.hpp"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+	const std::string faceAscii = "Microsoft YaHei UI";
+	const std::string faceCjk = "\xE5\xBE\xAE\xE8\xBD\xAF\xE9\x9B\x85\xE9\xBB\x91"; // 微软雅黑
+
+	std::string ConfigText()
+	{
+		std::string text;
+		while (text.size() < 16384)
+			text += "fonts:\n  SimSun: # Chinese fallback\n    replace: " + faceCjk + "\n    sizeOffset: -1\n";
+		return text;
+	}
+
+	void ToUtf16(benchmark::State& state, const std::string& utf8)
+	{
+		std::u16string utf16;
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(Utf8ToUtf16(utf8, utf16));
+			benchmark::DoNotOptimize(utf16.data());
+		}
+		state.SetBytesProcessed(state.iterations() * utf8.size());
+	}
+
+	void ToUtf8(benchmark::State& state, const std::string& source)
+	{
+		std::u16string utf16;
+		Utf8ToUtf16(source, utf16);
+		std::string utf8;
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(Utf16ToUtf8(std::u16string_view(utf16), utf8));
+			benchmark::DoNotOptimize(utf8.data());
+		}
+		state.SetBytesProcessed(state.iterations() * utf16.size() * sizeof(char16_t));
+	}
+}
+
+BENCHMARK_CAPTURE(ToUtf16, FaceAscii, faceAscii);
+BENCHMARK_CAPTURE(ToUtf16, FaceCjk, faceCjk);
+BENCHMARK_CAPTURE(ToUtf16, Config, ConfigText());
+BENCHMARK_CAPTURE(ToUtf8, FaceAscii, faceAscii);
+BENCHMARK_CAPTURE(ToUtf8, FaceCjk, faceCjk);
+BENCHMARK_CAPTURE(ToUtf8, Config, ConfigText());
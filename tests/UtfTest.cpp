@@ -0,0 +1,206 @@
+#include "Utf.hpp"
+#include <gtest/gtest.h>
+#include <optional>
+#include <random>
+
+namespace
+{
+	// Code point at a time reference, following the Unicode definition of well formed UTF-8
+	std::optional<std::u16string> ReferenceUtf8ToUtf16(std::string_view in)
+	{
+		std::u16string out;
+		for (size_t i = 0; i < in.size();)
+		{
+			const uint8_t c = in[i];
+			uint32_t cp;
+			size_t len;
+			if (c < 0x80)
+				cp = c, len = 1;
+			else if ((c & 0xE0) == 0xC0)
+				cp = c & 0x1F, len = 2;
+			else if ((c & 0xF0) == 0xE0)
+				cp = c & 0x0F, len = 3;
+			else if ((c & 0xF8) == 0xF0)
+				cp = c & 0x07, len = 4;
+			else
+				return std::nullopt;
+			if (i + len > in.size())
+				return std::nullopt;
+			for (size_t k = 1; k < len; ++k)
+			{
+				if ((uint8_t(in[i + k]) & 0xC0) != 0x80)
+					return std::nullopt;
+				cp = (cp << 6) | (in[i + k] & 0x3F);
+			}
+			static constexpr uint32_t minimum[] = { 0, 0, 0x80, 0x800, 0x10000 };
+			if (cp < minimum[len] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+				return std::nullopt;
+			if (cp >= 0x10000)
+			{
+				out.push_back(char16_t(0xD800 | ((cp - 0x10000) >> 10)));
+				out.push_back(char16_t(0xDC00 | ((cp - 0x10000) & 0x3FF)));
+			}
+			else
+				out.push_back(char16_t(cp));
+			i += len;
+		}
+		return out;
+	}
+
+	std::optional<std::string> ReferenceUtf16ToUtf8(std::u16string_view in)
+	{
+		std::string out;
+		for (size_t i = 0; i < in.size(); ++i)
+		{
+			uint32_t cp = in[i];
+			if (cp >= 0xDC00 && cp <= 0xDFFF)
+				return std::nullopt;
+			if (cp >= 0xD800 && cp <= 0xDBFF)
+			{
+				if (i + 1 == in.size() || in[i + 1] < 0xDC00 || in[i + 1] > 0xDFFF)
+					return std::nullopt;
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (in[++i] - 0xDC00);
+			}
+			if (cp < 0x80)
+				out.push_back(char(cp));
+			else if (cp < 0x800)
+				out += { char(0xC0 | (cp >> 6)), char(0x80 | (cp & 0x3F)) };
+			else if (cp < 0x10000)
+				out += { char(0xE0 | (cp >> 12)), char(0x80 | ((cp >> 6) & 0x3F)), char(0x80 | (cp & 0x3F)) };
+			else
+				out += { char(0xF0 | (cp >> 18)), char(0x80 | ((cp >> 12) & 0x3F)), char(0x80 | ((cp >> 6) & 0x3F)), char(0x80 | (cp & 0x3F)) };
+		}
+		return out;
+	}
+
+	void ExpectUtf8(std::string_view in)
+	{
+		std::vector<char16_t> out(in.size() + 1);
+		const size_t length = ConvertUtf8ToUtf16(in.data(), in.size(), out.data());
+		const auto expected = ReferenceUtf8ToUtf16(in);
+		ASSERT_EQ(length != UtfInvalid, expected.has_value()) << testing::PrintToString(std::string(in));
+		if (expected)
+			EXPECT_EQ(std::u16string(out.data(), length), *expected);
+	}
+
+	void ExpectUtf16(std::u16string_view in)
+	{
+		std::vector<char> out(in.size() * 3 + 1);
+		const size_t length = ConvertUtf16ToUtf8(in.data(), in.size(), out.data());
+		const auto expected = ReferenceUtf16ToUtf8(in);
+		ASSERT_EQ(length != UtfInvalid, expected.has_value());
+		if (expected)
+			EXPECT_EQ(std::string(out.data(), length), *expected);
+	}
+}
+
+TEST(Utf, EveryCodePointRoundTrips)
+{
+	for (uint32_t cp = 0; cp <= 0x10FFFF; ++cp)
+	{
+		if (cp >= 0xD800 && cp <= 0xDFFF)
+			continue;
+		std::u16string utf16;
+		if (cp >= 0x10000)
+			utf16 = { char16_t(0xD800 | ((cp - 0x10000) >> 10)), char16_t(0xDC00 | ((cp - 0x10000) & 0x3FF)) };
+		else
+			utf16 = { char16_t(cp) };
+
+		std::string utf8;
+		ASSERT_TRUE(Utf16ToUtf8(std::u16string_view(utf16), utf8)) << cp;
+		std::u16string back;
+		ASSERT_TRUE(Utf8ToUtf16(utf8, back)) << cp;
+		ASSERT_EQ(back, utf16) << cp;
+	}
+}
+
+TEST(Utf, RejectsIllFormedUtf8)
+{
+	for (std::string_view bad : {
+		"\x80", "\xBF", "\xC0\x80", "\xC1\xBF", "\xE0\x80\x80", "\xE0\x9F\xBF", "\xED\xA0\x80", "\xED\xBF\xBF",
+		"\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF", "\xC3", "\xE4\xB8",
+		"\xF0\x9F\x98", "\xC3\x28", "\xE4\x28\xAD" })
+	{
+		ExpectUtf8(bad);
+	}
+}
+
+TEST(Utf, RejectsUnpairedSurrogates)
+{
+	for (std::u16string_view bad : { u"\xD800", u"\xDC00", u"a\xD83D", u"\xD83D" "a", u"\xDE00\xD83D" })
+		ExpectUtf16(bad);
+}
+
+// Invalid or non ASCII input at every position of runs longer than a vector
+TEST(Utf, VectorPathsMatchReference)
+{
+	for (size_t size = 0; size < 70; ++size)
+	{
+		for (size_t at = 0; at < size; ++at)
+		{
+			for (std::string_view insert : { "\xC3\xA9", "\xE4\xB8\xAD", "\xF0\x9F\x98\x80", "\x80", "\xE4\xB8" })
+			{
+				std::string utf8(size, 'a');
+				utf8.replace(at, 1, insert);
+				ExpectUtf8(utf8);
+			}
+			for (char16_t insert : { u'\xE9', u'\x4E2D', u'\xD83D', u'\xDE00', u'\x7F', u'\x80' })
+			{
+				std::u16string utf16(size, u'a');
+				utf16[at] = insert;
+				ExpectUtf16(utf16);
+			}
+		}
+	}
+}
+
+TEST(Utf, RandomInputMatchesReference)
+{
+	std::mt19937 rng(33);
+	for (int i = 0; i < 20000; ++i)
+	{
+		// Mostly ASCII with some lead and continuation bytes, so valid strings happen
+		std::string utf8(rng() % 40, 0);
+		for (auto& c : utf8)
+			c = static_cast<char>(rng() % 4 ? rng() % 0x80 : 0x80 + rng() % 0x80);
+		ExpectUtf8(utf8);
+
+		std::u16string utf16(rng() % 40, 0);
+		for (auto& c : utf16)
+			c = static_cast<char16_t>(rng() % 4 ? rng() % 0x80 : rng() % 0x10000);
+		ExpectUtf16(utf16);
+	}
+}
+
+// Longer than the stack buffer, converted on the heap
+TEST(Utf, LongStrings)
+{
+	std::string utf8;
+	for (int i = 0; i < 300; ++i)
+		utf8 += "Microsoft YaHei \xE5\xBE\xAE\xE8\xBD\xAF\xE9\x9B\x85\xE9\xBB\x91 \xF0\x9F\x98\x80 ";
+	std::u16string utf16;
+	ASSERT_TRUE(Utf8ToUtf16(utf8, utf16));
+	EXPECT_EQ(utf16, *ReferenceUtf8ToUtf16(utf8));
+
+	std::string back;
+	ASSERT_TRUE(Utf16ToUtf8(std::u16string_view(utf16), back));
+	EXPECT_EQ(back, utf8);
+}
+
+TEST(Utf, OutputUntouchedOnFailure)
+{
+	std::u16string utf16 = u"kept";
+	EXPECT_FALSE(Utf8ToUtf16("abc\xC0\x80", utf16));
+	EXPECT_EQ(utf16, u"kept");
+	EXPECT_FALSE(Utf8ToUtf16(std::string(1000, 'a') + "\xFF", utf16));
+	EXPECT_EQ(utf16, u"kept");
+
+	std::string utf8 = "kept";
+	EXPECT_FALSE(Utf16ToUtf8(std::u16string_view(u"abc\xD800"), utf8));
+	EXPECT_EQ(utf8, "kept");
+	EXPECT_FALSE(Utf16ToUtf8(std::u16string_view(std::u16string(1000, u'a') + u'\xDC00'), utf8));
+	EXPECT_EQ(utf8, "kept");
+
+	EXPECT_TRUE(Utf8ToUtf16("", utf16));
+	EXPECT_TRUE(utf16.empty());
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+// A made up OpenType font and its WOFF / WOFF2 encodings, for Woff.hpp's tests and
+// benchmarks. The font is laid out the way the decoders write sfnt (records sorted by
+// tag, tables in the same order, each padded to 4 bytes, checksums set), so decoding
+// has to give back the exact bytes.
+
+#include "Sfnt.hpp"
+#include <zlib.h>
+#ifndef FONTMOD_NO_WOFF2
+#include <woff2/encode.h>
+#endif
+
+struct FixtureTable
+{
+	uint32_t tag;
+	std::vector<uint8_t> data;
+};
+
+inline uint32_t SfntChecksum(const uint8_t* data, size_t size)
+{
+	uint32_t sum = 0;
+	for (size_t i = 0; i < size; i += 4)
+	{
+		uint8_t word[4] = {};
+		memcpy(word, data + i, std::min<size_t>(4, size - i));
+		sum += ReadU32BE(word);
+	}
+	return sum;
+}
+
+// CFF flavored font with "outlineBytes" of glyph data, which compress about as well as
+// real outlines. Other tables have odd lengths so that padding is exercised.
+inline std::vector<uint8_t> FixtureSfnt(size_t outlineBytes = 64 << 10)
+{
+	uint32_t seed = 1;
+	auto fill = [&](size_t size)
+	{
+		std::vector<uint8_t> data(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			// Mostly small operands and repeated operators, as in charstrings
+			data[i] = (seed >> 16) % 4 ? static_cast<uint8_t>(0x8B + (seed >> 24) % 16) : static_cast<uint8_t>(seed >> 24);
+		}
+		return data;
+	};
+
+	std::vector<FixtureTable> tables = {
+		{ SfntTag('C', 'F', 'F', ' '), fill(outlineBytes) },
+		{ SfntTag('O', 'S', '/', '2'), fill(96) },
+		{ SfntTag('c', 'm', 'a', 'p'), fill(1061) },
+		{ SfntTag('h', 'e', 'a', 'd'), fill(54) },
+		{ SfntTag('h', 'h', 'e', 'a'), fill(36) },
+		{ SfntTag('h', 'm', 't', 'x'), fill(2002) },
+		{ SfntTag('m', 'a', 'x', 'p'), fill(6) },
+		{ SfntTag('n', 'a', 'm', 'e'), fill(333) },
+		{ SfntTag('p', 'o', 's', 't'), fill(32) },
+	};
+	// head: version 1.0, checkSumAdjustment set below, magic number
+	auto& head = tables[3].data;
+	WriteU32BE(&head[0], 0x00010000);
+	WriteU32BE(&head[8], 0);
+	WriteU32BE(&head[12], 0x5F0F3CF5);
+
+	const uint16_t numTables = static_cast<uint16_t>(tables.size());
+	size_t size = SfntHeaderSize + numTables * SfntTableRecordSize;
+	for (const auto& t : tables)
+		size += SfntPad4(static_cast<uint32_t>(t.data.size()));
+
+	std::vector<uint8_t> sfnt(size);
+	uint16_t entrySelector = 0;
+	while ((2u << entrySelector) <= numTables)
+		++entrySelector;
+	const uint16_t searchRange = static_cast<uint16_t>((1u << entrySelector) * 16);
+	WriteU32BE(&sfnt[0], SfntTag('O', 'T', 'T', 'O'));
+	WriteU16BE(&sfnt[4], numTables);
+	WriteU16BE(&sfnt[6], searchRange);
+	WriteU16BE(&sfnt[8], entrySelector);
+	WriteU16BE(&sfnt[10], static_cast<uint16_t>(numTables * 16 - searchRange));
+
+	uint32_t offset = static_cast<uint32_t>(SfntHeaderSize + numTables * SfntTableRecordSize);
+	size_t headOffset = 0;
+	for (uint16_t i = 0; i < numTables; ++i)
+	{
+		const auto& t = tables[i];
+		uint8_t* record = &sfnt[SfntHeaderSize + i * SfntTableRecordSize];
+		WriteU32BE(record, t.tag);
+		WriteU32BE(record + 4, SfntChecksum(t.data.data(), t.data.size()));
+		WriteU32BE(record + 8, offset);
+		WriteU32BE(record + 12, static_cast<uint32_t>(t.data.size()));
+		memcpy(&sfnt[offset], t.data.data(), t.data.size());
+		if (t.tag == SfntTag('h', 'e', 'a', 'd'))
+			headOffset = offset;
+		offset += SfntPad4(static_cast<uint32_t>(t.data.size()));
+	}
+	WriteU32BE(&sfnt[headOffset + 8], 0xB1B0AFBA - SfntChecksum(sfnt.data(), sfnt.size()));
+	return sfnt;
+}
+
+// WOFF 1.0 of an sfnt written by FixtureSfnt, tables that don't get smaller are stored
+inline std::vector<uint8_t> FixtureWoff(const std::vector<uint8_t>& sfnt)
+{
+	constexpr size_t headerSize = 44;
+	constexpr size_t entrySize = 20;
+	const uint16_t numTables = ReadU16BE(&sfnt[4]);
+
+	std::vector<uint8_t> woff(headerSize + numTables * entrySize);
+	for (uint16_t i = 0; i < numTables; ++i)
+	{
+		const uint8_t* record = &sfnt[SfntHeaderSize + i * SfntTableRecordSize];
+		const uint8_t* table = &sfnt[ReadU32BE(record + 8)];
+		const uint32_t origLength = ReadU32BE(record + 12);
+
+		uLongf compLength = compressBound(origLength);
+		std::vector<uint8_t> compressed(compLength);
+		compress2(compressed.data(), &compLength, table, origLength, Z_BEST_COMPRESSION);
+		if (compLength >= origLength)
+		{
+			compressed.assign(table, table + origLength);
+			compLength = origLength;
+		}
+
+		uint8_t* entry = &woff[headerSize + i * entrySize];
+		WriteU32BE(entry, ReadU32BE(record));
+		WriteU32BE(entry + 4, static_cast<uint32_t>(woff.size()));
+		WriteU32BE(entry + 8, static_cast<uint32_t>(compLength));
+		WriteU32BE(entry + 12, origLength);
+		WriteU32BE(entry + 16, ReadU32BE(record + 4));
+		woff.insert(woff.end(), compressed.begin(), compressed.begin() + compLength);
+		woff.resize(SfntPad4(static_cast<uint32_t>(woff.size())));
+	}
+
+	WriteU32BE(&woff[0], SfntTag('w', 'O', 'F', 'F'));
+	WriteU32BE(&woff[4], ReadU32BE(&sfnt[0]));
+	WriteU32BE(&woff[8], static_cast<uint32_t>(woff.size()));
+	WriteU16BE(&woff[12], numTables);
+	WriteU32BE(&woff[16], static_cast<uint32_t>(sfnt.size()));
+	WriteU16BE(&woff[20], 1); // majorVersion
+	return woff;
+}
+
+#ifndef FONTMOD_NO_WOFF2
+// WOFF2 of an sfnt, by the reference encoder
+inline std::vector<uint8_t> FixtureWoff2(const std::vector<uint8_t>& sfnt)
+{
+	size_t size = woff2::MaxWOFF2CompressedSize(sfnt.data(), sfnt.size());
+	std::vector<uint8_t> woff2(size);
+	if (!woff2::ConvertTTFToWOFF2(sfnt.data(), sfnt.size(), woff2.data(), &size))
+		return {};
+	woff2.resize(size);
+	return woff2;
+}
+#endif
@@ -0,0 +1,46 @@
+// Decoding web fonts from the "fonts" folder, in bytes of sfnt written per second. Files
+// are decoded in parallel, each thread into one buffer of its own.
+
+#include "FakeGdi.hpp"
+#include "Woff.hpp"
+#include "WebFontFixtures.hpp"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+	void Decode(benchmark::State& state, const std::vector<uint8_t>& sfnt, const std::vector<uint8_t>& encoded)
+	{
+		std::vector<uint8_t> decoded;
+		for (auto _ : state)
+		{
+			if (!DecodeWebFont(encoded.data(), encoded.size(), decoded))
+			{
+				state.SkipWithError("Decoding failed");
+				break;
+			}
+			benchmark::DoNotOptimize(decoded.data());
+		}
+		state.SetBytesProcessed(state.iterations() * sfnt.size());
+		state.counters["ratio"] = static_cast<double>(encoded.size()) / static_cast<double>(sfnt.size());
+	}
+
+	void DecodeWoff(benchmark::State& state)
+	{
+		const auto sfnt = FixtureSfnt(static_cast<size_t>(state.range(0)));
+		Decode(state, sfnt, FixtureWoff(sfnt));
+	}
+
+#ifndef FONTMOD_NO_WOFF2
+	void DecodeWoff2(benchmark::State& state)
+	{
+		const auto sfnt = FixtureSfnt(static_cast<size_t>(state.range(0)));
+		Decode(state, sfnt, FixtureWoff2(sfnt));
+	}
+#endif
+}
+
+// Outline sizes of a Latin font, a small CJK subset and a full CJK font
+BENCHMARK(DecodeWoff)->Arg(64 << 10)->Arg(1 << 20)->Arg(8 << 20)->ThreadRange(1, 4)->UseRealTime();
+#ifndef FONTMOD_NO_WOFF2
+BENCHMARK(DecodeWoff2)->Arg(64 << 10)->Arg(1 << 20)->Arg(8 << 20)->ThreadRange(1, 4)->UseRealTime();
+#endif
@@ -0,0 +1,149 @@
+#include "FakeGdi.hpp"
+#include "Woff.hpp"
+#include "WebFontFixtures.hpp"
+#include <gtest/gtest.h>
+
+namespace
+{
+	constexpr size_t WoffHeaderSize = 44;
+	constexpr size_t WoffEntrySize = 20;
+
+	uint8_t* WoffEntry(std::vector<uint8_t>& woff, size_t i)
+	{
+		return &woff[WoffHeaderSize + i * WoffEntrySize];
+	}
+
+	bool Decode(const std::vector<uint8_t>& data, std::vector<uint8_t>& sfnt)
+	{
+		return DecodeWebFont(data.data(), data.size(), sfnt);
+	}
+}
+
+TEST(Woff, Format)
+{
+	const auto sfnt = FixtureSfnt();
+	const auto woff = FixtureWoff(sfnt);
+	EXPECT_EQ(GetWebFontFormat(woff.data(), woff.size()), WebFontFormat::Woff);
+	EXPECT_EQ(GetWebFontFormat(sfnt.data(), sfnt.size()), WebFontFormat::None);
+	EXPECT_EQ(GetWebFontFormat(woff.data(), 3), WebFontFormat::None);
+	const uint8_t woff2[] = { 'w', 'O', 'F', '2' };
+	EXPECT_EQ(GetWebFontFormat(woff2, sizeof(woff2)), WebFontFormat::Woff2);
+}
+
+TEST(Woff, RoundTrip)
+{
+	for (size_t outlineBytes : { size_t(0), size_t(1), size_t(4097), size_t(1) << 20 })
+	{
+		const auto sfnt = FixtureSfnt(outlineBytes);
+		const auto woff = FixtureWoff(sfnt);
+		std::vector<uint8_t> decoded;
+		ASSERT_TRUE(Decode(woff, decoded)) << outlineBytes;
+		EXPECT_EQ(decoded, sfnt) << outlineBytes;
+	}
+}
+
+// Tables are stored when compressing doesn't make them smaller
+TEST(Woff, RoundTripStoredTables)
+{
+	const auto sfnt = FixtureSfnt();
+	auto woff = FixtureWoff(sfnt);
+	size_t stored = 0;
+	for (size_t i = 0; i < ReadU16BE(&woff[12]); ++i)
+		stored += ReadU32BE(WoffEntry(woff, i) + 8) == ReadU32BE(WoffEntry(woff, i) + 12);
+	EXPECT_GT(stored, 0u);
+
+	std::vector<uint8_t> decoded;
+	ASSERT_TRUE(Decode(woff, decoded));
+	EXPECT_EQ(decoded, sfnt);
+}
+
+// One buffer is reused for all files, a smaller font after a larger one is not padded
+TEST(Woff, ReusesBuffer)
+{
+	const auto large = FixtureSfnt(256 << 10);
+	const auto small = FixtureSfnt(100);
+	std::vector<uint8_t> decoded;
+	ASSERT_TRUE(Decode(FixtureWoff(large), decoded));
+	const size_t capacity = decoded.capacity();
+	ASSERT_TRUE(Decode(FixtureWoff(small), decoded));
+	EXPECT_EQ(decoded, small);
+	EXPECT_EQ(decoded.capacity(), capacity);
+}
+
+TEST(Woff, RejectsMalformedHeaders)
+{
+	const auto woff = FixtureWoff(FixtureSfnt());
+	std::vector<uint8_t> decoded;
+	auto rejects = [&](auto&& change)
+	{
+		auto bad = woff;
+		change(bad);
+		return !Decode(bad, decoded);
+	};
+
+	EXPECT_TRUE(rejects([](auto& w) { w.resize(WoffHeaderSize - 1); }));
+	EXPECT_TRUE(rejects([](auto& w) { w.pop_back(); })); // No longer the length in the header
+	EXPECT_TRUE(rejects([](auto& w) { WriteU32BE(&w[8], static_cast<uint32_t>(w.size() + 1)); }));
+	EXPECT_TRUE(rejects([](auto& w) { WriteU16BE(&w[12], 0); }));
+	EXPECT_TRUE(rejects([](auto& w) { WriteU16BE(&w[12], 0xFFFF); })); // Directory past the end
+	EXPECT_TRUE(rejects([](auto& w) { WriteU32BE(WoffEntry(w, 0) + 4, static_cast<uint32_t>(w.size())); }));
+	EXPECT_TRUE(rejects([](auto& w) { WriteU32BE(WoffEntry(w, 0) + 4, 0xFFFFFFF0); }));
+	EXPECT_TRUE(rejects([](auto& w) { WriteU32BE(WoffEntry(w, 0) + 8, ReadU32BE(WoffEntry(w, 0) + 12) + 1); }));
+	EXPECT_TRUE(rejects([](auto& w) { WriteU32BE(WoffEntry(w, 0) + 12, static_cast<uint32_t>(MaxDecodedFontSize + 1)); }));
+
+	// Corrupt zlib stream, and one that inflates to fewer bytes than claimed
+	EXPECT_TRUE(rejects([](auto& w) { w[ReadU32BE(WoffEntry(w, 0) + 4)] ^= 0xFF; }));
+	EXPECT_TRUE(rejects([](auto& w) { WriteU32BE(WoffEntry(w, 0) + 12, ReadU32BE(WoffEntry(w, 0) + 12) + 4); }));
+
+	// Lengths above 0xFFFFFFFC padded to 4 bytes in 32 bits are 0: the table would take
+	// no room in the output, and be inflated past its end
+	for (uint32_t origLength : { 0xFFFFFFFDu, 0xFFFFFFFEu, 0xFFFFFFFFu })
+		EXPECT_TRUE(rejects([=](auto& w) { WriteU32BE(WoffEntry(w, 0) + 12, origLength); })) << origLength;
+
+	// Tables that add up to more than the limit
+	EXPECT_TRUE(rejects([](auto& w)
+	{
+		for (size_t i = 0; i < ReadU16BE(&w[12]); ++i)
+			WriteU32BE(WoffEntry(w, i) + 12, static_cast<uint32_t>(MaxDecodedFontSize / 4));
+	}));
+}
+
+TEST(Woff2, RoundTrip)
+{
+#ifdef FONTMOD_NO_WOFF2
+	GTEST_SKIP() << "Built without the woff2 library";
+#else
+	for (size_t outlineBytes : { size_t(1), size_t(4097), size_t(1) << 20 })
+	{
+		const auto sfnt = FixtureSfnt(outlineBytes);
+		const auto woff2 = FixtureWoff2(sfnt);
+		ASSERT_FALSE(woff2.empty());
+		EXPECT_EQ(GetWebFontFormat(woff2.data(), woff2.size()), WebFontFormat::Woff2);
+		std::vector<uint8_t> decoded;
+		ASSERT_TRUE(Decode(woff2, decoded)) << outlineBytes;
+		EXPECT_EQ(decoded, sfnt) << outlineBytes;
+	}
+#endif
+}
+
+TEST(Woff2, RejectsMalformedHeaders)
+{
+#ifdef FONTMOD_NO_WOFF2
+	GTEST_SKIP() << "Built without the woff2 library";
+#else
+	const auto woff2 = FixtureWoff2(FixtureSfnt());
+	ASSERT_FALSE(woff2.empty());
+	std::vector<uint8_t> decoded;
+	auto rejects = [&](auto&& change)
+	{
+		auto bad = woff2;
+		change(bad);
+		return !Decode(bad, decoded);
+	};
+
+	EXPECT_TRUE(rejects([](auto& w) { w.resize(47); }));
+	EXPECT_TRUE(rejects([](auto& w) { w.resize(w.size() / 2); }));
+	EXPECT_TRUE(rejects([](auto& w) { WriteU32BE(&w[16], 0xFFFFFFFF); })); // totalSfntSize above the limit
+	EXPECT_TRUE(rejects([](auto& w) { WriteU32BE(&w[16], 12); })); // Smaller than the tables
+#endif
+}
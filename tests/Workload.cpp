@@ -0,0 +1,442 @@
+// Load test of the CreateFont, glyph and GDI+ paths over the fake GDI. Threads replay a
+// synthetic call stream: face names drawn with Zipf popularity, a mix of heights, weights
+// and charsets, now and then a burst of glyph queries with Zipf distributed characters,
+// as a program laying out text does, and GDI+ fonts of the same faces. For each thread
+// count it prints throughput, latency percentiles and resident memory.
+//
+// FontModWorkload [--threads 1,2,4,8] [--ops 100000] [--faces 500] [--zipf 1.1]
+//                 [--burst 0.2] [--burst-length 64] [--gdiplus 0.2] [--call-cost 100] [--json]
+//
+// CreateFont runs the hook's MatchFontRule and OverrideLogFont over rules like a large
+// config: exact faces, conditional variants, patterns and FontFallback. Glyph queries
+// go through ReplaceGlyphOutlineChar as GetGlyphOutlineW does, GDI+ fonts through
+// ResolveGdipFamily and OverrideGdipFont as the GdipCreateFontFamilyFromName and
+// GdipCreateFont hooks do, then to the fake GDI and GDI+.
+
+#include "FakeGdi.hpp"
+#include "FacePattern.hpp"
+#include "FontInfo.hpp"
+#include "GlyphReplace.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <unordered_set>
+
+namespace
+{
+	struct Options
+	{
+		std::vector<unsigned> threads = { 1, 2, 4, 8 };
+		size_t ops = 100000; // CreateFont calls per thread
+		size_t faces = 500;
+		double zipf = 1.1;
+		double burst = 0.2; // Chance of a glyph burst after a CreateFont
+		size_t burstLength = 64;
+		double gdiplus = 0.2; // Chance of a GDI+ font after a CreateFont
+		uint32_t callCost = 100;
+		bool json = false;
+	};
+
+	// Draws 0..n-1 with probability proportional to 1 / (rank + 1)^s
+	struct ZipfDistribution
+	{
+		ZipfDistribution(size_t n, double s)
+		{
+			double sum = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				sum += 1 / std::pow(double(i + 1), s);
+				cdf.push_back(sum);
+			}
+			for (auto& c : cdf)
+				c /= sum;
+		}
+
+		template <class Rng>
+		size_t operator()(Rng& rng) const
+		{
+			const double u = std::uniform_real_distribution<double>()(rng);
+			return std::min(size_t(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin()), cdf.size() - 1);
+		}
+
+		std::vector<double> cdf;
+	};
+
+	// Config and installed fonts of the simulated program, read only while threads run
+	struct WorkloadRules
+	{
+		std::unordered_map<std::wstring, FontInfo> fonts;
+		FacePatternSet patterns;
+		std::vector<FontInfo> patternRules;
+		std::unordered_set<std::wstring> installed;
+		std::unordered_map<UINT, UINT> glyphReplace;
+		std::unordered_map<std::wstring, GPFamilyInfo> gdipFamilies;
+		std::unordered_map<std::wstring, GPFontInfo> gdipFonts;
+
+		// MatchFontRule lookups, as HookFontRules in FontMod.cpp
+		const FontInfo* All() const { return nullptr; }
+		const FontInfo* Fallback() const { return Find(L"FontFallback"); }
+		bool HasFallbackChain() const { return false; }
+		const std::wstring* SelectFallback(BYTE) const { return nullptr; }
+		uint32_t CallerModule() const { return UINT32_MAX; }
+
+		const FontInfo* Face(const WCHAR* faceName) const
+		{
+			if (auto info = Find(faceName))
+				return info;
+			if (!patterns.empty())
+			{
+				auto id = patterns.Match(faceName);
+				if (id != FacePatternSet::npos)
+					return &patternRules[id];
+			}
+			return nullptr;
+		}
+
+		// The hook enumerates fonts, which costs a GDI call
+		bool FaceExists(const WCHAR* faceName) const
+		{
+			fakeGdi.Call();
+			return installed.contains(faceName);
+		}
+
+		const FontInfo* Find(const std::wstring& key) const
+		{
+			auto it = fonts.find(key);
+			return it != fonts.end() ? &it->second : nullptr;
+		}
+	};
+
+	std::wstring FaceName(size_t i)
+	{
+		return L"Face " + std::to_wstring(i);
+	}
+
+	FontInfo Rule(const std::wstring& name, long heightOffset = 0)
+	{
+		FontInfo info;
+		info.name = name;
+		if (heightOffset)
+		{
+			info.overrideFlags = FontInfo::OverrideFlags::HeightOffset;
+			info.heightOffset = { double(heightOffset) };
+		}
+		CompileOverride(info);
+		return info;
+	}
+
+	// Every third face has a rule, every fifth of those with size variants. One face in
+	// ten isn't installed. Faces 1000+ only match patterns.
+	WorkloadRules BuildRules(const Options& options)
+	{
+		WorkloadRules rules;
+		for (size_t i = 0; i < options.faces; ++i)
+		{
+			const auto face = FaceName(i);
+			if (i % 10 != 9)
+				rules.installed.insert(face);
+			if (i % 3 != 0)
+				continue;
+
+			if (i % 15 == 0)
+			{
+				auto variants = std::make_shared<ConditionalRules<FontInfo>>();
+				FontCondition small, large;
+				small.heightMax = 14;
+				large.heightMin = 15;
+				large.weightMin = 600;
+				variants->Add(small, Rule(L"Small UI"));
+				variants->Add(large, Rule(L"Large UI", 2));
+				variants->Compile();
+				FontInfo info;
+				info.variants = std::move(variants);
+				rules.fonts.emplace(face, std::move(info));
+			}
+			else
+				rules.fonts.emplace(face, Rule(L"Replacement " + std::to_wstring(i % 7), i % 2 ? 1 : 0));
+		}
+		rules.fonts.emplace(L"FontFallback", Rule(L"Fallback UI"));
+
+		std::wstring errMsg;
+		for (const wchar_t* pattern : { L"Face 1??? Bold", L"^Face 2[0-9]+$", L"*Mono" })
+		{
+			rules.patterns.Add(pattern, errMsg);
+			rules.patternRules.push_back(Rule(L"Pattern UI"));
+		}
+		rules.patterns.Compile(errMsg);
+
+		for (UINT c = 0x21; c < 0x7F; c += 5)
+			rules.glyphReplace[c] = c + 1;
+
+		// Every fourth face is replaced in GDI+, the replacements have size and style rules
+		for (size_t i = 0; i < options.faces; i += 4)
+			rules.gdipFamilies.emplace(FaceName(i), GPFamilyInfo{ L"GDI+ UI " + std::to_wstring(i % 5) });
+		for (size_t i = 0; i < 5; ++i)
+		{
+			GPFontInfo info;
+			info.overrideFlags = GPFontInfo::OverrideFlags::Size | (i % 2 ? GPFontInfo::OverrideFlags::Style : GPFontInfo::OverrideFlags::None);
+			info.size = 10.5f + i;
+			info.style = GPFontInfo::Style::Bold;
+			rules.gdipFonts.emplace(L"GDI+ UI " + std::to_wstring(i), info);
+		}
+		return rules;
+	}
+
+	struct ThreadResult
+	{
+		std::vector<uint32_t> createFontNs;
+		std::vector<uint32_t> glyphNs; // Per glyph of a burst
+		std::vector<uint32_t> gdipNs; // Per GDI+ family and font
+		uint64_t fallbacks = 0;
+		uint64_t misses = 0;
+		uint64_t advances = 0; // Keeps the glyph queries from being optimized out
+	};
+
+	void RunThread(const Options& options, WorkloadRules& rules, unsigned index, ThreadResult& result)
+	{
+		using Clock = std::chrono::steady_clock;
+		static constexpr long heights[] = { -12, -12, -12, -13, -15, -16, -16, -20, -24, 0, 14, 32 };
+		static constexpr long weights[] = { FW_NORMAL, FW_NORMAL, FW_NORMAL, FW_NORMAL, FW_BOLD, FW_BOLD, 300 };
+		static constexpr BYTE charSets[] = { DEFAULT_CHARSET, DEFAULT_CHARSET, DEFAULT_CHARSET, ANSI_CHARSET, GB2312_CHARSET, SHIFTJIS_CHARSET };
+
+		std::mt19937_64 rng(index + 1);
+		const ZipfDistribution faces(options.faces + 100, options.zipf);
+		// Characters by frequency: ASCII letters first, then CJK
+		const ZipfDistribution chars(3000, 1.0);
+		std::bernoulli_distribution burst(options.burst);
+		std::bernoulli_distribution gdiplus(options.gdiplus);
+
+		// Names are built before the clock starts, a program passes them in
+		std::vector<std::wstring> names;
+		for (size_t i = 0; i < options.faces + 100; ++i)
+			names.push_back(i < options.faces ? FaceName(i) : FaceName(1000 + i) + (i % 2 ? L" Bold" : L" Mono"));
+
+		result.createFontNs.reserve(options.ops);
+		result.glyphNs.reserve(size_t(options.ops * options.burst * options.burstLength * 1.2));
+		result.gdipNs.reserve(size_t(options.ops * options.gdiplus * 1.2));
+		HDC hdc = CreateCompatibleDC(nullptr);
+		for (size_t op = 0; op < options.ops; ++op)
+		{
+			LOGFONTW lf = {};
+			lf.lfHeight = heights[rng() % std::size(heights)];
+			lf.lfWeight = weights[rng() % std::size(weights)];
+			lf.lfCharSet = charSets[rng() % std::size(charSets)];
+			const auto& name = names[faces(rng)];
+			std::copy_n(name.c_str(), std::min(name.size() + 1, size_t(LF_FACESIZE)), lf.lfFaceName);
+
+			const auto start = Clock::now();
+			const auto match = MatchFontRule(lf, rules);
+			LOGFONTW created = lf;
+			if (match.info)
+				OverrideLogFont(*match.info, created, DefaultDpi);
+			HFONT hFont = CreateFontIndirectW(&created);
+			result.createFontNs.push_back(static_cast<uint32_t>(std::chrono::nanoseconds(Clock::now() - start).count()));
+			result.misses += !match.info;
+			result.fallbacks += match.isFallback;
+
+			if (burst(rng))
+			{
+				SelectObject(hdc, hFont);
+				for (size_t i = 0; i < options.burstLength; ++i)
+				{
+					const size_t rank = chars(rng);
+					UINT ch = rank < 94 ? UINT(0x21 + rank) : UINT(0x4E00 + rank);
+
+					const auto glyphStart = Clock::now();
+					ReplaceGlyphOutlineChar(rules.glyphReplace, ch);
+					ABC abc;
+					GetCharABCWidthsW(hdc, ch, ch, &abc);
+					result.advances += abc.abcA + abc.abcB + abc.abcC;
+					result.glyphNs.push_back(static_cast<uint32_t>(std::chrono::nanoseconds(Clock::now() - glyphStart).count()));
+				}
+				SelectObject(hdc, nullptr);
+			}
+			DeleteObject(hFont);
+
+			if (gdiplus(rng))
+			{
+				const auto gdipStart = Clock::now();
+				const GPFamilyInfo* familyRule;
+				GpFontFamily* family = nullptr;
+				GdipCreateFontFamilyFromName(ResolveGdipFamily(rules.gdipFamilies, name.c_str(), familyRule), nullptr, &family);
+
+				// The font hook reads the family name back
+				REAL emSize = 9;
+				INT style = 0;
+				int unit = 3; // UnitPoint
+				std::wstring familyName(LF_FACESIZE, 0);
+				GpFont* font = nullptr;
+				if (GdipGetFamilyName(family, familyName.data(), 0) == Ok)
+				{
+					familyName.resize(wcslen(familyName.c_str()));
+					OverrideGdipFont(rules.gdipFonts, familyName, emSize, style, unit);
+				}
+				GdipCreateFont(family, emSize, style, unit, &font);
+				result.gdipNs.push_back(static_cast<uint32_t>(std::chrono::nanoseconds(Clock::now() - gdipStart).count()));
+				GdipDeleteFont(font);
+				GdipDeleteFontFamily(family);
+			}
+		}
+		DeleteDC(hdc);
+	}
+
+	struct Percentiles
+	{
+		uint32_t p50 = 0, p99 = 0, p999 = 0, max = 0;
+	};
+
+	Percentiles Summarize(std::vector<uint32_t>& ns)
+	{
+		Percentiles p;
+		if (ns.empty())
+			return p;
+		auto at = [&](double q) {
+			auto nth = ns.begin() + std::min(ns.size() - 1, size_t(q * ns.size()));
+			std::nth_element(ns.begin(), nth, ns.end());
+			return *nth;
+		};
+		p.p50 = at(0.5);
+		p.p99 = at(0.99);
+		p.p999 = at(0.999);
+		p.max = *std::max_element(ns.begin(), ns.end());
+		return p;
+	}
+
+	// Resident and peak resident memory in KB, from /proc on Linux, 0 elsewhere
+	std::pair<uint64_t, uint64_t> ResidentKb()
+	{
+		std::ifstream status("/proc/self/status");
+		uint64_t rss = 0, peak = 0;
+		for (std::string line; std::getline(status, line);)
+		{
+			if (line.starts_with("VmRSS:"))
+				rss = std::stoull(line.substr(6));
+			else if (line.starts_with("VmHWM:"))
+				peak = std::stoull(line.substr(6));
+		}
+		return { rss, peak };
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string_view arg = argv[i];
+			if (arg == "--json")
+			{
+				options.json = true;
+				continue;
+			}
+			if (i + 1 >= argc)
+				return false;
+			const std::string value = argv[++i];
+			if (arg == "--threads")
+			{
+				options.threads.clear();
+				for (size_t pos = 0; pos < value.size();)
+				{
+					size_t end = value.find(',', pos);
+					if (end == value.npos)
+						end = value.size();
+					options.threads.push_back(std::max(1, std::stoi(value.substr(pos, end - pos))));
+					pos = end + 1;
+				}
+			}
+			else if (arg == "--ops")
+				options.ops = std::stoull(value);
+			else if (arg == "--faces")
+				options.faces = std::max<size_t>(1, std::stoull(value));
+			else if (arg == "--zipf")
+				options.zipf = std::stod(value);
+			else if (arg == "--burst")
+				options.burst = std::clamp(std::stod(value), 0.0, 1.0);
+			else if (arg == "--burst-length")
+				options.burstLength = std::stoull(value);
+			else if (arg == "--gdiplus")
+				options.gdiplus = std::clamp(std::stod(value), 0.0, 1.0);
+			else if (arg == "--call-cost")
+				options.callCost = static_cast<uint32_t>(std::stoul(value));
+			else
+				return false;
+		}
+		return !options.threads.empty();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	try
+	{
+		if (!ParseOptions(argc, argv, options))
+		{
+			fprintf(stderr, "Usage: %s [--threads 1,2,4,8] [--ops n] [--faces n] [--zipf s] [--burst p] [--burst-length n] [--gdiplus p] [--call-cost n] [--json]\n", argv[0]);
+			return 2;
+		}
+	}
+	catch (const std::exception&)
+	{
+		fprintf(stderr, "Invalid number in arguments\n");
+		return 2;
+	}
+
+	fakeGdi.callCost = options.callCost;
+	WorkloadRules rules = BuildRules(options);
+
+	if (options.json)
+		printf("[\n");
+	else
+		printf("%7s %12s %9s %9s %9s %9s %9s %9s %9s %9s %10s %10s\n", "threads", "fonts/s", "p50 ns", "p99 ns", "p99.9 ns", "max ns",
+			"glyph p50", "glyph p99", "gdip p50", "gdip p99", "rss KB", "peak KB");
+
+	for (size_t run = 0; run < options.threads.size(); ++run)
+	{
+		const unsigned threadCount = options.threads[run];
+		std::vector<ThreadResult> results(threadCount);
+		std::vector<std::thread> threads;
+		const auto start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < threadCount; ++i)
+			threads.emplace_back(RunThread, std::cref(options), std::ref(rules), i, std::ref(results[i]));
+		for (auto& t : threads)
+			t.join();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		const auto [rss, peak] = ResidentKb();
+
+		std::vector<uint32_t> createFont, glyph, gdip;
+		uint64_t fallbacks = 0, misses = 0;
+		for (auto& r : results)
+		{
+			createFont.insert(createFont.end(), r.createFontNs.begin(), r.createFontNs.end());
+			glyph.insert(glyph.end(), r.glyphNs.begin(), r.glyphNs.end());
+			gdip.insert(gdip.end(), r.gdipNs.begin(), r.gdipNs.end());
+			fallbacks += r.fallbacks;
+			misses += r.misses;
+		}
+		const double throughput = createFont.size() / seconds;
+		const auto fonts = Summarize(createFont);
+		const auto glyphs = Summarize(glyph);
+		const auto gdipFonts = Summarize(gdip);
+
+		if (options.json)
+		{
+			printf("  {\"threads\": %u, \"createFontPerSecond\": %.0f, \"p50\": %u, \"p99\": %u, \"p999\": %u, \"max\": %u, "
+				"\"glyphs\": %zu, \"glyphP50\": %u, \"glyphP99\": %u, \"glyphP999\": %u, "
+				"\"gdipFonts\": %zu, \"gdipP50\": %u, \"gdipP99\": %u, \"gdipP999\": %u, \"fallbacks\": %llu, \"misses\": %llu, "
+				"\"rssKb\": %llu, \"peakRssKb\": %llu}%s\n",
+				threadCount, throughput, fonts.p50, fonts.p99, fonts.p999, fonts.max, glyph.size(), glyphs.p50, glyphs.p99, glyphs.p999,
+				gdip.size(), gdipFonts.p50, gdipFonts.p99, gdipFonts.p999,
+				(unsigned long long)fallbacks, (unsigned long long)misses, (unsigned long long)rss, (unsigned long long)peak,
+				run + 1 < options.threads.size() ? "," : "");
+		}
+		else
+		{
+			printf("%7u %12.0f %9u %9u %9u %9u %9u %9u %9u %9u %10llu %10llu\n", threadCount, throughput, fonts.p50, fonts.p99, fonts.p999, fonts.max,
+				glyphs.p50, glyphs.p99, gdipFonts.p50, gdipFonts.p99, (unsigned long long)rss, (unsigned long long)peak);
+		}
+	}
+	if (options.json)
+		printf("]\n");
+	return 0;
+}
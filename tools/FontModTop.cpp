@@ -0,0 +1,206 @@
+// A top like view of all processes FontMod is loaded into with "liveStats" enabled.
+// Rates are computed between two refreshes, hit rates over the life of the process.
+//
+//   FontModTop [--interval <ms>] [--once] [--pid <pid>]
+//
+// --interval  Refresh period, 1000 ms by default
+// --once      Sample twice, print one table and exit, for scripts and logs
+// --pid       Only show this process
+
+#include "LiveStatsSource.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	struct Options
+	{
+		int intervalMs = 1000;
+		bool once = false;
+		uint32_t pid = 0;
+	};
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const bool hasValue = i + 1 < argc;
+			if (!strcmp(argv[i], "--interval") && hasValue)
+				options.intervalMs = std::max(atoi(argv[++i]), 1);
+			else if (!strcmp(argv[i], "--pid") && hasValue)
+				options.pid = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+			else if (!strcmp(argv[i], "--once"))
+				options.once = true;
+			else
+			{
+				fprintf(stderr, "Usage: %s [--interval <ms>] [--once] [--pid <pid>]\n", argv[0]);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint64_t Counter(const LiveStatsSnapshot& s, LiveCounter counter)
+	{
+		return s.counters[static_cast<size_t>(counter)];
+	}
+
+	uint64_t HookCalls(const LiveStatsSnapshot& s, HookId id)
+	{
+		return s.hookCalls[static_cast<size_t>(id)];
+	}
+
+	uint64_t TotalCalls(const LiveStatsSnapshot& s)
+	{
+		uint64_t total = 0;
+		for (uint64_t calls : s.hookCalls)
+			total += calls;
+		return total;
+	}
+
+	// Hit rate column, "-" before the cache is used
+	void PrintHitRate(const LiveStatsSnapshot& s, LiveCounter hits, LiveCounter misses)
+	{
+		const uint64_t h = Counter(s, hits);
+		const uint64_t total = h + Counter(s, misses);
+		if (total)
+			printf(" %6.1f", 100.0 * static_cast<double>(h) / static_cast<double>(total));
+		else
+			printf(" %6s", "-");
+	}
+
+	void PrintUptime(uint64_t startTime)
+	{
+		const uint64_t now = LiveStatsNow();
+		const uint64_t seconds = now > startTime ? (now - startTime) / 10000000 : 0;
+		char text[32];
+		if (seconds >= 86400)
+			snprintf(text, sizeof(text), "%llud%02lluh", seconds / 86400ULL, seconds / 3600 % 24ULL);
+		else
+			snprintf(text, sizeof(text), "%02llu:%02llu:%02llu", seconds / 3600ULL, seconds / 60 % 60ULL, seconds % 60ULL);
+		printf(" %9s", text);
+	}
+
+	struct Tracked
+	{
+		std::unique_ptr<LiveStatsView> view;
+		std::string name;
+		LiveStatsSnapshot previous;
+		bool hasPrevious = false;
+	};
+
+	class Top
+	{
+	public:
+		explicit Top(const Options& options) : options(options)
+		{
+		}
+
+		// Opens blocks of new processes, drops exited ones and reads all of them
+		void Sample()
+		{
+			std::map<uint32_t, Tracked> next;
+			for (auto& process : FindLiveStatsProcesses())
+			{
+				if (options.pid && process.pid != options.pid)
+					continue;
+				auto it = processes.find(process.pid);
+				if (it != processes.end())
+				{
+					next.emplace(process.pid, std::move(it->second));
+					continue;
+				}
+				Tracked tracked = { std::make_unique<LiveStatsView>(), std::move(process.name) };
+				if (tracked.view->Open(process.pid))
+					next.emplace(process.pid, std::move(tracked));
+			}
+			processes = std::move(next);
+
+			for (auto& [pid, tracked] : processes)
+			{
+				tracked.hasPrevious = current.contains(pid);
+				if (tracked.hasPrevious)
+					tracked.previous = current[pid];
+			}
+			current.clear();
+			for (auto& [pid, tracked] : processes)
+			{
+				LiveStatsSnapshot snapshot;
+				if (tracked.view->Read(snapshot))
+					current[pid] = snapshot;
+			}
+		}
+
+		void Print(double seconds) const
+		{
+			printf("FontMod live stats, %zu process%s\n\n", current.size(), current.size() == 1 ? "" : "es");
+			printf("%7s %-20s %9s %9s %9s %6s %9s %6s %6s %6s %6s %5s %9s\n",
+				"PID", "NAME", "UPTIME", "CALLS/s", "FONTS/s", "RULE%", "FALLBACK", "ENUM%", "DATA%", "EXT%", "WIDTH%", "USER", "LOGGED");
+			for (const auto& [pid, snapshot] : current)
+			{
+				const Tracked& tracked = processes.at(pid);
+				double calls = 0, fonts = 0;
+				if (tracked.hasPrevious && seconds > 0)
+				{
+					calls = static_cast<double>(TotalCalls(snapshot) - TotalCalls(tracked.previous)) / seconds;
+					fonts = static_cast<double>(HookCalls(snapshot, HookId::CreateFontIndirectExW) - HookCalls(tracked.previous, HookId::CreateFontIndirectExW)) / seconds;
+				}
+
+				printf("%7u %-20.20s", pid, tracked.name.c_str());
+				PrintUptime(snapshot.startTime);
+				printf(" %9.0f %9.0f", calls, fonts);
+				PrintHitRate(snapshot, LiveCounter::RuleHits, LiveCounter::RuleMisses);
+				printf(" %9llu", static_cast<unsigned long long>(Counter(snapshot, LiveCounter::FallbackHits)));
+				PrintHitRate(snapshot, LiveCounter::EnumCacheHits, LiveCounter::EnumCacheMisses);
+				PrintHitRate(snapshot, LiveCounter::FontDataHits, LiveCounter::FontDataMisses);
+				PrintHitRate(snapshot, LiveCounter::TextExtentHits, LiveCounter::TextExtentMisses);
+				PrintHitRate(snapshot, LiveCounter::CharWidthHits, LiveCounter::CharWidthMisses);
+				printf(" %5llu", static_cast<unsigned long long>(Counter(snapshot, LiveCounter::UserFontsLoaded)));
+				printf(" %8lluK\n", static_cast<unsigned long long>(Counter(snapshot, LiveCounter::LoggedBytes) / 1024));
+			}
+			fflush(stdout);
+		}
+
+	private:
+		const Options& options;
+		std::map<uint32_t, Tracked> processes;
+		std::map<uint32_t, LiveStatsSnapshot> current;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+		return 2;
+
+#ifdef _WIN32
+	// Let the console understand the escape sequences used to redraw
+	HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+	DWORD mode;
+	if (!options.once && GetConsoleMode(console, &mode))
+		SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+
+	const auto interval = std::chrono::milliseconds(options.intervalMs);
+	Top top(options);
+	top.Sample();
+	for (;;)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		std::this_thread::sleep_for(interval);
+		top.Sample();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (options.once)
+		{
+			top.Print(seconds);
+			return 0;
+		}
+		printf("\x1b[H\x1b[2J");
+		top.Print(seconds);
+	}
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+// Finds and maps the live statistics blocks of running processes for viewers. On Windows
+// these are the "Local\FontModStats.<pid>" mappings FontMod publishes. Elsewhere the same
+// layout is read from POSIX shared memory "/FontModStats.<pid>", which is how the reader
+// is tested, and what a publisher on another platform would use.
+
+#include "StatsLayout.hpp"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <tlhelp32.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct LiveStatsProcess
+{
+	uint32_t pid;
+	std::string name; // Executable name, empty if unknown
+};
+
+// Current time in the unit of LiveStatsBlock::startTime, 100 ns since 1601
+inline uint64_t LiveStatsNow()
+{
+	constexpr uint64_t UnixEpoch = 116444736000000000; // 1970 in FILETIME units
+	const auto sinceUnix = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+	return UnixEpoch + static_cast<uint64_t>(sinceUnix.count() / 100);
+}
+
+// One process's block, mapped read only until destroyed
+class LiveStatsView
+{
+public:
+	LiveStatsView() = default;
+	LiveStatsView(const LiveStatsView&) = delete;
+	LiveStatsView& operator=(const LiveStatsView&) = delete;
+
+	~LiveStatsView()
+	{
+		Close();
+	}
+
+	bool Open(uint32_t pid)
+	{
+		Close();
+		const std::string name = std::string(LiveStatsNamePrefix) + std::to_string(pid);
+#ifdef _WIN32
+		const std::wstring wideName = L"Local\\" + std::wstring(name.begin(), name.end());
+		mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, wideName.c_str());
+		if (!mapping)
+			return false;
+		view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		MEMORY_BASIC_INFORMATION info;
+		if (!view || !VirtualQuery(view, &info, sizeof(info)))
+		{
+			Close();
+			return false;
+		}
+		size = info.RegionSize;
+#else
+		const int fd = shm_open(("/" + name).c_str(), O_RDONLY, 0);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			size = static_cast<size_t>(st.st_size);
+			view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+			if (view == MAP_FAILED)
+				view = nullptr;
+		}
+		close(fd);
+		if (!view)
+		{
+			Close();
+			return false;
+		}
+#endif
+		return true;
+	}
+
+	// False if the block isn't one this build can read
+	bool Read(LiveStatsSnapshot& snapshot) const
+	{
+		return view && ReadLiveStats(view, size, snapshot);
+	}
+
+private:
+	void Close()
+	{
+#ifdef _WIN32
+		if (view)
+			UnmapViewOfFile(view);
+		if (mapping)
+			CloseHandle(mapping);
+		mapping = nullptr;
+#else
+		if (view)
+			munmap(view, size);
+#endif
+		view = nullptr;
+		size = 0;
+	}
+
+#ifdef _WIN32
+	HANDLE mapping = nullptr;
+#endif
+	void* view = nullptr;
+	size_t size = 0;
+};
+
+// Processes that currently publish a block
+inline std::vector<LiveStatsProcess> FindLiveStatsProcesses()
+{
+	std::vector<LiveStatsProcess> processes;
+#ifdef _WIN32
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot == INVALID_HANDLE_VALUE)
+		return processes;
+	PROCESSENTRY32W entry = { sizeof(entry) };
+	for (BOOL more = Process32FirstW(snapshot, &entry); more; more = Process32NextW(snapshot, &entry))
+	{
+		LiveStatsView view;
+		if (!view.Open(entry.th32ProcessID))
+			continue;
+		std::string name;
+		for (const wchar_t* c = entry.szExeFile; *c; ++c)
+			name.push_back(*c < 0x80 ? static_cast<char>(*c) : '?');
+		processes.push_back({ entry.th32ProcessID, std::move(name) });
+	}
+	CloseHandle(snapshot);
+#else
+	// Linux lists POSIX shared memory in /dev/shm. Objects of processes that died without
+	// unlinking them are left there, they are skipped.
+	std::error_code ec;
+	for (const auto& file : std::filesystem::directory_iterator("/dev/shm", ec))
+	{
+		const std::string fileName = file.path().filename().string();
+		if (!fileName.starts_with(LiveStatsNamePrefix))
+			continue;
+		const std::string digits = fileName.substr(LiveStatsNamePrefix.size());
+		if (digits.empty() || digits.find_first_not_of("0123456789") != digits.npos || digits.size() > 9)
+			continue;
+		const auto pid = static_cast<uint32_t>(std::stoul(digits));
+		if (kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH)
+			continue;
+
+		std::string name;
+		std::ifstream comm("/proc/" + digits + "/comm");
+		std::getline(comm, name);
+		processes.push_back({ pid, std::move(name) });
+	}
+#endif
+	std::sort(processes.begin(), processes.end(), [](const auto& a, const auto& b) { return a.pid < b.pid; });
+	return processes;
+}